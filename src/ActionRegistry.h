@@ -134,6 +134,7 @@ namespace Actions {
         constexpr const char* ToggleFocus = "app.toggle_focus";
         constexpr const char* FocusTerminal = "app.focus_terminal";
         constexpr const char* ToggleTerminal = "app.toggle_terminal";
+        constexpr const char* ToggleRenderStats = "app.toggle_render_stats";
         constexpr const char* ScrollToSource = "app.scroll_to_source";
 
         constexpr const char* NextTab = "app.next_tab";
@@ -14,6 +14,7 @@ struct AppActionContext {
     std::function<void()> toggle_focus;
     std::function<void()> focus_terminal;
     std::function<void()> toggle_terminal;
+    std::function<void()> toggle_render_stats;
 
     std::function<void()> next_tab;
     std::function<void()> prev_tab;
@@ -89,6 +90,11 @@ public:
             return {true, false};
         });
 
+        registry_.register_action(Actions::App::ToggleRenderStats, [this]() -> ActionResult {
+            if (ctx_.toggle_render_stats) ctx_.toggle_render_stats();
+            return {true, false};
+        });
+
         registry_.register_action(Actions::App::NextTab, [this]() -> ActionResult {
             if (ctx_.next_tab) ctx_.next_tab();
             return {true, true};
@@ -160,6 +166,7 @@ private:
         mapper_.bind({SDLK_e, KeyMod::Primary}, ToggleFocus, InputContext::Global);
         mapper_.bind({SDLK_BACKQUOTE, KeyMod::Primary}, FocusTerminal, InputContext::Global);
         mapper_.bind({SDLK_F5, KeyMod::None}, ToggleTerminal, InputContext::Global);
+        mapper_.bind({SDLK_F12, KeyMod::None}, ToggleRenderStats, InputContext::Global);
 
         mapper_.bind({SDLK_TAB, KeyMod::Primary}, NextTab, InputContext::Editor);
         mapper_.bind({SDLK_TAB, KeyMod::PrimaryShift}, PrevTab, InputContext::Editor);
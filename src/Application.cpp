@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <format>
+#include <chrono>
 
 constexpr const char* APP_NAME = "DeadEditor";
 
@@ -167,32 +169,95 @@ void Application::run() {
     last_blink = SDL_GetTicks();
 
     while (running) {
-        file_tree.apply_pending_git_status();
+        if (file_tree.apply_pending_git_status()) {
+            damage.mark(Panel::FileTree);
+            damage.mark(Panel::TabBar);
+            damage.mark(Panel::StatusBar);
+        }
         file_tree.check_filesystem_changes();
-        file_tree.apply_filesystem_refresh();
+        if (file_tree.apply_filesystem_refresh()) {
+            damage.mark(Panel::FileTree);
+        }
 
+        wait_for_events();
         process_events();
         update();
         render();
     }
 }
 
+// Blocks until there is input or something else to show: the next cursor blink,
+// a poll of background work, or the file tree's next scan.
+void Application::wait_for_events() {
+    if (damage.any()) return;
+
+    // update() flips the cursor once more than CURSOR_BLINK_MS has passed.
+    Uint32 since_blink = std::min<Uint32>(SDL_GetTicks() - last_blink, CURSOR_BLINK_MS);
+    int timeout = CURSOR_BLINK_MS + 1 - static_cast<int>(since_blink);
+    if (has_background_work()) {
+        timeout = std::min(timeout, BACKGROUND_POLL_MS);
+    }
+    if (file_tree.is_loaded()) {
+        timeout = std::min(timeout, static_cast<int>(FileTree::FS_SCAN_INTERVAL_MS));
+    }
+    SDL_WaitEventTimeout(nullptr, timeout);
+}
+
+bool Application::has_background_work() const {
+    for (int i = 0; i < tab_bar.get_tab_count(); i++) {
+        const Tab* tab = tab_bar.get_tab(i);
+        if (tab && tab->editor && (tab->editor->is_loading() || tab->editor->is_saving())) return true;
+    }
+    if (const Editor* ed = tab_bar.get_active_editor(); ed && ed->has_pending_syntax()) return true;
+    if (show_terminal && terminal.is_running()) return true;
+    return search_overlay_.visible && search_overlay_.is_searching();
+}
+
 void Application::update() {
     command_bar.clear_just_confirmed();
+    // Runs ahead of every render: a mapped file truncated meanwhile, even from
+    // the built-in terminal with the window focused, must not be read past its end.
+    check_files_on_disk(true);
+    poll_loading_tabs();
+    poll_saving_tabs();
     toast_manager.update();
 
+    // Toasts fade out continuously, and whatever they covered shows again once they go.
+    SDL_Rect toast_bounds = toast_manager.bounds(window_w, window_h);
+    damage.mark_rect(last_toast_bounds);
+    damage.mark_rect(toast_bounds);
+    last_toast_bounds = toast_bounds;
+
     if (show_terminal) {
         terminal.update();
         if (!terminal.is_running()) {
             show_terminal = false;
             focus = focus_before_terminal;
+            damage.mark_all();
+        } else if (terminal.needs_redraw) {
+            damage.mark(Panel::Terminal);
         }
     }
 
+    bool search_running = search_overlay_.visible && search_overlay_.is_searching();
+    if (search_running || search_was_running) {
+        damage.mark_all();
+    }
+    search_was_running = search_running;
+
+    if (Editor* ed = tab_bar.get_active_editor()) {
+        if (ed->update_syntax()) damage.mark(Panel::Editor);
+        if (ed->is_scrolling()) damage.mark(Panel::Editor);
+        ed->update_highlight_occurrences();
+    }
+
     Uint32 now = SDL_GetTicks();
     if (now - last_blink > CURSOR_BLINK_MS) {
         cursor_visible = !cursor_visible;
         last_blink = now;
+        if (focus == FocusPanel::Editor) damage.mark(Panel::Editor);
+        if (focus == FocusPanel::FileTree) damage.mark(Panel::FileTree);
+        if (command_bar.is_active()) damage.mark(Panel::CommandBar);
     }
 
     ensure_cursor_visible();
@@ -201,12 +266,26 @@ void Application::update() {
 void Application::process_events() {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
+        // Keys, clicks and window changes can reach any panel. The pointer
+        // moves and scrolls far more often and only touches what it is over.
+        if (event.type == SDL_MOUSEMOTION || event.type == SDL_MOUSEWHEEL) {
+            mark_pointer_damage(event);
+        } else {
+            damage.mark_all();
+        }
         switch (event.type) {
             case SDL_QUIT:
                 running = false;
                 break;
             case SDL_WINDOWEVENT:
                 handle_window_resize(event);
+                // Another program may have changed an open file while the window was in the background.
+                if (event.window.event == SDL_WINDOWEVENT_FOCUS_GAINED) {
+                    check_files_on_disk(false);
+                }
+                break;
+            case SDL_RENDER_DEVICE_RESET:
+                frame_texture.reset();
                 break;
             case SDL_KEYDOWN:
                 dispatch_key_event(event);
@@ -224,6 +303,39 @@ void Application::process_events() {
     }
 }
 
+void Application::mark_pointer_damage(const SDL_Event& event) {
+    // Floating menus and overlays draw across panels, and dragging a border resizes them.
+    if (dragging.terminal || dragging.tree || context_menu.is_open() || menu_bar.is_open() ||
+        search_overlay_.visible) {
+        damage.mark_all();
+        return;
+    }
+
+    int x = event.type == SDL_MOUSEMOTION ? event.motion.x : 0;
+    int y = event.type == SDL_MOUSEMOTION ? event.motion.y : 0;
+    if (event.type == SDL_MOUSEWHEEL) SDL_GetMouseState(&x, &y);
+    Panel panel = compute_panel_rects().at(layout.mouse_x(x), layout.mouse_y(y));
+
+    if (event.type == SDL_MOUSEWHEEL) {
+        // Scrolling anywhere without a scrollable panel of its own scrolls the editor.
+        bool own_scroll = panel == Panel::Terminal || panel == Panel::TabBar || panel == Panel::FileTree;
+        damage.mark(own_scroll ? panel : Panel::Editor);
+        return;
+    }
+
+    // Hover highlights clear in the panel the pointer left.
+    if (panel != Panel::Count) damage.mark(panel);
+    if (hovered_panel != Panel::Count && hovered_panel != panel) damage.mark(hovered_panel);
+    hovered_panel = panel;
+
+    // A drag selection moves the cursor, which the status bar reports.
+    const Editor* ed = tab_bar.get_active_editor();
+    if (dragging.editor || (ed && ed->is_scrollbar_dragging())) {
+        damage.mark(Panel::Editor);
+        damage.mark(Panel::StatusBar);
+    }
+}
+
 void Application::handle_window_resize(const SDL_Event& event) {
     if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
         SDL_GetRendererOutputSize(renderer.get(), &window_w, &window_h);
@@ -347,6 +459,7 @@ void Application::setup_actions() {
             if (show_terminal) focus = FocusPanel::Terminal;
         },
         .toggle_terminal = [this]() { toggle_terminal(); },
+        .toggle_render_stats = [this]() { show_render_stats = !show_render_stats; },
         .next_tab = [this]() {
             tab_bar.next_tab();
             tab_bar.ensure_tab_visible(window_w - get_tree_width());
@@ -451,11 +564,18 @@ void Application::handle_command_bar_key(const SDL_Event& event) {
             case CommandMode::SavePrompt: {
                 int pending = tab_bar.get_pending_close_tab();
                 if (result.input == "save" && pending >= 0) {
+                    bool saved = true;
                     if (Tab* tab = tab_bar.get_tab_mut(pending)) {
-                        if (tab->editor) tab->editor->save_file();
+                        if (tab->editor) {
+                            auto save_result = tab->editor->save_file();
+                            saved = save_result.has_value();
+                            if (!saved && !save_result.error().empty()) {
+                                toast_manager.show_error("Save Failed", save_result.error());
+                            }
+                        }
                         file_tree.refresh_git_status_async();
                     }
-                    tab_bar.close_tab(pending);
+                    if (saved) tab_bar.close_tab(pending);
                 } else if (result.input == "discard" && pending >= 0) {
                     tab_bar.close_tab(pending);
                 }
@@ -858,82 +978,162 @@ void Application::dispatch_mouse_event(const SDL_Event& event) {
 }
 
 void Application::render() {
-    SDL_SetRenderDrawColor(renderer.get(), Colors::BG.r, Colors::BG.g, Colors::BG.b, 255);
-    SDL_RenderClear(renderer.get());
+    ensure_frame_texture();
+    if (!damage.any()) return;
+    // The back buffer does not survive a present, so without a frame texture
+    // every frame is drawn whole.
+    if (!frame_texture) damage.mark_all();
+
+    RenderQueue& queue = texture_cache.render_queue;
+    PanelRects panels = compute_panel_rects();
+    damage.take_regions(panels, window_w, window_h, damage_regions);
+
+    if (frame_texture) SDL_SetRenderTarget(renderer.get(), frame_texture.get());
+    for (const SDL_Rect& region : damage_regions) {
+        queue.set_base_clip(&region);
+        render_region(region, panels);
+    }
+    queue.set_base_clip(nullptr);
+    queue.flush();
 
-    int line_h = font_manager.get_line_height();
-    int tree_w = get_tree_width();
-    int tab_h = tab_bar.has_tabs() ? layout.tab_bar_height : 0;
+    if (frame_texture) {
+        SDL_SetRenderTarget(renderer.get(), nullptr);
+        queue.copy(frame_texture.get(), nullptr, {0, 0, window_w, window_h});
+    }
+    queue.end_frame();
+    SDL_RenderPresent(renderer.get());
+}
 
-    int status_bar_y = window_h - layout.status_bar_height;
-    int term_h = show_terminal ? terminal_height : 0;
-    int terminal_y = status_bar_y - term_h;
-    int cmd_h = command_bar.is_active() ? layout.search_bar_height : 0;
-    int command_bar_y = terminal_y - cmd_h;
-    int content_y = layout.menu_bar_height + tab_h;
-    int content_h = command_bar_y - content_y;
+// Draws every panel that reaches into region; the queue's base clip keeps
+// their drawing inside it.
+void Application::render_region(const SDL_Rect& region, const PanelRects& panels) {
+    RenderQueue& queue = texture_cache.render_queue;
+    auto touches = [&](Panel panel) { return SDL_HasIntersection(&panels[panel], &region) == SDL_TRUE; };
+
+    queue.set_color(Colors::BG.r, Colors::BG.g, Colors::BG.b, 255);
+    queue.fill_rect(region);
+
+    int line_h = font_manager.get_line_height();
+    const SDL_Rect& tree = panels[Panel::FileTree];
+    const SDL_Rect& content = panels[Panel::Editor];
+    const SDL_Rect& command = panels[Panel::CommandBar];
+    const SDL_Rect& term = panels[Panel::Terminal];
 
     Editor* ed = tab_bar.get_active_editor();
-    if (ed) ed->update_highlight_occurrences();
 
-    menu_bar.render(renderer.get(), texture_cache, window_w, line_h);
+    if (touches(Panel::MenuBar)) {
+        menu_bar.render(queue, texture_cache, window_w, line_h);
+    }
 
-    if (file_tree.is_loaded()) {
+    if (file_tree.is_loaded() && touches(Panel::FileTree)) {
         std::string cur_path = ed ? ed->get_file_path() : "";
-        file_tree.render(renderer.get(), font_manager.get(), texture_cache,
-                        0, layout.menu_bar_height, tree_w, command_bar_y - layout.menu_bar_height, line_h,
+        file_tree.render(queue, font_manager.get(), texture_cache,
+                        tree.x, tree.y, tree.w, tree.h, line_h,
                         focus == FocusPanel::FileTree, cursor_visible, cur_path);
     }
 
-    if (tab_bar.has_tabs()) {
-        tab_bar.render(renderer.get(), texture_cache, tree_w, layout.menu_bar_height,
-                      window_w - tree_w, line_h, file_tree.is_loaded() ? &file_tree : nullptr);
+    if (tab_bar.has_tabs() && touches(Panel::TabBar)) {
+        tab_bar.render(queue, texture_cache, content.x, layout.menu_bar_height,
+                      window_w - content.x, line_h, file_tree.is_loaded() ? &file_tree : nullptr);
     }
 
-    if (ed) {
-        ed->render(renderer.get(), font_manager.get(), texture_cache,
+    if (ed && touches(Panel::Editor)) {
+        ed->render(queue, font_manager.get(), texture_cache,
                   command_bar.get_search_query(),
-                  tree_w, content_y,
-                  window_w - tree_w, content_h,
+                  content.x, content.y,
+                  content.w, content.h,
                   window_w, font_manager.get_char_width(),
                   focus == FocusPanel::Editor, tab_bar.has_tabs(), cursor_visible,
                   layout,
                   [this](TokenType t) { return get_syntax_color(t); });
     }
 
-    command_bar.render(renderer.get(), font_manager.get(), texture_cache,
-                      0, command_bar_y, window_w, line_h, cursor_visible);
+    if (touches(Panel::CommandBar)) {
+        command_bar.render(queue, font_manager.get(), texture_cache,
+                          0, command.y, window_w, line_h, cursor_visible);
+    }
 
-    EditorStatus status;
-    if (ed) {
-        status.file_path = ed->get_file_path();
-        status.modified = ed->is_modified();
-        status.cursor_pos = ed->cursor_pos();
-        status.total_lines = static_cast<int>(ed->get_lines().size());
+    if (touches(Panel::StatusBar)) {
+        EditorStatus status;
+        if (ed) {
+            status.file_path = ed->get_file_path();
+            status.modified = ed->is_modified();
+            status.cursor_pos = ed->cursor_pos();
+            status.total_lines = static_cast<int>(ed->get_lines().size());
+            status.format = ed->get_text_format().describe();
+            status.undo_bytes = ed->get_undo_memory();
+        }
+        if (show_render_stats) {
+            RenderStats stats;
+            stats.draw_calls = queue.last_frame_draw_calls();
+            stats.glyph_uploads = texture_cache.glyph_atlas.upload_count();
+            if (ed) {
+                stats.highlight_hit_rate = ed->highlighter().highlight_cache_stats().hit_rate();
+                stats.token_arena_growths = ed->token_arena_growth_count();
+            }
+            status.render_stats = stats;
+        }
+        command_bar.render_status_bar(queue, texture_cache,
+                                      0, panels[Panel::StatusBar].y, window_w, line_h, status, file_tree.git_branch);
     }
-    command_bar.render_status_bar(renderer.get(), texture_cache,
-                                  0, status_bar_y, window_w, line_h, status, file_tree.git_branch);
 
-    if (show_terminal && terminal.is_running()) {
-        SDL_SetRenderDrawColor(renderer.get(), 18, 18, 22, 255);
-        SDL_Rect term_bg = {0, terminal_y, window_w, terminal_height};
-        SDL_RenderFillRect(renderer.get(), &term_bg);
+    if (show_terminal && terminal.is_running() && touches(Panel::Terminal)) {
+        queue.set_color(18, 18, 22, 255);
+        queue.fill_rect(term);
 
-        SDL_SetRenderDrawColor(renderer.get(), 60, 60, 70, 255);
-        SDL_RenderDrawLine(renderer.get(), 0, terminal_y, window_w, terminal_y);
+        queue.set_color(60, 60, 70, 255);
+        queue.draw_line(0, term.y, window_w, term.y);
 
-        terminal.render(renderer.get(), font_manager.get(), layout.padding, terminal_y + layout.padding,
-                       window_w - layout.padding * 2, terminal_height - layout.padding * 2);
+        terminal.render(queue, texture_cache, layout.padding, term.y + layout.padding,
+                       window_w - layout.padding * 2, term.h - layout.padding * 2);
     }
 
-    menu_bar.render_dropdown_overlay(renderer.get(), texture_cache, line_h);
-    context_menu.render(renderer.get(), texture_cache, line_h);
+    menu_bar.render_dropdown_overlay(queue, texture_cache, line_h);
+    context_menu.render(queue, texture_cache, line_h);
 
-    search_overlay_.render(renderer.get(), layout, texture_cache, font_manager.get(), window_w, window_h);
+    search_overlay_.render(queue, layout, texture_cache, font_manager.get(), window_w, window_h);
 
-    toast_manager.render(renderer.get(), texture_cache, window_w, window_h, line_h);
+    toast_manager.render(queue, texture_cache, window_w, window_h, line_h);
+}
 
-    SDL_RenderPresent(renderer.get());
+PanelRects Application::compute_panel_rects() const {
+    int tree_w = get_tree_width();
+    int tab_h = tab_bar.has_tabs() ? layout.tab_bar_height : 0;
+
+    int status_bar_y = window_h - layout.status_bar_height;
+    int term_h = show_terminal ? terminal_height : 0;
+    int terminal_y = status_bar_y - term_h;
+    int cmd_h = command_bar.is_active() ? layout.search_bar_height : 0;
+    int command_bar_y = terminal_y - cmd_h;
+    int content_y = layout.menu_bar_height + tab_h;
+
+    PanelRects panels;
+    panels[Panel::MenuBar] = {0, 0, window_w, layout.menu_bar_height};
+    panels[Panel::FileTree] = {0, layout.menu_bar_height, tree_w, command_bar_y - layout.menu_bar_height};
+    panels[Panel::TabBar] = {tree_w, layout.menu_bar_height, window_w - tree_w, tab_h};
+    panels[Panel::Editor] = {tree_w, content_y, window_w - tree_w, command_bar_y - content_y};
+    panels[Panel::CommandBar] = {0, command_bar_y, window_w, cmd_h};
+    panels[Panel::StatusBar] = {0, status_bar_y, window_w, layout.status_bar_height};
+    panels[Panel::Terminal] = {0, terminal_y, window_w, term_h};
+    return panels;
+}
+
+void Application::ensure_frame_texture() {
+    int tex_w = 0;
+    int tex_h = 0;
+    if (frame_texture) {
+        SDL_QueryTexture(frame_texture.get(), nullptr, nullptr, &tex_w, &tex_h);
+        if (tex_w == window_w && tex_h == window_h) return;
+        frame_texture.reset();
+    }
+    if (!SDL_RenderTargetSupported(renderer.get())) return;
+
+    frame_texture.reset(SDL_CreateTexture(renderer.get(), SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                          window_w, window_h));
+    if (frame_texture) {
+        SDL_SetTextureBlendMode(frame_texture.get(), SDL_BLENDMODE_NONE);
+    }
+    damage.mark_all();
 }
 
 bool Application::action_open_file(const std::string& path) {
@@ -943,6 +1143,10 @@ bool Application::action_open_file(const std::string& path) {
         focus = FocusPanel::Editor;
         update_title(path);
         texture_cache.invalidate_all();
+        if (auto* ed = tab_bar.get_active_editor(); ed && ed->get_text_format().lossy) {
+            toast_manager.show_warning("Opened read-only",
+                                       "Invalid UTF-16 was replaced while decoding; saving would not round-trip");
+        }
         return true;
     }
     return false;
@@ -961,10 +1165,9 @@ void Application::action_open_folder(const std::string& path) {
 
 void Application::action_save_current() {
     if (auto* ed = tab_bar.get_active_editor()) {
-        if (ed->save_file()) {
-            tab_bar.update_active_title();
-            update_title(ed->get_file_path());
-            file_tree.refresh_git_status_async();
+        auto started = ed->save_file_async();
+        if (!started && !started.error().empty()) {
+            toast_manager.show_warning("Save", started.error());
         }
     }
 }
@@ -1094,7 +1297,7 @@ void Application::toggle_terminal() {
         if (!terminal.is_running()) {
             terminal.spawn(window_w - layout.padding * 2, terminal_height - layout.padding * 2,
                           font_manager.get_char_width(), font_manager.get_terminal_line_height(),
-                          &focus, renderer.get(), font_manager.get());
+                          &focus);
         }
         focus = FocusPanel::Terminal;
     } else {
@@ -1120,6 +1323,87 @@ void Application::update_title(const std::string& path) {
     SDL_SetWindowTitle(window.get(), title.c_str());
 }
 
+void Application::poll_loading_tabs() {
+    for (int i = 0; i < tab_bar.get_tab_count(); i++) {
+        Tab* tab = tab_bar.get_tab_mut(i);
+        if (!tab->editor || !tab->editor->is_loading()) continue;
+
+        if (tab->editor->poll_loading()) {
+            toast_manager.dismiss(tab->load_toast_id);
+            tab->load_toast_id = -1;
+            if (tab->editor->get_text_format().lossy) {
+                toast_manager.show_warning("Opened read-only",
+                                           "Some lines end in LF without CR; saving as CRLF would not round-trip");
+            }
+            damage.mark_all();
+            continue;
+        }
+        damage.mark(Panel::Editor);
+        damage.mark(Panel::StatusBar);
+
+        int percent = static_cast<int>(tab->editor->load_progress() * 100.0f);
+        std::string message = std::to_string(tab->editor->get_lines().size()) + " lines (" + std::to_string(percent) + "%)";
+        if (tab->load_toast_id < 0) {
+            tab->load_toast_id = toast_manager.show_progress("Opening " + tab->title, message);
+        }
+        toast_manager.update_progress(tab->load_toast_id, tab->editor->load_progress(), message);
+    }
+}
+
+void Application::poll_saving_tabs() {
+    for (int i = 0; i < tab_bar.get_tab_count(); i++) {
+        Tab* tab = tab_bar.get_tab_mut(i);
+        if (!tab->editor || !tab->editor->is_saving()) continue;
+
+        auto result = tab->editor->poll_save();
+        if (!result) continue;
+        damage.mark(Panel::TabBar);
+        damage.mark(Panel::StatusBar);
+        if (!*result) {
+            toast_manager.show_error("Save Failed", result->error());
+            continue;
+        }
+
+        tab->update_title();
+        if (tab->editor.get() == tab_bar.get_active_editor()) {
+            update_title(tab->editor->get_file_path());
+        }
+        file_tree.refresh_git_status_async();
+
+        const SaveStats& stats = **result;
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(stats.elapsed).count();
+        if (elapsed_ms >= SAVE_REPORT_MIN_MS) {
+            toast_manager.show_info("Saved " + tab->title, std::format("{:.1f} MB in {} ms ({:.0f} MB/s)",
+                static_cast<double>(stats.bytes) / (1024.0 * 1024.0), elapsed_ms, stats.megabytes_per_second()));
+        }
+    }
+}
+
+void Application::check_files_on_disk(bool truncation_only) {
+    for (int i = 0; i < tab_bar.get_tab_count(); i++) {
+        Tab* tab = tab_bar.get_tab_mut(i);
+        if (!tab->editor) continue;
+
+        size_t lost_lines = 0;
+        switch (tab->editor->check_file_on_disk(lost_lines, truncation_only)) {
+            case Editor::DiskChange::None:
+                continue;
+            case Editor::DiskChange::Reloaded:
+                toast_manager.show_info("Reloaded " + tab->title, "The file changed on disk");
+                break;
+            case Editor::DiskChange::Detached:
+                if (lost_lines > 0) {
+                    toast_manager.show_warning("Changed on disk: " + tab->title,
+                        std::format("The file was truncated; {} lines past its new end were lost", lost_lines));
+                } else {
+                    toast_manager.show_warning("Changed on disk: " + tab->title, "Kept your unsaved edits");
+                }
+                break;
+        }
+        damage.mark_all();
+    }
+}
+
 void Application::ensure_cursor_visible() {
     if (!cursor_moved) return;
 
@@ -1130,8 +1414,9 @@ void Application::ensure_cursor_visible() {
         int tree_w = get_tree_width();
         int visible_w = window_w - tree_w - layout.gutter_width - layout.padding;
         int cursor_px = 0;
-        if (ed->get_cursor_col() > 0 && !ed->get_lines()[ed->get_cursor_line()].empty()) {
-            std::string expanded = expand_tabs(ed->get_lines()[ed->get_cursor_line()].substr(0, ed->get_cursor_col()));
+        std::string_view line = ed->get_lines().view(static_cast<size_t>(ed->get_cursor_line()));
+        if (ed->get_cursor_col() > 0 && !line.empty()) {
+            std::string expanded = expand_tabs(line.substr(0, ed->get_cursor_col()));
             TTF_SizeUTF8(font_manager.get(), expanded.c_str(), &cursor_px, nullptr);
         }
         ed->ensure_visible_x(cursor_px, visible_w, font_manager.get_char_width() * 2);
@@ -22,6 +22,8 @@
 #include "FileTreeActions.h"
 #include "Toast.h"
 #include "SearchOverlay.h"
+#include "DamageTracker.h"
+#include <vector>
 
 class Application {
 public:
@@ -34,14 +36,20 @@ private:
     void init_systems();
     void init_ui();
 
+    void wait_for_events();
     void process_events();
     void update();
     void render();
+    void render_region(const SDL_Rect& region, const PanelRects& panels);
+    PanelRects compute_panel_rects() const;
+    void ensure_frame_texture();
+    bool has_background_work() const;
 
     void dispatch_key_event(const SDL_Event& event);
     void dispatch_mouse_event(const SDL_Event& event);
     void dispatch_text_input(const SDL_Event& event);
     void handle_window_resize(const SDL_Event& event);
+    void mark_pointer_damage(const SDL_Event& event);
 
     void handle_command_bar_key(const SDL_Event& event);
     void setup_keybindings();
@@ -60,6 +68,9 @@ private:
     void toggle_focus();
     void update_title(const std::string& path = "");
     void ensure_cursor_visible();
+    void poll_loading_tabs();
+    void poll_saving_tabs();
+    void check_files_on_disk(bool truncation_only);
     void on_search_result_selected(const SearchResult& result);
 
     SDL_Color get_syntax_color(TokenType type);
@@ -74,6 +85,13 @@ private:
 
     WindowPtr window;
     RendererPtr renderer;
+    // Holds the last frame so only damaged regions are redrawn; null if the
+    // renderer cannot draw to textures, in which case every frame is full.
+    TexturePtr frame_texture;
+    DamageTracker damage;
+    std::vector<SDL_Rect> damage_regions;
+    SDL_Rect last_toast_bounds = {0, 0, 0, 0};
+    bool search_was_running = false;
     CursorPtr cursor_arrow;
     CursorPtr cursor_resize_ns;
     CursorPtr cursor_resize_ew;
@@ -93,6 +111,7 @@ private:
     FocusPanel focus_before_terminal = FocusPanel::Editor;
 
     bool show_terminal = false;
+    bool show_render_stats = false;
     int terminal_height = 0;
     int tree_width = 0;
 
@@ -102,6 +121,9 @@ private:
         bool editor = false;
     } dragging;
 
+    // Panel under the pointer as of the last motion event.
+    Panel hovered_panel = Panel::Count;
+
     bool menu_click_consumed = false;
     bool cursor_moved = false;
 
@@ -0,0 +1,291 @@
+#include "AtomicSave.h"
+#include <sys/stat.h>
+#include <sys/uio.h>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/xattr.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t IOV_BATCH = 1024;
+constexpr size_t UTF16_FLUSH_BYTES = size_t{1} << 20;
+
+std::string errno_message(const std::string& what, const std::filesystem::path& path) {
+    return what + " " + path.string() + ": " + std::strerror(errno);
+}
+
+bool write_all(int fd, std::vector<iovec>& iov) {
+    size_t i = 0;
+    while (i < iov.size()) {
+        int count = static_cast<int>(std::min<size_t>(iov.size() - i, IOV_MAX));
+        ssize_t written = writev(fd, iov.data() + i, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        size_t remaining = static_cast<size_t>(written);
+        while (remaining > 0 && remaining >= iov[i].iov_len) {
+            remaining -= iov[i].iov_len;
+            i++;
+        }
+        if (remaining > 0) {
+            iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + remaining;
+            iov[i].iov_len -= remaining;
+        }
+    }
+    iov.clear();
+    return true;
+}
+
+// True when `line` sits right after `end` with only the separator in between.
+// The separator bytes are compared one at a time so nothing past a
+// std::string's terminator is read.
+bool follows_in_memory(const char* end, std::string_view line, std::string_view separator) {
+    if (line.data() != end + separator.size()) return false;
+    for (size_t i = 0; i < separator.size(); ++i) {
+        if (end[i] != separator[i]) return false;
+    }
+    return true;
+}
+
+bool sync_fd(int fd) {
+#ifdef __APPLE__
+    if (fcntl(fd, F_FULLFSYNC) == 0) return true;
+#endif
+    return fsync(fd) == 0;
+}
+
+bool write_lines(int fd, const LineStore& lines, const TextFormat& format, size_t& bytes) {
+    std::string_view separator = format.line_separator();
+    std::vector<iovec> iov;
+    iov.reserve(IOV_BATCH);
+    bool first = true;
+    bool failed = false;
+
+    if (format.is_utf16()) {
+        bool big_endian = format.encoding == TextEncoding::Utf16BE;
+        std::string buffer;
+        buffer.reserve(UTF16_FLUSH_BYTES + UTF16_FLUSH_BYTES / 8);
+        if (format.bom) append_utf16(buffer, "\uFEFF", big_endian);
+
+        auto flush = [&]() {
+            bytes += buffer.size();
+            iov.push_back({buffer.data(), buffer.size()});
+            failed = !write_all(fd, iov);
+            buffer.clear();
+        };
+
+        lines.for_each_view([&](std::string_view line) {
+            if (failed) return;
+            if (!first) append_utf16(buffer, separator, big_endian);
+            append_utf16(buffer, line, big_endian);
+            first = false;
+            if (buffer.size() >= UTF16_FLUSH_BYTES) flush();
+        });
+        if (!failed) flush();
+    } else {
+        static const char utf8_bom[] = "\xEF\xBB\xBF";
+        if (format.bom) {
+            iov.push_back({const_cast<char*>(utf8_bom), 3});
+            bytes += 3;
+        }
+
+        // Adjacent views that are contiguous in memory (untouched mapped lines)
+        // collapse into a single iovec, so clean regions go out as one span.
+        bool last_is_line = false;
+        lines.for_each_view([&](std::string_view line) {
+            if (failed) return;
+            bytes += line.size() + (first ? 0 : separator.size());
+
+            if (!first && last_is_line) {
+                iovec& last = iov.back();
+                if (follows_in_memory(static_cast<const char*>(last.iov_base) + last.iov_len, line, separator)) {
+                    last.iov_len += separator.size() + line.size();
+                    return;
+                }
+            }
+
+            last_is_line = false;
+            if (!first) {
+                iov.push_back({const_cast<char*>(separator.data()), separator.size()});
+            }
+            if (!line.empty()) {
+                iov.push_back({const_cast<char*>(line.data()), line.size()});
+                last_is_line = true;
+            }
+            first = false;
+
+            if (iov.size() >= IOV_BATCH) {
+                failed = !write_all(fd, iov);
+                last_is_line = false;
+            }
+        });
+    }
+
+    return !failed && write_all(fd, iov);
+}
+
+int create_temp_file(const std::filesystem::path& target, std::filesystem::path& out_path) {
+    std::random_device rd;
+    std::string base = "." + target.filename().string() + ".";
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        out_path = target.parent_path() / (base + std::to_string(rd()) + ".tmp");
+        int fd = ::open(out_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd >= 0 || errno != EEXIST) return fd;
+    }
+    return -1;
+}
+
+// Best effort: attributes the caller may not set, such as security labels, stay behind.
+void copy_xattrs(int from, int to) {
+#if defined(__linux__) || defined(__APPLE__)
+#ifdef __APPLE__
+    ssize_t list_size = flistxattr(from, nullptr, 0, 0);
+#else
+    ssize_t list_size = flistxattr(from, nullptr, 0);
+#endif
+    if (list_size <= 0) return;
+
+    std::vector<char> names(static_cast<size_t>(list_size));
+    std::vector<char> value;
+#ifdef __APPLE__
+    list_size = flistxattr(from, names.data(), names.size(), 0);
+#else
+    list_size = flistxattr(from, names.data(), names.size());
+#endif
+    if (list_size <= 0) return;
+
+    for (const char* name = names.data(); name < names.data() + list_size; name += std::strlen(name) + 1) {
+#ifdef __APPLE__
+        ssize_t size = fgetxattr(from, name, nullptr, 0, 0, 0);
+        if (size < 0) continue;
+        value.resize(static_cast<size_t>(size));
+        size = fgetxattr(from, name, value.data(), value.size(), 0, 0);
+        if (size >= 0) fsetxattr(to, name, value.data(), static_cast<size_t>(size), 0, 0);
+#else
+        ssize_t size = fgetxattr(from, name, nullptr, 0);
+        if (size < 0) continue;
+        value.resize(static_cast<size_t>(size));
+        size = fgetxattr(from, name, value.data(), value.size());
+        if (size >= 0) fsetxattr(to, name, value.data(), static_cast<size_t>(size), 0);
+#endif
+    }
+#endif
+}
+
+bool overwrites_in_place(const std::filesystem::path& target, const struct stat& st) {
+    std::filesystem::path dir = target.parent_path().empty() ? "." : target.parent_path();
+    if (access(dir.c_str(), W_OK) != 0) return true;
+    if (st.st_nlink > 1) return true;
+    // Only root can hand the replacement back to the original owner.
+    return st.st_uid != geteuid() && geteuid() != 0;
+}
+
+bool reads_from(const LineStore& lines, const std::filesystem::path& target) {
+    const MappedFile* file = lines.backing_file();
+    return file && file->is_same_file(target);
+}
+
+std::filesystem::path resolve_target(const std::filesystem::path& path) {
+    std::error_code ec;
+    std::filesystem::path target = std::filesystem::weakly_canonical(path, ec);
+    return ec ? path : target;
+}
+
+}
+
+bool save_overwrites_in_place(const std::filesystem::path& path) {
+    std::filesystem::path target = resolve_target(path);
+    struct stat st;
+    return stat(target.c_str(), &st) == 0 && overwrites_in_place(target, st);
+}
+
+std::expected<SaveStats, std::string> save_lines_atomic(const std::filesystem::path& path, const LineStore& lines,
+                                                       const TextFormat& format) {
+    auto started = std::chrono::steady_clock::now();
+    std::filesystem::path target = resolve_target(path);
+
+    struct stat st;
+    bool exists = stat(target.c_str(), &st) == 0;
+    bool in_place = exists && overwrites_in_place(target, st);
+
+    std::filesystem::path temp_path;
+    int fd = -1;
+    if (!in_place) {
+        fd = create_temp_file(target, temp_path);
+        // Truncating the original on, say, a full disk would lose both versions.
+        if (fd < 0) {
+            return std::unexpected(errno_message("Failed to create temporary file for", target));
+        }
+    }
+
+    if (in_place) {
+        if (reads_from(lines, target)) {
+            return std::unexpected("Cannot overwrite " + target.string() + " in place while reading from it");
+        }
+        fd = ::open(target.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+        if (fd < 0) {
+            return std::unexpected(errno_message("Failed to open", target));
+        }
+    }
+
+    auto fail = [&](const std::string& what) {
+        std::string message = errno_message(what, target);
+        ::close(fd);
+        if (!in_place) ::unlink(temp_path.c_str());
+        return std::unexpected(message);
+    };
+
+    if (exists && !in_place) {
+        // The group is kept where the user belongs to it; the owner was checked above.
+        if ((st.st_uid != geteuid() || st.st_gid != getegid()) && fchown(fd, st.st_uid, st.st_gid) != 0) {
+            (void)fchown(fd, static_cast<uid_t>(-1), st.st_gid);
+        }
+        if (fchmod(fd, st.st_mode & 07777) != 0) {
+            return fail("Failed to copy permissions of");
+        }
+        int original = ::open(target.c_str(), O_RDONLY | O_CLOEXEC);
+        if (original >= 0) {
+            copy_xattrs(original, fd);
+            ::close(original);
+        }
+    }
+
+    size_t bytes = 0;
+    if (!write_lines(fd, lines, format, bytes)) {
+        return fail("Failed to write");
+    }
+    if (!sync_fd(fd)) {
+        return fail("Failed to sync");
+    }
+    if (::close(fd) != 0) {
+        std::string message = errno_message("Failed to close", target);
+        if (!in_place) ::unlink(temp_path.c_str());
+        return std::unexpected(message);
+    }
+    if (in_place) {
+        return SaveStats{bytes, std::chrono::steady_clock::now() - started};
+    }
+    if (::rename(temp_path.c_str(), target.c_str()) != 0) {
+        std::string message = errno_message("Failed to replace", target);
+        ::unlink(temp_path.c_str());
+        return std::unexpected(message);
+    }
+
+    int dir_fd = ::open(target.parent_path().empty() ? "." : target.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        sync_fd(dir_fd);
+        ::close(dir_fd);
+    }
+
+    return SaveStats{bytes, std::chrono::steady_clock::now() - started};
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "LineStore.h"
+#include "TextFormat.h"
+#include <chrono>
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <string>
+
+struct SaveStats {
+    size_t bytes = 0;
+    std::chrono::steady_clock::duration elapsed{};
+
+    double megabytes_per_second() const {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        return seconds > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+};
+
+// Writes the lines in `format` (encoding, BOM, line separator) to a temporary
+// file next to `path`, fsyncs it and renames it over `path`, so a crash leaves
+// either the old or the new contents. Symlinks are followed and the target's
+// permissions, owner and extended attributes are copied to the replacement.
+//
+// When the file cannot be replaced without losing something (see
+// save_overwrites_in_place), it is truncated and rewritten in place instead,
+// which is not crash safe. That fails if `lines` are still read from the
+// file's own mapping. Any other failure to create the temporary file is
+// returned as is and leaves the original untouched.
+std::expected<SaveStats, std::string> save_lines_atomic(const std::filesystem::path& path, const LineStore& lines,
+                                                       const TextFormat& format);
+
+// True when `path` exists and replacing it would break it: its directory is not
+// writable, it has other hard links, or it belongs to another user.
+bool save_overwrites_in_place(const std::filesystem::path& path);
@@ -5,6 +5,7 @@
 #include <string>
 #include <format>
 #include <functional>
+#include <optional>
 #include "Types.h"
 #include "Constants.h"
 #include "Layout.h"
@@ -16,11 +17,22 @@ enum class CommandMode { None, Search, GoTo, Create, Delete, SavePrompt, Rename,
 
 enum class CommandAction { None, Confirm, Cancel, FindNext };
 
+struct RenderStats {
+    int draw_calls = 0;
+    size_t glyph_uploads = 0;
+    double highlight_hit_rate = 0.0;
+    size_t token_arena_growths = 0;
+};
+
 struct EditorStatus {
     std::string file_path;
     bool modified = false;
     TextPos cursor_pos;
     LineIdx total_lines = 0;
+    std::string format;
+    size_t undo_bytes = 0;
+    // Set only while render statistics are toggled on.
+    std::optional<RenderStats> render_stats;
 };
 
 struct CommandKeyResult {
@@ -260,16 +272,16 @@ public:
         return result;
     }
 
-    void render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& texture_cache,
+    void render(RenderQueue& queue, TTF_Font* font, TextureCache& texture_cache,
                 int x, int y, int width, int line_height, bool cursor_visible) {
         if (mode == CommandMode::None) return;
 
         SDL_Color bg_color = (mode == CommandMode::Delete || mode == CommandMode::SavePrompt)
             ? SDL_Color{80, 60, 40, 255}
             : Colors::SEARCH_BG;
-        SDL_SetRenderDrawColor(renderer, bg_color.r, bg_color.g, bg_color.b, 255);
+        queue.set_color(bg_color.r, bg_color.g, bg_color.b, 255);
         SDL_Rect bar = {x, y, width, L->search_bar_height};
-        SDL_RenderFillRect(renderer, &bar);
+        queue.fill_rect(bar);
 
         int text_y = y + (L->search_bar_height - line_height) / 2;
         const std::string& label = get_label();
@@ -278,23 +290,34 @@ public:
         if (cursor_visible && mode != CommandMode::Delete && mode != CommandMode::SavePrompt) {
             int label_w = 0;
             TTF_SizeUTF8(font, label.c_str(), &label_w, nullptr);
-            SDL_SetRenderDrawColor(renderer, Colors::CURSOR.r, Colors::CURSOR.g, Colors::CURSOR.b, 255);
+            queue.set_color(Colors::CURSOR.r, Colors::CURSOR.g, Colors::CURSOR.b, 255);
             SDL_Rect cursor = {x + L->padding + label_w, text_y, L->scaled(2), line_height};
-            SDL_RenderFillRect(renderer, &cursor);
+            queue.fill_rect(cursor);
         }
     }
 
-    void render_status_bar(SDL_Renderer* renderer, TextureCache& texture_cache,
+    void render_status_bar(RenderQueue& queue, TextureCache& texture_cache,
                            int x, int y, int width, int line_height,
                            const EditorStatus& status, const std::string& git_branch) {
-        SDL_SetRenderDrawColor(renderer, Colors::GUTTER.r, Colors::GUTTER.g, Colors::GUTTER.b, 255);
+        queue.set_color(Colors::GUTTER.r, Colors::GUTTER.g, Colors::GUTTER.b, 255);
         SDL_Rect status_bar = {x, y, width, L->status_bar_height};
-        SDL_RenderFillRect(renderer, &status_bar);
+        queue.fill_rect(status_bar);
 
-        std::string status_text = std::format("{}{}    Ln {}/{}    Col {}",
+        std::string undo_text = status.undo_bytes >= (size_t{1} << 20)
+            ? std::format("Undo {:.1f} MB", static_cast<double>(status.undo_bytes) / (1 << 20))
+            : std::format("Undo {} KB", status.undo_bytes >> 10);
+
+        std::string status_text = std::format("{}{}    Ln {}/{}    Col {}    {}    {}",
             status.file_path.empty() ? "Untitled" : status.file_path.c_str(),
             status.modified ? " *" : "",
-            status.cursor_pos.line + 1, status.total_lines, status.cursor_pos.col + 1);
+            status.cursor_pos.line + 1, status.total_lines, status.cursor_pos.col + 1,
+            status.format, undo_text);
+        if (status.render_stats) {
+            const RenderStats& stats = *status.render_stats;
+            status_text += std::format("    Draw calls {}    Glyph uploads {}    Highlight cache {:.0f}%    Token growths {}",
+                                       stats.draw_calls, stats.glyph_uploads, stats.highlight_hit_rate * 100.0,
+                                       stats.token_arena_growths);
+        }
 
         int text_y = y + (L->status_bar_height - line_height) / 2;
         texture_cache.render_cached_text(status_text, Colors::LINE_NUM, x + L->padding, text_y);
@@ -1,6 +1,228 @@
 #include "CommandManager.h"
 #include "TextDocument.h"
 #include "EditorController.h"
+#include "UndoJournal.h"
+#include "Constants.h"
+#include <unordered_map>
+
+namespace {
+bool is_word_break(const std::string& before, const std::string& after) {
+    if (before.empty() || after.empty()) return false;
+    bool before_space = before.back() == ' ' || before.back() == '\t';
+    bool after_space = after.front() == ' ' || after.front() == '\t';
+    return before_space && !after_space;
+}
+}
+
+bool CommandManager::merge_into_last(const EditAction& action, bool extend_run) {
+    if (undo_stack.empty()) return false;
+    EditAction& last = undo_stack.back();
+    // Restored history never absorbs new edits, even as part of a typing run;
+    // replaying the journal still merges restored actions with each other.
+    bool last_restored = get_action_group_id(last) >= RESTORED_GROUP_BASE;
+    if (last_restored != (get_action_group_id(action) >= RESTORED_GROUP_BASE)) return false;
+    // A keystroke is alone in its group, and the record it joins holds nothing
+    // but keystrokes, so joining the run moves no action out of another group.
+    bool same_group = get_action_group_id(last) == get_action_group_id(action);
+    bool joins_run = !same_group && extend_run && run_open;
+    if (!same_group && !joins_run) return false;
+
+    if (auto* prev = std::get_if<InsertOp>(&last)) {
+        const auto* next = std::get_if<InsertOp>(&action);
+        if (!next || next->line != prev->end_line || next->col != prev->end_col) return false;
+        if (prev->text.find('\n') != std::string::npos || next->text.find('\n') != std::string::npos) return false;
+        if (joins_run && is_word_break(prev->text, next->text)) return false;
+
+        prev->text += next->text;
+        prev->end_line = next->end_line;
+        prev->end_col = next->end_col;
+        return true;
+    }
+
+    if (auto* prev = std::get_if<DeleteOp>(&last)) {
+        const auto* next = std::get_if<DeleteOp>(&action);
+        if (!next || next->line != prev->line || next->end_line != next->line || prev->end_line != prev->line) return false;
+        if (prev->deleted_text.find('\n') != std::string::npos || next->deleted_text.find('\n') != std::string::npos) return false;
+
+        if (next->end_col == prev->col) {
+            if (joins_run && is_word_break(next->deleted_text, prev->deleted_text)) return false;
+            prev->deleted_text.insert(0, next->deleted_text);
+            prev->col = next->col;
+            return true;
+        }
+        if (next->col == prev->col) {
+            if (joins_run && is_word_break(prev->deleted_text, next->deleted_text)) return false;
+            prev->deleted_text += next->deleted_text;
+            prev->end_col += next->end_col - next->col;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+CommandManager::CommandManager(size_t max_bytes) : max_bytes(max_bytes) {}
+
+CommandManager::~CommandManager() = default;
+
+void CommandManager::push(EditAction action, bool extend_run) {
+    ensure_restored();
+    if (journal) {
+        journal->append_push(action, extend_run);
+        // Past the cap the journal stops growing; the next checkpoint writes a compacted one.
+        if (journal->size() > UNDO_JOURNAL_MAX_BYTES) journal.reset();
+    }
+    apply_push(std::move(action), extend_run);
+}
+
+void CommandManager::apply_push(EditAction action, bool extend_run) {
+    for (const auto& undone : redo_stack) {
+        history_bytes -= get_action_memory(undone);
+    }
+    redo_stack.clear();
+
+    if (!undo_stack.empty()) {
+        size_t before = get_action_memory(undo_stack.back());
+        if (merge_into_last(action, extend_run)) {
+            history_bytes += get_action_memory(undo_stack.back()) - before;
+            run_open = run_open && extend_run;
+            return;
+        }
+    }
+
+    // Later keystrokes may only join a record made of keystrokes.
+    run_open = extend_run;
+    uint64_t group = get_action_group_id(action);
+    history_bytes += get_action_memory(action);
+    undo_stack.push_back(std::move(action));
+
+    while (history_bytes > max_bytes && get_action_group_id(undo_stack.front()) != group) {
+        evict_oldest_group();
+        journal_compact_pending = true;
+    }
+}
+
+void CommandManager::note_undo() {
+    run_open = false;
+    if (journal) journal->append_marker(UndoJournal::RecordKind::Undo);
+}
+
+void CommandManager::note_redo() {
+    run_open = false;
+    if (journal) journal->append_marker(UndoJournal::RecordKind::Redo);
+}
+
+void CommandManager::move_group(std::deque<EditAction>& from, std::deque<EditAction>& to) {
+    if (from.empty()) return;
+    uint64_t group = get_action_group_id(from.back());
+    while (!from.empty() && get_action_group_id(from.back()) == group) {
+        to.push_back(std::move(from.back()));
+        from.pop_back();
+    }
+}
+
+void CommandManager::attach_journal(std::filesystem::path path, std::future<uint64_t> content_hash) {
+    journal.reset();
+    journal_path = std::move(path);
+    pending_hash = std::move(content_hash);
+    restore_pending = !journal_path.empty();
+}
+
+void CommandManager::ensure_restored() {
+    if (!restore_pending) return;
+    restore_pending = false;
+    journal_hash = pending_hash.get();
+
+    std::vector<UndoJournal::Record> records = UndoJournal::read(journal_path);
+    size_t end = 0;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (records[i].kind == UndoJournal::RecordKind::Checkpoint && records[i].hash == journal_hash) {
+            end = i + 1;
+        }
+    }
+
+    // Restored groups get ids above anything EditorController hands out, so
+    // they can neither merge with nor be undone together with new edits.
+    std::unordered_map<uint64_t, uint64_t> groups;
+    auto remap = [&groups](EditAction& action) {
+        std::visit([&groups](auto& op) {
+            op.group_id = groups.try_emplace(op.group_id, RESTORED_GROUP_BASE + groups.size()).first->second;
+        }, action);
+    };
+
+    for (size_t i = 0; i < end; ++i) {
+        UndoJournal::Record& record = records[i];
+        switch (record.kind) {
+            case UndoJournal::RecordKind::Push:
+                remap(record.action);
+                apply_push(std::move(record.action), record.extend_run);
+                break;
+            case UndoJournal::RecordKind::Undo:
+                move_group(undo_stack, redo_stack);
+                run_open = false;
+                break;
+            case UndoJournal::RecordKind::Redo:
+                move_group(redo_stack, undo_stack);
+                run_open = false;
+                break;
+            case UndoJournal::RecordKind::Restore:
+                remap(record.action);
+                history_bytes += get_action_memory(record.action);
+                undo_stack.push_back(std::move(record.action));
+                break;
+            case UndoJournal::RecordKind::RestoreRedo:
+                remap(record.action);
+                history_bytes += get_action_memory(record.action);
+                redo_stack.push_back(std::move(record.action));
+                break;
+            case UndoJournal::RecordKind::Checkpoint:
+                break;
+        }
+    }
+
+    journal_compact_pending = false;
+    run_open = false;
+    journal = std::make_unique<UndoJournal>();
+    if (!journal->rewrite(journal_path, undo_stack, redo_stack, journal_hash)) {
+        journal.reset();
+    }
+}
+
+void CommandManager::checkpoint(const std::filesystem::path& path, uint64_t content_hash) {
+    ensure_restored();
+    if (path.empty()) return;
+
+    if (journal && journal->path() == path && !journal_compact_pending) {
+        journal->append_checkpoint(content_hash);
+        return;
+    }
+
+    // The content now matches the file, so the stacks alone are a complete
+    // journal; rewriting drops evicted groups and anything past the cap.
+    journal.reset();
+    journal_compact_pending = false;
+    if (history_bytes > UNDO_JOURNAL_MAX_BYTES) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        return;
+    }
+    journal = std::make_unique<UndoJournal>();
+    if (!journal->rewrite(path, undo_stack, redo_stack, content_hash)) {
+        journal.reset();
+    }
+}
+
+void CommandManager::clear() {
+    undo_stack.clear();
+    redo_stack.clear();
+    history_bytes = 0;
+    run_open = false;
+    journal.reset();
+    journal_path.clear();
+    pending_hash = {};
+    restore_pending = false;
+    journal_compact_pending = false;
+}
 
 void apply_action(InsertOp& op, TextDocument& doc, EditorController& ctrl) {
     TextPos end_pos;
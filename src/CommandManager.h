@@ -3,11 +3,17 @@
 #include "Types.h"
 #include <variant>
 #include <vector>
+#include <deque>
+#include <type_traits>
+#include <filesystem>
+#include <future>
+#include <memory>
 #include <string>
 #include <cstdint>
 
 class TextDocument;
 class EditorController;
+class UndoJournal;
 
 struct InsertOp {
     LineIdx line;
@@ -36,10 +42,23 @@ struct MoveLineOp {
 
 using EditAction = std::variant<InsertOp, DeleteOp, MoveLineOp>;
 
+// Group ids given to history read back from an UndoJournal.
+constexpr uint64_t RESTORED_GROUP_BASE = uint64_t{1} << 63;
+
 inline uint64_t get_action_group_id(const EditAction& action) {
     return std::visit([](const auto& op) { return op.group_id; }, action);
 }
 
+inline size_t get_action_memory(const EditAction& action) {
+    size_t text = std::visit([](const auto& op) -> size_t {
+        using T = std::decay_t<decltype(op)>;
+        if constexpr (std::is_same_v<T, InsertOp>) return op.text.size();
+        else if constexpr (std::is_same_v<T, DeleteOp>) return op.deleted_text.size();
+        else return 0;
+    }, action);
+    return sizeof(EditAction) + text;
+}
+
 void apply_action(InsertOp& op, TextDocument& doc, EditorController& ctrl);
 void apply_action(DeleteOp& op, TextDocument& doc, EditorController& ctrl);
 void apply_action(MoveLineOp& op, TextDocument& doc, EditorController& ctrl);
@@ -48,30 +67,73 @@ void revert_action(InsertOp& op, TextDocument& doc, EditorController& ctrl);
 void revert_action(DeleteOp& op, TextDocument& doc, EditorController& ctrl);
 void revert_action(MoveLineOp& op, TextDocument& doc, EditorController& ctrl);
 
+// Undo history capped by the memory its actions hold rather than by count.
+// The oldest groups are dropped from the front once the budget is exceeded;
+// the newest group is always kept, however large.
+//
+// Adjacent single-line inserts, or adjacent deletes, are folded into the
+// previous record when they belong to its group. A keystroke pushed with
+// extend_run must be alone in its group; it also joins the previous record
+// when that record holds nothing but such keystrokes, so a run of typing
+// undoes as one record, up to the next word boundary, without ever pulling
+// an action out of a larger group.
+//
+// With a journal attached, every operation is also appended to an on-disk
+// UndoJournal. The history it holds is only read back on the first undo,
+// redo or edit after attaching. Journaling pauses once the journal passes
+// UNDO_JOURNAL_MAX_BYTES, and the next checkpoint after that, or after
+// groups were evicted, rewrites it from the stacks.
 class CommandManager {
-    std::vector<EditAction> undo_stack;
-    std::vector<EditAction> redo_stack;
-    size_t max_history;
+    std::deque<EditAction> undo_stack;
+    std::deque<EditAction> redo_stack;
+    size_t max_bytes;
+    size_t history_bytes = 0;
 
-public:
-    explicit CommandManager(size_t max_size = 10000) : max_history(max_size) {}
+    std::unique_ptr<UndoJournal> journal;
+    std::filesystem::path journal_path;
+    std::future<uint64_t> pending_hash;
+    uint64_t journal_hash = 0;
+    bool restore_pending = false;
+    bool journal_compact_pending = false;
+    // The record on top of the undo stack holds only keystrokes pushed with extend_run.
+    bool run_open = false;
+
+    bool merge_into_last(const EditAction& action, bool extend_run);
+    void apply_push(EditAction action, bool extend_run);
+    void move_group(std::deque<EditAction>& from, std::deque<EditAction>& to);
 
-    void push(EditAction action) {
-        if (undo_stack.size() >= max_history) {
-            undo_stack.erase(undo_stack.begin());
+    void evict_oldest_group() {
+        uint64_t group = get_action_group_id(undo_stack.front());
+        while (!undo_stack.empty() && get_action_group_id(undo_stack.front()) == group) {
+            history_bytes -= get_action_memory(undo_stack.front());
+            undo_stack.pop_front();
         }
-        undo_stack.push_back(std::move(action));
-        redo_stack.clear();
     }
 
+public:
+    explicit CommandManager(size_t max_bytes);
+    ~CommandManager();
+
+    void push(EditAction action, bool extend_run = false);
+    void note_undo();
+    void note_redo();
+
     bool can_undo() const { return !undo_stack.empty(); }
     bool can_redo() const { return !redo_stack.empty(); }
 
-    std::vector<EditAction>& get_undo_stack() { return undo_stack; }
-    std::vector<EditAction>& get_redo_stack() { return redo_stack; }
+    std::deque<EditAction>& get_undo_stack() { return undo_stack; }
+    std::deque<EditAction>& get_redo_stack() { return redo_stack; }
 
-    void clear() {
-        undo_stack.clear();
-        redo_stack.clear();
-    }
+    // Undo and redo move actions between the stacks, so the total only changes on push and clear.
+    size_t memory_usage() const { return history_bytes; }
+
+    // Starts journaling to path; history already there is restored on first use
+    // if it ends at a checkpoint matching content_hash, which is only waited
+    // for then.
+    void attach_journal(std::filesystem::path path, std::future<uint64_t> content_hash);
+    void ensure_restored();
+    // Marks the current state as matching a file with content_hash, moving the journal to path if needed.
+    void checkpoint(const std::filesystem::path& path, uint64_t content_hash);
+
+    void clear();
 };
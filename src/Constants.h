@@ -12,6 +12,9 @@ constexpr int FOLD_GUTTER_WIDTH = 20;
 constexpr int LINE_NUMBER_WIDTH = 60;
 constexpr int GUTTER_WIDTH = FOLD_GUTTER_WIDTH + LINE_NUMBER_WIDTH;
 constexpr int CURSOR_BLINK_MS = 530;
+// How often the loop wakes without input while a parse, load, save, search or
+// the terminal may have something new to show.
+constexpr int BACKGROUND_POLL_MS = 16;
 constexpr int STATUS_BAR_HEIGHT = 32;
 constexpr int FILE_TREE_WIDTH = 250;
 constexpr int FILE_TREE_MIN_WIDTH = 100;
@@ -43,12 +46,13 @@ constexpr int MENU_ITEM_PADDING = 12;
 constexpr int MENU_DROPDOWN_WIDTH = 180;
 constexpr int MENU_DROPDOWN_ITEM_HEIGHT = 28;
 
-constexpr size_t UNDO_HISTORY_MAX = 10000;
-constexpr size_t MAX_LINES_FOR_FOLDING = 10000;
-constexpr size_t MAX_LINES_FOR_HIGHLIGHT = 5000;
+constexpr size_t UNDO_HISTORY_BYTES = size_t{64} << 20;
+constexpr size_t UNDO_JOURNAL_MAX_BYTES = size_t{32} << 20;
+constexpr int HIGHLIGHT_WINDOW_LINES = 2500;
 constexpr size_t LARGE_FILE_LINES = 10000;
 constexpr Uint32 SYNTAX_DEBOUNCE_MS = 150;
 constexpr int LONG_LINE_THRESHOLD = 1500;
+constexpr Uint32 SAVE_REPORT_MIN_MS = 500;
 
 constexpr const char* FONT_NAME = "JetBrainsMonoNLNerdFont-Regular.ttf";
 constexpr const char* FONT_SEARCH_PATHS[] = {
@@ -81,6 +85,11 @@ namespace Colors {
     constexpr SDL_Color SELECTION = {70, 130, 180, 150};
     constexpr SDL_Color OCCURRENCE_HIGHLIGHT = {80, 80, 50, 100};
     constexpr SDL_Color FOLD_INDICATOR = {120, 120, 80, 255};
+    constexpr SDL_Color GUTTER_ADDED = {87, 171, 90, 255};
+    constexpr SDL_Color GUTTER_MODIFIED = {86, 140, 204, 255};
+    constexpr SDL_Color GUTTER_DELETED = {204, 86, 86, 255};
+    constexpr SDL_Color GUTTER_ERROR = {230, 80, 80, 255};
+    constexpr SDL_Color GUTTER_WARNING = {220, 180, 60, 255};
 
     constexpr SDL_Color SCROLLBAR_BG = {35, 35, 40, 255};
     constexpr SDL_Color SCROLLBAR_THUMB = {70, 70, 80, 255};
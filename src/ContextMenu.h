@@ -141,17 +141,17 @@ public:
         }
     }
 
-    void render(SDL_Renderer* renderer, TextureCache& texture_cache, int line_height) {
+    void render(RenderQueue& queue, TextureCache& texture_cache, int line_height) {
         if (!visible || items.empty()) return;
 
         int menu_height = calculate_height();
 
-        SDL_SetRenderDrawColor(renderer, MENU_DROPDOWN_BG.r, MENU_DROPDOWN_BG.g, MENU_DROPDOWN_BG.b, 255);
+        queue.set_color(MENU_DROPDOWN_BG.r, MENU_DROPDOWN_BG.g, MENU_DROPDOWN_BG.b, 255);
         SDL_Rect menu_bg = {pos_x, pos_y, menu_width, menu_height};
-        SDL_RenderFillRect(renderer, &menu_bg);
+        queue.fill_rect(menu_bg);
 
-        SDL_SetRenderDrawColor(renderer, MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
-        SDL_RenderDrawRect(renderer, &menu_bg);
+        queue.set_color(MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
+        queue.draw_rect(menu_bg);
 
         int item_y = pos_y;
         for (int i = 0; i < static_cast<int>(items.size()); i++) {
@@ -159,10 +159,10 @@ public:
             bool is_hovered = (hovered_item == i);
 
             if (is_hovered && item.enabled) {
-                SDL_SetRenderDrawColor(renderer, MENU_DROPDOWN_HOVER.r, MENU_DROPDOWN_HOVER.g,
+                queue.set_color(MENU_DROPDOWN_HOVER.r, MENU_DROPDOWN_HOVER.g,
                                        MENU_DROPDOWN_HOVER.b, 255);
                 SDL_Rect item_bg = {pos_x + 1, item_y, menu_width - 2, L->menu_dropdown_item_height};
-                SDL_RenderFillRect(renderer, &item_bg);
+                queue.fill_rect(item_bg);
             }
 
             int text_y = item_y + (L->menu_dropdown_item_height - line_height) / 2;
@@ -174,8 +174,8 @@ public:
 
             if (item.separator_after) {
                 int sep_y = item_y + L->scaled(3);
-                SDL_SetRenderDrawColor(renderer, MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
-                SDL_RenderDrawLine(renderer, pos_x + L->scaled(8), sep_y,
+                queue.set_color(MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
+                queue.draw_line(pos_x + L->scaled(8), sep_y,
                                    pos_x + menu_width - L->scaled(8), sep_y);
                 item_y += L->scaled(6);
             }
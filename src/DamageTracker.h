@@ -0,0 +1,102 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class Panel : uint8_t {
+    MenuBar,
+    FileTree,
+    TabBar,
+    Editor,
+    CommandBar,
+    StatusBar,
+    Terminal,
+    Count
+};
+
+constexpr size_t PANEL_COUNT = static_cast<size_t>(Panel::Count);
+
+struct PanelRects {
+    std::array<SDL_Rect, PANEL_COUNT> rects{};
+
+    SDL_Rect& operator[](Panel panel) { return rects[static_cast<size_t>(panel)]; }
+    const SDL_Rect& operator[](Panel panel) const { return rects[static_cast<size_t>(panel)]; }
+
+    // The panel containing (x, y), or Panel::Count if none does.
+    Panel at(int x, int y) const {
+        SDL_Point point = {x, y};
+        for (size_t i = 0; i < PANEL_COUNT; ++i) {
+            if (SDL_PointInRect(&point, &rects[i])) return static_cast<Panel>(i);
+        }
+        return Panel::Count;
+    }
+};
+
+// Collects what has to be redrawn before the next frame. Panels are marked by
+// id and turned into rectangles once the frame's layout is known; anything
+// without a panel of its own, such as a toast, is marked by rectangle.
+class DamageTracker {
+public:
+    // Past this many separate regions one pass over their union is cheaper.
+    static constexpr size_t MAX_REGIONS = 4;
+
+    void mark(Panel panel) { dirty_panels |= bit(panel); }
+    void mark_rect(const SDL_Rect& rect) {
+        if (rect.w > 0 && rect.h > 0) rects.push_back(rect);
+    }
+    void mark_all() { full = true; }
+
+    bool any() const { return full || dirty_panels != 0 || !rects.empty(); }
+
+    // Regions to redraw, merged so none overlap, then cleared for the next frame.
+    void take_regions(const PanelRects& panels, int window_w, int window_h, std::vector<SDL_Rect>& regions) {
+        regions.clear();
+        SDL_Rect window = {0, 0, window_w, window_h};
+        if (full) {
+            regions.push_back(window);
+        } else {
+            for (size_t i = 0; i < PANEL_COUNT; ++i) {
+                if (dirty_panels & (1u << i)) add_region(regions, panels.rects[i], window);
+            }
+            for (const SDL_Rect& rect : rects) {
+                add_region(regions, rect, window);
+            }
+            if (regions.size() > MAX_REGIONS) {
+                SDL_Rect bounds = regions[0];
+                for (const SDL_Rect& region : regions) {
+                    SDL_UnionRect(&bounds, &region, &bounds);
+                }
+                regions.assign(1, bounds);
+            }
+        }
+        full = false;
+        dirty_panels = 0;
+        rects.clear();
+    }
+
+private:
+    bool full = true;
+    uint32_t dirty_panels = 0;
+    std::vector<SDL_Rect> rects;
+
+    static uint32_t bit(Panel panel) { return 1u << static_cast<uint32_t>(panel); }
+
+    static void add_region(std::vector<SDL_Rect>& regions, const SDL_Rect& rect, const SDL_Rect& window) {
+        SDL_Rect region;
+        if (!SDL_IntersectRect(&rect, &window, &region)) return;
+        // Folding in one region can make it reach others, so keep merging until it stops growing.
+        for (size_t i = 0; i < regions.size();) {
+            if (SDL_HasIntersection(&regions[i], &region)) {
+                SDL_UnionRect(&regions[i], &region, &region);
+                regions.erase(regions.begin() + static_cast<std::ptrdiff_t>(i));
+                i = 0;
+            } else {
+                ++i;
+            }
+        }
+        regions.push_back(region);
+    }
+};
@@ -1,5 +1,6 @@
 #include "Editor.h"
 #include "Utils.h"
+#include "UndoJournal.h"
 
 Editor::Editor() {
     document.set_tree_edit_callback([this](ByteOff start_byte, ByteOff bytes_removed, ByteOff bytes_added,
@@ -12,6 +13,7 @@ Editor::Editor() {
             old_end_point,
             new_end_point
         );
+        view.invalidate_tokens_for_edit(start_point.row, old_end_point.row, new_end_point.row);
         view.mark_syntax_dirty();
     });
 }
@@ -24,8 +26,56 @@ bool Editor::load_file(const char* path) {
 
     controller.reset_state();
     view.clear_caches();
-    view.init_for_file(document.file_path, document);
+    if (document.is_loading()) {
+        view.highlighter.reset_tree();
+        view.syntax_dirty = false;
+    } else {
+        view.init_for_file(document.file_path, document);
+    }
+
+    if (has_undo_journal()) {
+        // Hashing the whole file would hold up the first frame; the journal
+        // only needs the hash on the first edit, undo or redo.
+        controller.command_manager.attach_journal(UndoJournal::path_for(document.file_path),
+                                                  UndoJournal::content_hash_async(document.lines.snapshot()));
+    }
+
+    return true;
+}
+
+Editor::DiskChange Editor::check_file_on_disk(size_t& lost_lines, bool truncation_only) {
+    lost_lines = 0;
+    bool changed = truncation_only ? document.file_truncated_on_disk() : document.file_changed_on_disk();
+    if (!changed) return DiskChange::None;
+
+    if (!document.modified) {
+        std::string path = document.file_path;
+        if (load_file(path.c_str())) return DiskChange::Reloaded;
+    }
+
+    lost_lines = document.detach_from_file();
+    if (lost_lines > 0) {
+        // History and highlighting refer to text that is gone.
+        controller.command_manager.clear();
+        view.clear_caches();
+        view.init_for_file(document.file_path, document);
+        auto clamp = [this](LineIdx& line, ColIdx& col) {
+            line = std::clamp(line, 0, static_cast<LineIdx>(document.line_count()) - 1);
+            col = std::min(col, static_cast<ColIdx>(document.get_line(line).size()));
+        };
+        clamp(controller.cursor_line, controller.cursor_col);
+        clamp(controller.sel_start_line, controller.sel_start_col);
+    }
+    return DiskChange::Detached;
+}
+
+bool Editor::poll_loading() {
+    if (!document.poll_loading()) {
+        return false;
+    }
 
+    view.highlighter.set_language_for_file(document.file_path, document.lines, document.offset_manager);
+    view.syntax_dirty = true;
     return true;
 }
 
@@ -36,20 +86,56 @@ void Editor::load_text(const std::string& text) {
     view.init_for_file(document.file_path, document);
 }
 
-bool Editor::save_file() {
+std::expected<SaveStats, std::string> Editor::save_file() {
     if (document.file_path.empty()) {
         std::string new_path = show_save_dialog();
         if (new_path.empty()) {
-            return false;
+            return std::unexpected(std::string{});
         }
-        document.file_path = new_path;
+        auto result = document.save_as(new_path);
+        if (result) checkpoint_undo_journal();
+        return result;
     }
 
     auto result = document.save();
-    return result.has_value();
+    if (result) checkpoint_undo_journal();
+    return result;
+}
+
+std::expected<void, std::string> Editor::save_file_async() {
+    if (document.file_path.empty()) {
+        std::string new_path = show_save_dialog();
+        if (new_path.empty()) {
+            return std::unexpected(std::string{});
+        }
+        return document.save_as_async(new_path);
+    }
+
+    return document.save_as_async(document.file_path);
+}
+
+std::optional<std::expected<SaveStats, std::string>> Editor::poll_save() {
+    auto result = document.poll_save();
+    // Edits made while the save ran are not on disk, so only an unmodified document marks a checkpoint.
+    if (result && *result && !document.modified) {
+        checkpoint_undo_journal();
+    }
+    return result;
+}
+
+bool Editor::has_undo_journal() const {
+    return !document.file_path.empty() && !document.is_loading() &&
+           document.format.encoding != TextEncoding::Binary &&
+           document.offset_manager.total_bytes() <= UNDO_JOURNAL_MAX_BYTES;
+}
+
+void Editor::checkpoint_undo_journal() {
+    if (!has_undo_journal()) return;
+    controller.command_manager.checkpoint(UndoJournal::path_for(document.file_path),
+                                          UndoJournal::content_hash(document.lines));
 }
 
-void Editor::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& texture_cache,
+void Editor::render(RenderQueue& queue, TTF_Font* font, TextureCache& texture_cache,
                     const std::string& search_query,
                     int x_offset, int y_offset, int visible_width, int visible_height,
                     int window_w, int char_width,
@@ -58,7 +144,7 @@ void Editor::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& textur
                     std::function<SDL_Color(TokenType)> syntax_color_func) {
 
     view.update_smooth_scroll(document);
-    view.render(renderer, font, texture_cache,
+    view.render(queue, font, texture_cache,
                 document,
                 controller.cursor_line, controller.cursor_col,
                 controller.sel_active, controller.sel_start_line, controller.sel_start_col,
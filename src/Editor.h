@@ -16,8 +16,8 @@ struct Editor {
 
     Editor();
 
-    std::vector<std::string>& get_lines() { return document.lines; }
-    const std::vector<std::string>& get_lines() const { return document.lines; }
+    LineStore& get_lines() { return document.lines; }
+    const LineStore& get_lines() const { return document.lines; }
 
     const std::string& get_file_path() const { return document.file_path; }
     void set_file_path(const std::string& path) { document.file_path = path; }
@@ -26,6 +26,8 @@ struct Editor {
     void set_readonly(bool value) { document.readonly = value; }
 
     bool is_modified() const { return document.modified; }
+    const TextFormat& get_text_format() const { return document.format; }
+    size_t get_undo_memory() const { return controller.command_manager.memory_usage(); }
     void set_modified(bool value) { document.modified = value; }
 
     int get_line_height() const { return view.line_height; }
@@ -63,7 +65,10 @@ struct Editor {
     }
 
     void rebuild_syntax() { view.rebuild_syntax(document); }
-    const std::vector<Token>& get_line_tokens(size_t line_idx) { return view.get_line_tokens(line_idx); }
+    bool update_syntax() { return view.update_syntax(document); }
+    bool has_pending_syntax() const { return view.has_pending_syntax(); }
+    bool is_scrolling() const { return view.is_scrolling(); }
+    std::span<const Token> get_line_tokens(size_t line_idx) const { return view.get_line_tokens(line_idx); }
 
     bool undo() { return controller.undo(document, view); }
     bool redo() { return controller.redo(document, view); }
@@ -128,8 +133,21 @@ struct Editor {
     void ensure_visible_x(int cursor_pixel_x, int visible_width, int margin) { view.ensure_visible_x(cursor_pixel_x, visible_width, margin); }
 
     bool load_file(const char* path);
+    enum class DiskChange { None, Reloaded, Detached };
+    // Reacts to another program truncating or rewriting the open file in
+    // place. An unmodified document reloads; a modified one keeps its edits and
+    // copies in what is still readable, with lost_lines counting lines past the
+    // file's new end. With truncation_only, other changes are left for a later full check.
+    DiskChange check_file_on_disk(size_t& lost_lines, bool truncation_only = false);
+    bool is_loading() const { return document.is_loading(); }
+    float load_progress() const { return document.load_progress(); }
+    bool poll_loading();
     void load_text(const std::string& text);
-    bool save_file();
+    // An empty error means the save dialog was cancelled.
+    std::expected<SaveStats, std::string> save_file();
+    std::expected<void, std::string> save_file_async();
+    bool is_saving() const { return document.is_saving(); }
+    std::optional<std::expected<SaveStats, std::string>> poll_save();
 
     void handle_mouse_click(int x, int y, int x_offset, int y_offset, int visible_width, int visible_height, TTF_Font* font) {
         controller.handle_mouse_click(x, y, x_offset, y_offset, visible_width, visible_height, font, document, view);
@@ -149,7 +167,7 @@ struct Editor {
         view.handle_scroll(wheel_x, wheel_y, char_width, shift_held, document);
     }
 
-    void render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& texture_cache,
+    void render(RenderQueue& queue, TTF_Font* font, TextureCache& texture_cache,
                 const std::string& search_query,
                 int x_offset, int y_offset, int visible_width, int visible_height,
                 int window_w, int char_width,
@@ -165,8 +183,13 @@ struct Editor {
 
     SyntaxHighlighter& highlighter() { return view.highlighter; }
     const SyntaxHighlighter& highlighter() const { return view.highlighter; }
+    size_t token_arena_growth_count() const { return view.token_arena.growth_count(); }
 
     void update_cursor_from_mouse(int x, int y, int x_offset, int y_offset, TTF_Font* font) {
         controller.update_cursor_from_mouse(x, y, x_offset, y_offset, font, document, view);
     }
+
+private:
+    bool has_undo_journal() const;
+    void checkpoint_undo_journal();
 };
@@ -33,8 +33,9 @@ std::string EditorController::get_selected_text(const TextDocument& doc) const {
     std::string result;
     for (int i = sel.start.line; i <= sel.end.line; i++) {
         int col_start = (i == sel.start.line) ? sel.start.col : 0;
-        int col_end = (i == sel.end.line) ? sel.end.col : static_cast<int>(doc.lines[i].size());
-        result += doc.lines[i].substr(col_start, col_end - col_start);
+        std::string_view line = doc.lines.view(i);
+        int col_end = (i == sel.end.line) ? sel.end.col : static_cast<int>(line.size());
+        result += line.substr(col_start, col_end - col_start);
         if (i < sel.end.line) result += '\n';
     }
     return result;
@@ -58,11 +59,13 @@ uint64_t EditorController::get_undo_group_id() {
     return current_group_id;
 }
 
-void EditorController::push_action(EditAction action) {
-    command_manager.push(std::move(action));
+void EditorController::push_action(EditAction action, bool extend_run) {
+    // Inside an explicit group a keystroke shares its group with other actions.
+    command_manager.push(std::move(action), extend_run && !in_undo_group);
 }
 
 bool EditorController::undo(TextDocument& doc, EditorView& view) {
+    command_manager.ensure_restored();
     if (!command_manager.can_undo()) return false;
 
     auto& undo_stack = command_manager.get_undo_stack();
@@ -70,6 +73,7 @@ bool EditorController::undo(TextDocument& doc, EditorView& view) {
 
     uint64_t group = get_action_group_id(undo_stack.back());
 
+    doc.begin_edit_batch();
     while (!undo_stack.empty() && get_action_group_id(undo_stack.back()) == group) {
         EditAction action = std::move(undo_stack.back());
         undo_stack.pop_back();
@@ -80,6 +84,8 @@ bool EditorController::undo(TextDocument& doc, EditorView& view) {
 
         redo_stack.push_back(std::move(action));
     }
+    doc.end_edit_batch();
+    command_manager.note_undo();
 
     clear_selection();
     view.mark_syntax_dirty();
@@ -87,6 +93,7 @@ bool EditorController::undo(TextDocument& doc, EditorView& view) {
 }
 
 bool EditorController::redo(TextDocument& doc, EditorView& view) {
+    command_manager.ensure_restored();
     if (!command_manager.can_redo()) return false;
 
     auto& undo_stack = command_manager.get_undo_stack();
@@ -94,6 +101,7 @@ bool EditorController::redo(TextDocument& doc, EditorView& view) {
 
     uint64_t group = get_action_group_id(redo_stack.back());
 
+    doc.begin_edit_batch();
     while (!redo_stack.empty() && get_action_group_id(redo_stack.back()) == group) {
         EditAction action = std::move(redo_stack.back());
         redo_stack.pop_back();
@@ -104,6 +112,8 @@ bool EditorController::redo(TextDocument& doc, EditorView& view) {
 
         undo_stack.push_back(std::move(action));
     }
+    doc.end_edit_batch();
+    command_manager.note_redo();
 
     clear_selection();
     view.mark_syntax_dirty();
@@ -136,6 +146,7 @@ void EditorController::insert_text(TextDocument& doc, EditorView& view, const ch
 
     std::string str(text);
     if (str.empty()) return;
+    bool typed = utf8_next_char_pos(str, 0) == static_cast<int>(str.size());
 
     const auto& auto_pairs = view.highlighter.get_auto_pairs();
 
@@ -173,7 +184,7 @@ void EditorController::insert_text(TextDocument& doc, EditorView& view, const ch
 
     view.mark_syntax_dirty();
 
-    push_action(InsertOp{start_line_pos, start_col_pos, str, end_pos.line, end_pos.col, group});
+    push_action(InsertOp{start_line_pos, start_col_pos, str, end_pos.line, end_pos.col, group}, typed);
 }
 
 void EditorController::new_line(TextDocument& doc, EditorView& view) {
@@ -247,7 +258,7 @@ void EditorController::backspace(TextDocument& doc, EditorView& view) {
 
         view.mark_syntax_dirty();
 
-        push_action(DeleteOp{cursor_line, prev_pos, deleted_text, cursor_line, delete_end, group});
+        push_action(DeleteOp{cursor_line, prev_pos, deleted_text, cursor_line, delete_end, group}, true);
     } else if (cursor_line > 0) {
         int orig_line = cursor_line;
         uint64_t group = get_undo_group_id();
@@ -283,7 +294,7 @@ void EditorController::delete_char(TextDocument& doc, EditorView& view) {
 
         view.mark_syntax_dirty();
 
-        push_action(DeleteOp{cursor_line, cursor_col, deleted_text, cursor_line, next_pos, group});
+        push_action(DeleteOp{cursor_line, cursor_col, deleted_text, cursor_line, next_pos, group}, true);
     } else if (cursor_line < static_cast<int>(doc.lines.size()) - 1) {
         uint64_t group = get_undo_group_id();
 
@@ -312,7 +323,7 @@ void EditorController::toggle_comment(TextDocument& doc, EditorView& view) {
 
     bool all_commented = true;
     for (int i = start_line; i <= end_line; ++i) {
-        const std::string& line = doc.lines[i];
+        std::string_view line = doc.lines.view(i);
         size_t first_non_space = line.find_first_not_of(" \t");
         if (first_non_space == std::string::npos) continue;
         if (line.substr(first_non_space, comment_token.size()) != comment_token) {
@@ -322,11 +333,12 @@ void EditorController::toggle_comment(TextDocument& doc, EditorView& view) {
     }
 
     begin_undo_group();
+    doc.begin_edit_batch();
 
     int min_indent = INT_MAX;
     if (!all_commented) {
         for (int i = start_line; i <= end_line; ++i) {
-            const std::string& line = doc.lines[i];
+            std::string_view line = doc.lines.view(i);
             size_t first_non_space = line.find_first_not_of(" \t");
             if (first_non_space == std::string::npos) continue;
             min_indent = std::min(min_indent, static_cast<int>(first_non_space));
@@ -366,6 +378,7 @@ void EditorController::toggle_comment(TextDocument& doc, EditorView& view) {
         }
     }
 
+    doc.end_edit_batch();
     end_undo_group();
     view.mark_syntax_dirty();
 }
@@ -602,7 +615,7 @@ bool EditorController::find_next(const TextDocument& doc, const std::string& que
     clear_selection();
     for (int i = start.line; i < static_cast<int>(doc.lines.size()); i++) {
         size_t search_start = (i == start.line) ? start.col : 0;
-        size_t pos = doc.lines[i].find(query, search_start);
+        size_t pos = doc.lines.view(i).find(query, search_start);
         if (pos != std::string::npos) {
             cursor_line = i;
             cursor_col = static_cast<int>(pos);
@@ -610,8 +623,9 @@ bool EditorController::find_next(const TextDocument& doc, const std::string& que
         }
     }
     for (int i = 0; i <= start.line; i++) {
-        size_t end_col = (i == start.line) ? start.col : doc.lines[i].size();
-        size_t pos = doc.lines[i].find(query);
+        std::string_view line = doc.lines.view(i);
+        size_t end_col = (i == start.line) ? start.col : line.size();
+        size_t pos = line.find(query);
         if (pos != std::string::npos && pos < end_col) {
             cursor_line = i;
             cursor_col = static_cast<int>(pos);
@@ -699,17 +713,17 @@ std::string EditorController::get_node_text(TSNode node, const TextDocument& doc
 
     if (start_point.row == end_point.row) {
         if (start_point.row < doc.lines.size()) {
-            const std::string& line = doc.lines[start_point.row];
+            std::string_view line = doc.lines.view(start_point.row);
             uint32_t start_col = std::min(start_point.column, static_cast<uint32_t>(line.size()));
             uint32_t end_col = std::min(end_point.column, static_cast<uint32_t>(line.size()));
-            return line.substr(start_col, end_col - start_col);
+            return std::string(line.substr(start_col, end_col - start_col));
         }
         return "";
     }
 
     std::string result;
     for (uint32_t row = start_point.row; row <= end_point.row && row < doc.lines.size(); row++) {
-        const std::string& line = doc.lines[row];
+        std::string_view line = doc.lines.view(row);
         if (row == start_point.row) {
             result += line.substr(std::min(start_point.column, static_cast<uint32_t>(line.size())));
             result += '\n';
@@ -725,14 +739,14 @@ std::string EditorController::get_node_text(TSNode node, const TextDocument& doc
 
 TSNode EditorController::get_identifier_at_cursor(const TextDocument& doc, const EditorView& view) {
     if (!view.highlighter.tree) return TSNode{};
-    uint32_t byte_offset = doc.get_byte_offset(cursor_pos());
+    uint32_t byte_offset = static_cast<uint32_t>(doc.get_byte_offset(cursor_pos()));
     TSNode root = ts_tree_root_node(view.highlighter.tree.get());
     TSNode node = ts_node_descendant_for_byte_range(root, byte_offset, byte_offset);
     if (is_identifier_node(node)) {
         return node;
     }
     if (cursor_col > 0) {
-        uint32_t prev_byte = doc.get_byte_offset({cursor_line, cursor_col - 1});
+        uint32_t prev_byte = static_cast<uint32_t>(doc.get_byte_offset({cursor_line, cursor_col - 1}));
         node = ts_node_descendant_for_byte_range(root, prev_byte, prev_byte);
         if (is_identifier_node(node)) {
             return node;
@@ -742,23 +756,25 @@ TSNode EditorController::get_identifier_at_cursor(const TextDocument& doc, const
 }
 
 void EditorController::collect_identifiers_recursive(TSNode node, const std::string& target_name,
+                                                      uint32_t first_row, uint32_t last_row,
                                                       std::vector<HighlightRange>& results, const TextDocument& doc) {
     if (ts_node_is_null(node)) return;
-    if (is_identifier_node(node)) {
+    TSPoint start = ts_node_start_point(node);
+    TSPoint end = ts_node_end_point(node);
+    if (end.row < first_row || start.row > last_row) return;
+
+    if (is_identifier_node(node) &&
+        ts_node_end_byte(node) - ts_node_start_byte(node) == target_name.size()) {
         std::string name = get_node_text(node, doc);
-        if (name == target_name) {
-            TSPoint start = ts_node_start_point(node);
-            TSPoint end = ts_node_end_point(node);
-            if (start.row == end.row) {
-                results.push_back({static_cast<int>(start.row),
-                                   static_cast<int>(start.column),
-                                   static_cast<int>(end.column)});
-            }
+        if (name == target_name && start.row == end.row) {
+            results.push_back({static_cast<int>(start.row),
+                               static_cast<int>(start.column),
+                               static_cast<int>(end.column)});
         }
     }
     uint32_t child_count = ts_node_child_count(node);
     for (uint32_t i = 0; i < child_count; i++) {
-        collect_identifiers_recursive(ts_node_child(node, i), target_name, results, doc);
+        collect_identifiers_recursive(ts_node_child(node, i), target_name, first_row, last_row, results, doc);
     }
 }
 
@@ -771,18 +787,17 @@ void EditorController::update_highlight_occurrences(const TextDocument& doc, Edi
     view.highlight_occurrences.clear();
     view.highlighted_identifier.clear();
 
-    if (doc.lines.size() > MAX_LINES_FOR_HIGHLIGHT) {
-        return;
-    }
-
     if (!view.highlighter.tree) return;
     TSNode node = get_identifier_at_cursor(doc, view);
     if (ts_node_is_null(node)) return;
     std::string name = get_node_text(node, doc);
     if (name.empty()) return;
     view.highlighted_identifier = name;
+    // Only the lines around the cursor are searched, so large files stay cheap.
+    uint32_t first_row = static_cast<uint32_t>(std::max(LineIdx{0}, cursor_line - HIGHLIGHT_WINDOW_LINES));
+    uint32_t last_row = static_cast<uint32_t>(cursor_line + HIGHLIGHT_WINDOW_LINES);
     TSNode root = ts_tree_root_node(view.highlighter.tree.get());
-    collect_identifiers_recursive(root, name, view.highlight_occurrences, doc);
+    collect_identifiers_recursive(root, name, first_row, last_row, view.highlight_occurrences, doc);
 }
 
 TSNode EditorController::find_name_in_declarator(TSNode declarator, const std::string& target_name, const TextDocument& doc) const {
@@ -1002,10 +1017,10 @@ bool EditorController::expand_selection(const TextDocument& doc, const EditorVie
 
     if (has_selection()) {
         auto sel = get_selection_range();
-        current_start_byte = doc.get_byte_offset(sel.start);
-        current_end_byte = doc.get_byte_offset(sel.end);
+        current_start_byte = static_cast<uint32_t>(doc.get_byte_offset(sel.start));
+        current_end_byte = static_cast<uint32_t>(doc.get_byte_offset(sel.end));
     } else {
-        current_start_byte = doc.get_byte_offset(cursor_pos());
+        current_start_byte = static_cast<uint32_t>(doc.get_byte_offset(cursor_pos()));
         current_end_byte = current_start_byte;
         if (selection_stack.empty()) {
             selection_stack.push_back({{{cursor_line, cursor_col}, {cursor_line, cursor_col}}});
@@ -19,7 +19,7 @@ public:
 
     std::vector<SelectionNode> selection_stack;
 
-    CommandManager command_manager{UNDO_HISTORY_MAX};
+    CommandManager command_manager{UNDO_HISTORY_BYTES};
     uint64_t current_group_id = 0;
     bool in_undo_group = false;
 
@@ -37,7 +37,7 @@ public:
     void begin_undo_group();
     void end_undo_group();
     uint64_t get_undo_group_id();
-    void push_action(EditAction action);
+    void push_action(EditAction action, bool extend_run = false);
     bool undo(TextDocument& doc, EditorView& view);
     bool redo(TextDocument& doc, EditorView& view);
 
@@ -110,6 +110,7 @@ private:
     std::string get_node_text(TSNode node, const TextDocument& doc) const;
     TSNode get_identifier_at_cursor(const TextDocument& doc, const EditorView& view);
     void collect_identifiers_recursive(TSNode node, const std::string& target_name,
+                                       uint32_t first_row, uint32_t last_row,
                                        std::vector<HighlightRange>& results, const TextDocument& doc);
     TSNode find_name_in_declarator(TSNode declarator, const std::string& target_name, const TextDocument& doc) const;
     TSNode get_definition_name_node(TSNode node, const std::string& name, const TextDocument& doc);
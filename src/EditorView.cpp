@@ -7,7 +7,7 @@
 
 void EditorView::init_for_file(const std::string& filepath, const TextDocument& doc) {
     clear_caches();
-    highlighter.tree.reset();
+    highlighter.reset_tree();
     highlighter.set_language_for_file(filepath, doc.lines, doc.offset_manager);
     syntax_dirty = true;
 }
@@ -15,23 +15,42 @@ void EditorView::init_for_file(const std::string& filepath, const TextDocument&
 void EditorView::mark_syntax_dirty() {
     syntax_dirty = true;
     last_edit_time = SDL_GetTicks();
-    token_cache.clear();
+}
+
+void EditorView::invalidate_tokens_for_edit(size_t start_row, size_t old_end_row, size_t new_end_row) {
+    token_arena.shift_for_edit(start_row, old_end_row, new_end_row);
 }
 
 void EditorView::rebuild_syntax(const TextDocument& doc) {
-    if (!syntax_dirty) return;
+    if (!syntax_dirty || highlighter.is_parsing()) return;
+
+    highlighter.parse_async(doc.snapshot());
+    syntax_dirty = false;
+}
+
+bool EditorView::update_syntax(const TextDocument& doc) {
+    bool changed = poll_syntax();
+    if (syntax_dirty) {
+        bool is_large_file = doc.lines.size() > LARGE_FILE_LINES;
+        if (!is_large_file || (SDL_GetTicks() - last_edit_time > SYNTAX_DEBOUNCE_MS)) {
+            rebuild_syntax(doc);
+        }
+    }
+    return changed;
+}
 
-    highlighter.parse_incremental(doc.lines, doc.offset_manager);
-    token_cache.clear();
+bool EditorView::poll_syntax() {
+    if (!highlighter.poll_parse(changed_ranges_buffer)) return false;
 
-    if (doc.lines.size() < MAX_LINES_FOR_FOLDING) {
-        update_fold_regions(doc);
-    } else {
-        fold_regions.clear();
-        folded_lines.clear();
+    // Tokens queried from the stale tree may disagree with the new one anywhere.
+    token_arena.drop_provisional();
+    for (const TSRange& range : changed_ranges_buffer) {
+        token_arena.invalidate(range.start_point.row, range.end_point.row);
     }
 
-    syntax_dirty = false;
+    update_fold_regions();
+    last_highlight_line = -1;
+    return true;
 }
 
 void EditorView::prefetch_viewport_tokens(LineIdx start_line, int visible_count, const TextDocument& doc) {
@@ -49,37 +68,32 @@ void EditorView::prefetch_viewport_tokens(LineIdx start_line, int visible_count,
     }
 
     int end_line = current_line;
-
-    bool need_fetch = false;
-    for (int i = start_line; i < end_line; i++) {
-        if (is_line_folded(i)) continue;
-
-        if (token_cache.find(i) == token_cache.end()) {
-            need_fetch = true;
-            break;
+    token_arena.set_window(start_line, static_cast<size_t>(end_line - start_line));
+
+    // Query only the runs of lines that edits or reparses invalidated.
+    bool provisional = syntax_dirty || highlighter.is_parsing();
+    int i = start_line;
+    while (i < end_line) {
+        if (is_line_folded(i) || token_arena.has_line(i)) {
+            i++;
+            continue;
         }
-    }
 
-    if (need_fetch) {
-        highlighter.get_viewport_tokens(start_line, end_line, doc.offset_manager, doc.lines, viewport_tokens_buffer);
-        for (auto& [line_idx, tokens] : viewport_tokens_buffer) {
-            token_cache[line_idx] = std::move(tokens);
+        int run_end = i + 1;
+        while (run_end < end_line && !token_arena.has_line(run_end)) {
+            run_end++;
         }
-        for (int i = start_line; i < end_line; i++) {
-            if (token_cache.find(i) == token_cache.end()) {
-                token_cache[i] = {};
-            }
+
+        highlighter.get_viewport_tokens(i, run_end, doc.offset_manager, doc.lines, token_arena);
+        if (provisional) {
+            token_arena.mark_provisional(i, run_end);
         }
+        i = run_end;
     }
 }
 
-const std::vector<Token>& EditorView::get_line_tokens(size_t line_idx) {
-    static const std::vector<Token> empty_tokens;
-    auto it = token_cache.find(line_idx);
-    if (it != token_cache.end()) {
-        return it->second;
-    }
-    return empty_tokens;
+std::span<const Token> EditorView::get_line_tokens(size_t line_idx) const {
+    return token_arena.line_tokens(static_cast<LineIdx>(line_idx));
 }
 
 bool EditorView::is_line_folded(LineIdx line) const {
@@ -87,39 +101,28 @@ bool EditorView::is_line_folded(LineIdx line) const {
 }
 
 bool EditorView::is_fold_start(LineIdx line) const {
-    for (const auto& fr : fold_regions) {
-        if (fr.start_line == line) {
-            return true;
-        }
-    }
-    return false;
+    return find_fold_region(line) != nullptr;
 }
 
 bool EditorView::is_fold_start_folded(LineIdx line) const {
-    for (const auto& fr : fold_regions) {
-        if (fr.start_line == line) {
-            return fr.folded;
-        }
-    }
-    return false;
+    const FoldRegion* fr = find_fold_region(line);
+    return fr && fr->folded;
 }
 
 LineIdx EditorView::get_fold_end_line(LineIdx start_line) const {
-    for (const auto& fr : fold_regions) {
-        if (fr.start_line == start_line) {
-            return fr.end_line;
-        }
-    }
-    return start_line;
+    const FoldRegion* fr = find_fold_region(start_line);
+    return fr ? fr->end_line : start_line;
 }
 
 FoldRegion* EditorView::get_fold_region_at_line(LineIdx line) {
-    for (auto& fr : fold_regions) {
-        if (fr.start_line == line) {
-            return &fr;
-        }
-    }
-    return nullptr;
+    return const_cast<FoldRegion*>(find_fold_region(line));
+}
+
+// fold_regions is sorted by start_line with no duplicates.
+const FoldRegion* EditorView::find_fold_region(LineIdx line) const {
+    auto it = std::ranges::lower_bound(fold_regions, line, {}, &FoldRegion::start_line);
+    if (it == fold_regions.end() || it->start_line != line) return nullptr;
+    return &*it;
 }
 
 bool EditorView::toggle_fold_at_line(LineIdx line) {
@@ -144,9 +147,7 @@ void EditorView::unfold_all() {
     update_folded_lines();
 }
 
-void EditorView::update_fold_regions(const TextDocument& doc) {
-    if (!highlighter.tree) return;
-
+void EditorView::update_fold_regions() {
     std::unordered_set<int> old_folded;
     for (const auto& fr : fold_regions) {
         if (fr.folded) {
@@ -154,9 +155,7 @@ void EditorView::update_fold_regions(const TextDocument& doc) {
         }
     }
 
-    fold_regions.clear();
-    TSNode root = ts_tree_root_node(highlighter.tree.get());
-    collect_fold_regions_recursive(root, doc);
+    fold_regions = highlighter.folds;
 
     for (auto& fr : fold_regions) {
         if (old_folded.count(fr.start_line)) {
@@ -177,82 +176,11 @@ void EditorView::update_folded_lines() {
     }
 }
 
-bool EditorView::is_foldable_node(TSNode node) const {
-    if (ts_node_is_null(node)) return false;
-    const char* type = ts_node_type(node);
-    return strcmp(type, "function_definition") == 0 ||
-           strcmp(type, "compound_statement") == 0 ||
-           strcmp(type, "class_specifier") == 0 ||
-           strcmp(type, "struct_specifier") == 0 ||
-           strcmp(type, "namespace_definition") == 0 ||
-           strcmp(type, "if_statement") == 0 ||
-           strcmp(type, "for_statement") == 0 ||
-           strcmp(type, "while_statement") == 0 ||
-           strcmp(type, "switch_statement") == 0 ||
-           strcmp(type, "enum_specifier") == 0 ||
-           strcmp(type, "comment") == 0 ||
-           strcmp(type, "class_definition") == 0 ||
-           strcmp(type, "function_declaration") == 0 ||
-           strcmp(type, "method_definition") == 0 ||
-           strcmp(type, "arrow_function") == 0 ||
-           strcmp(type, "class_declaration") == 0 ||
-           strcmp(type, "try_statement") == 0 ||
-           strcmp(type, "catch_clause") == 0 ||
-           strcmp(type, "with_statement") == 0 ||
-           strcmp(type, "do_statement") == 0 ||
-           strcmp(type, "statement_block") == 0 ||
-           strcmp(type, "object") == 0 ||
-           strcmp(type, "array") == 0 ||
-           strcmp(type, "block") == 0 ||
-           strcmp(type, "if_expression") == 0 ||
-           strcmp(type, "match_expression") == 0 ||
-           strcmp(type, "else_clause") == 0 ||
-           strcmp(type, "elif_clause") == 0 ||
-           strcmp(type, "except_clause") == 0 ||
-           strcmp(type, "finally_clause") == 0 ||
-           strcmp(type, "for_in_statement") == 0 ||
-           strcmp(type, "repeat_statement") == 0 ||
-           strcmp(type, "function_statement") == 0 ||
-           strcmp(type, "local_function") == 0 ||
-           strcmp(type, "fenced_code_block") == 0 ||
-           strcmp(type, "block_mapping") == 0 ||
-           strcmp(type, "block_sequence") == 0 ||
-           strcmp(type, "table") == 0 ||
-           strcmp(type, "inline_table") == 0 ||
-           strcmp(type, "array_of_tables") == 0 ||
-           strcmp(type, "rule_set") == 0 ||
-           strcmp(type, "media_statement") == 0 ||
-           strcmp(type, "keyframes_statement") == 0 ||
-           strcmp(type, "element") == 0;
-}
-
-void EditorView::collect_fold_regions_recursive(TSNode node, [[maybe_unused]] const TextDocument& doc) {
-    if (ts_node_is_null(node)) return;
-
-    if (is_foldable_node(node)) {
-        TSPoint start = ts_node_start_point(node);
-        TSPoint end = ts_node_end_point(node);
-        if (end.row > start.row) {
-            bool already_exists = false;
-            for (const auto& fr : fold_regions) {
-                if (fr.start_line == static_cast<int>(start.row)) {
-                    already_exists = true;
-                    break;
-                }
-            }
-            if (!already_exists) {
-                fold_regions.push_back({static_cast<int>(start.row), static_cast<int>(end.row), false});
-            }
-        }
-    }
-
-    uint32_t child_count = ts_node_child_count(node);
-    for (uint32_t i = 0; i < child_count; i++) {
-        collect_fold_regions_recursive(ts_node_child(node, i), doc);
+int EditorView::get_total_visible_lines(const TextDocument& doc) const {
+    if (folded_lines.empty()) {
+        return static_cast<int>(doc.lines.size());
     }
-}
 
-int EditorView::get_total_visible_lines(const TextDocument& doc) const {
     int count = 0;
     for (int i = 0; i < static_cast<int>(doc.lines.size()); i++) {
         if (!is_line_folded(i)) {
@@ -413,6 +341,11 @@ void EditorView::handle_scroll(float wheel_x, float wheel_y, int char_w, bool sh
     }
 }
 
+bool EditorView::is_scrolling() const {
+    return std::abs(target_scroll_y - precise_scroll_y) > 0.001 ||
+           std::abs(target_scroll_x - precise_scroll_x) > 0.001;
+}
+
 void EditorView::update_smooth_scroll(const TextDocument& doc) {
     constexpr double LERP_FACTOR = 0.25;
 
@@ -452,7 +385,7 @@ void EditorView::update_smooth_scroll(const TextDocument& doc) {
     scroll_x = static_cast<int>(precise_scroll_x);
 }
 
-void EditorView::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& texture_cache,
+void EditorView::render(RenderQueue& queue, TTF_Font* font, TextureCache& texture_cache,
                         const TextDocument& doc,
                         LineIdx cursor_line, ColIdx cursor_col,
                         bool sel_active, LineIdx sel_start_line, ColIdx sel_start_col,
@@ -473,62 +406,49 @@ void EditorView::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& te
     int pixel_offset = static_cast<int>(precise_scroll_y) % line_height;
     int y = y_offset - pixel_offset;
 
-    SDL_SetRenderDrawColor(renderer, Colors::GUTTER.r, Colors::GUTTER.g, Colors::GUTTER.b, 255);
-    SDL_Rect gutter_rect = {x_offset, y_offset, GUTTER_WIDTH, visible_height};
-    SDL_RenderFillRect(renderer, &gutter_rect);
-
-    SDL_Rect gutter_clip = {x_offset, y_offset, GUTTER_WIDTH, visible_height};
-    SDL_RenderSetClipRect(renderer, &gutter_clip);
-
+    gutter.begin(queue, texture_cache.glyph_atlas, {x_offset, y_offset, GUTTER_WIDTH, visible_height}, line_height);
     for (int i = scroll_y; i < static_cast<int>(doc.lines.size()) && y < visible_end_y; i++) {
         if (is_line_folded(i)) continue;
 
-        bool is_cursor_line_flag = (i == cursor_line) && is_file_open;
-        if (is_cursor_line_flag && has_focus) {
-            SDL_SetRenderDrawColor(renderer, Colors::ACTIVE_LINE.r, Colors::ACTIVE_LINE.g, Colors::ACTIVE_LINE.b, 255);
-            SDL_Rect active_gutter_rect = {x_offset, y, GUTTER_WIDTH, line_height};
-            SDL_RenderFillRect(renderer, &active_gutter_rect);
-        }
-
-        std::string line_num = std::format("{}", i + 1);
-        SDL_Color num_color = is_cursor_line_flag ? Colors::LINE_NUM_ACTIVE : Colors::LINE_NUM;
-        texture_cache.render_cached_text_right_aligned(line_num, num_color, x_offset + GUTTER_WIDTH - 8, y);
-
+        GutterRow row;
+        row.line = i;
+        row.y = y;
+        row.active = (i == cursor_line) && is_file_open;
+        row.highlighted = row.active && has_focus;
         if (is_fold_start(i)) {
-            const char* marker = is_fold_start_folded(i) ? "▶" : "▼";
-            texture_cache.render_cached_text(marker, Colors::FOLD_INDICATOR, x_offset + 4, y);
+            row.fold = is_fold_start_folded(i) ? FoldMarker::Closed : FoldMarker::Open;
         }
+        gutter.draw_row(row);
         y += line_height;
     }
+    gutter.end();
 
-    SDL_RenderSetClipRect(renderer, nullptr);
     SDL_Rect text_clip = {x_offset + GUTTER_WIDTH, y_offset, visible_width - GUTTER_WIDTH, visible_height};
-    SDL_RenderSetClipRect(renderer, &text_clip);
+    queue.set_clip(&text_clip);
+    int text_clip_right = text_clip.x + text_clip.w;
+    GlyphAtlas& glyph_atlas = texture_cache.glyph_atlas;
+    SDL_Rect cursor_rect = {0, 0, 0, 0};
 
-    if (syntax_dirty) {
-        bool is_large_file = doc.lines.size() > LARGE_FILE_LINES;
-        if (!is_large_file || (SDL_GetTicks() - last_edit_time > SYNTAX_DEBOUNCE_MS)) {
-            const_cast<EditorView*>(this)->rebuild_syntax(doc);
-        }
-    }
     const_cast<EditorView*>(this)->prefetch_viewport_tokens(scroll_y, visible_lines + 5, doc);
 
     y = y_offset - pixel_offset;
 
     for (int i = scroll_y; i < static_cast<int>(doc.lines.size()) && y < visible_end_y; i++) {
         if (is_line_folded(i)) continue;
+        // Views read mapped lines in place; indexing would copy their whole chunk.
+        std::string_view line = doc.lines.view(static_cast<size_t>(i));
 
         if (i == cursor_line && is_file_open && has_focus) {
-            SDL_SetRenderDrawColor(renderer, Colors::ACTIVE_LINE.r, Colors::ACTIVE_LINE.g, Colors::ACTIVE_LINE.b, 255);
+            queue.set_color(Colors::ACTIVE_LINE.r, Colors::ACTIVE_LINE.g, Colors::ACTIVE_LINE.b, 255);
             SDL_Rect active_line_rect = {x_offset + GUTTER_WIDTH, y, visible_width - GUTTER_WIDTH, line_height};
-            SDL_RenderFillRect(renderer, &active_line_rect);
+            queue.fill_rect(active_line_rect);
         }
 
         for (const auto& hl : highlight_occurrences) {
             if (hl.line == i) {
-                std::string expanded_line = expand_tabs(doc.lines[i]);
-                int exp_start = expanded_column(doc.lines[i], hl.start_col);
-                int exp_end = expanded_column(doc.lines[i], hl.end_col);
+                std::string expanded_line = expand_tabs(line);
+                int exp_start = expanded_column(line, hl.start_col);
+                int exp_end = expanded_column(line, hl.end_col);
                 int hl_x_start = text_x;
                 if (exp_start > 0) {
                     int w = 0;
@@ -537,11 +457,11 @@ void EditorView::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& te
                 }
                 int hl_w = 0;
                 TTF_SizeUTF8(font, expanded_line.substr(exp_start, exp_end - exp_start).c_str(), &hl_w, nullptr);
-                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-                SDL_SetRenderDrawColor(renderer, Colors::OCCURRENCE_HIGHLIGHT.r, Colors::OCCURRENCE_HIGHLIGHT.g,
+                queue.set_blend_mode(SDL_BLENDMODE_BLEND);
+                queue.set_color(Colors::OCCURRENCE_HIGHLIGHT.r, Colors::OCCURRENCE_HIGHLIGHT.g,
                                        Colors::OCCURRENCE_HIGHLIGHT.b, Colors::OCCURRENCE_HIGHLIGHT.a);
                 SDL_Rect hl_rect = {hl_x_start, y, hl_w, line_height};
-                SDL_RenderFillRect(renderer, &hl_rect);
+                queue.fill_rect(hl_rect);
             }
         }
 
@@ -557,12 +477,12 @@ void EditorView::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& te
             }
 
             if (i >= s_line && i <= e_line) {
-                std::string expanded_line = expand_tabs(doc.lines[i]);
-                int line_len = static_cast<int>(doc.lines[i].size());
+                std::string expanded_line = expand_tabs(line);
+                int line_len = static_cast<int>(line.size());
                 int line_start = (i == s_line) ? std::min(s_col, line_len) : 0;
                 int line_end = (i == e_line) ? std::min(e_col, line_len) : line_len;
-                int exp_start = expanded_column(doc.lines[i], line_start);
-                int exp_end = expanded_column(doc.lines[i], line_end);
+                int exp_start = expanded_column(line, line_start);
+                int exp_end = expanded_column(line, line_end);
                 int x_start = text_x;
                 if (exp_start > 0) {
                     int w = 0;
@@ -577,20 +497,20 @@ void EditorView::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& te
                     sel_w += char_width;
                 }
                 if (sel_w > 0) {
-                    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-                    SDL_SetRenderDrawColor(renderer, Colors::SELECTION.r, Colors::SELECTION.g, Colors::SELECTION.b, Colors::SELECTION.a);
+                    queue.set_blend_mode(SDL_BLENDMODE_BLEND);
+                    queue.set_color(Colors::SELECTION.r, Colors::SELECTION.g, Colors::SELECTION.b, Colors::SELECTION.a);
                     SDL_Rect sel_rect = {x_start, y, sel_w, line_height};
-                    SDL_RenderFillRect(renderer, &sel_rect);
+                    queue.fill_rect(sel_rect);
                 }
             }
         }
 
-        if (!search_query.empty() && !doc.lines[i].empty()) {
-            std::string expanded_line = expand_tabs(doc.lines[i]);
+        if (!search_query.empty() && !line.empty()) {
+            std::string expanded_line = expand_tabs(line);
             size_t pos = 0;
-            while ((pos = doc.lines[i].find(search_query, pos)) != std::string::npos) {
-                int exp_pos = expanded_column(doc.lines[i], static_cast<int>(pos));
-                int exp_end = expanded_column(doc.lines[i], static_cast<int>(pos + search_query.size()));
+            while ((pos = line.find(search_query, pos)) != std::string::npos) {
+                int exp_pos = expanded_column(line, static_cast<int>(pos));
+                int exp_end = expanded_column(line, static_cast<int>(pos + search_query.size()));
                 int x_start = text_x;
                 if (exp_pos > 0) {
                     int w = 0;
@@ -599,18 +519,19 @@ void EditorView::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& te
                 }
                 int highlight_w = 0;
                 TTF_SizeUTF8(font, expanded_line.substr(exp_pos, exp_end - exp_pos).c_str(), &highlight_w, nullptr);
-                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-                SDL_SetRenderDrawColor(renderer, Colors::SEARCH_HIGHLIGHT.r, Colors::SEARCH_HIGHLIGHT.g,
+                queue.set_blend_mode(SDL_BLENDMODE_BLEND);
+                queue.set_color(Colors::SEARCH_HIGHLIGHT.r, Colors::SEARCH_HIGHLIGHT.g,
                                        Colors::SEARCH_HIGHLIGHT.b, Colors::SEARCH_HIGHLIGHT.a);
                 SDL_Rect highlight_rect = {x_start, y, highlight_w, line_height};
-                SDL_RenderFillRect(renderer, &highlight_rect);
+                queue.fill_rect(highlight_rect);
                 pos += search_query.size();
             }
         }
 
-        if (!doc.lines[i].empty()) {
-            const std::string& line_text = doc.lines[i];
-            const std::vector<Token>& tokens = const_cast<EditorView*>(this)->get_line_tokens(i);
+        int line_end_x = text_x;
+        if (!line.empty()) {
+            std::string_view line_text = line;
+            std::span<const Token> tokens = get_line_tokens(i);
 
             if (line_text.size() > LONG_LINE_THRESHOLD) {
                 int effective_char_width = (char_width > 0) ? char_width : 10;
@@ -624,9 +545,10 @@ void EditorView::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& te
                 int visible_chars_count = (window_w / effective_char_width) + 20;
                 int len_bytes = visible_chars_count * 4;
 
-                std::string sub_text = line_text.substr(start_byte, len_bytes);
+                std::string_view sub_text = line_text.substr(start_byte, len_bytes);
 
-                std::vector<Token> sub_tokens;
+                static thread_local std::vector<Token> sub_tokens;
+                sub_tokens.clear();
                 int sub_len = static_cast<int>(sub_text.size());
                 for (const auto& t : tokens) {
                     int new_start = t.start - start_byte;
@@ -641,79 +563,76 @@ void EditorView::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& te
                     });
                 }
 
-                SurfacePtr surf(texture_cache.render_line_to_surface(sub_text, sub_tokens, Colors::TEXT, syntax_color_func));
-                if (surf) {
-                    TexturePtr tex(SDL_CreateTextureFromSurface(renderer, surf.get()));
-                    if (tex) {
-                        int offset_x_local = start_char_idx * char_width;
-                        SDL_Rect dst = {text_x + offset_x_local, y, surf->w, surf->h};
-                        SDL_RenderCopy(renderer, tex.get(), nullptr, &dst);
-                    }
-                }
+                int offset_x_local = start_char_idx * char_width;
+                uint64_t key = GlyphAtlas::line_key(sub_text, sub_tokens, Colors::TEXT);
+                line_end_x = glyph_atlas.queue_line(key, sub_text, sub_tokens, Colors::TEXT, syntax_color_func,
+                                                    text_x + offset_x_local, y, text_clip.x, text_clip_right);
             } else {
-                CachedLineRender& cached = build_line_render(
-                    line_render_cache, i, line_text, tokens, renderer, font, line_height, Colors::TEXT, syntax_color_func
-                );
-                render_line(cached, renderer, text_x, y);
+                // Kept with the line's tokens, which edits and reparses drop.
+                uint64_t key = token_arena.line_key(i);
+                if (key == 0) {
+                    key = GlyphAtlas::line_key(line_text, tokens, Colors::TEXT);
+                    token_arena.set_line_key(i, key);
+                }
+                line_end_x = glyph_atlas.queue_line(key, line_text, tokens, Colors::TEXT, syntax_color_func,
+                                                    text_x, y, text_clip.x, text_clip_right);
             }
         }
 
         if (is_fold_start_folded(i)) {
             int fold_end = get_fold_end_line(i);
             std::string fold_text = std::format(" ... ({} lines)", fold_end - i);
-            int line_w = 0;
-            if (!doc.lines[i].empty()) {
-                std::string expanded_line = expand_tabs(doc.lines[i]);
-                TTF_SizeUTF8(font, expanded_line.c_str(), &line_w, nullptr);
-            }
-            texture_cache.render_cached_text(fold_text, Colors::FOLD_INDICATOR, text_x + line_w, y);
+            int column = 0;
+            glyph_atlas.queue_text(fold_text, Colors::FOLD_INDICATOR, line_end_x, y, column, text_clip.x, text_clip_right);
         }
 
         if (i == cursor_line && cursor_visible && is_file_open && has_focus) {
             int cursor_x_local = text_x;
-            if (cursor_col > 0 && !doc.lines[i].empty()) {
-                std::string expanded_before = expand_tabs(doc.lines[i].substr(0, cursor_col));
+            if (cursor_col > 0 && !line.empty()) {
+                std::string expanded_before = expand_tabs(line.substr(0, cursor_col));
                 int w = 0;
                 TTF_SizeUTF8(font, expanded_before.c_str(), &w, nullptr);
                 cursor_x_local += w;
             }
-            SDL_SetRenderDrawColor(renderer, Colors::CURSOR.r, Colors::CURSOR.g, Colors::CURSOR.b, 255);
-            SDL_Rect cursor_rect = {cursor_x_local, y, 2, line_height};
-            SDL_RenderFillRect(renderer, &cursor_rect);
+            cursor_rect = {cursor_x_local, y, 2, line_height};
         }
 
         y += line_height;
     }
 
-    SDL_RenderSetClipRect(renderer, nullptr);
+    // Queued last so no later line's fills can be batched over it.
+    if (cursor_rect.w > 0) {
+        queue.set_color(Colors::CURSOR.r, Colors::CURSOR.g, Colors::CURSOR.b, 255);
+        queue.fill_rect(cursor_rect);
+    }
+
+    queue.set_clip(nullptr);
 
     int total_visible = get_total_visible_lines(doc);
     int visible_lines_count = visible_height / line_height;
     if (total_visible > visible_lines_count) {
         int scrollbar_x = x_offset + visible_width - scaled_scrollbar_width;
 
-        SDL_SetRenderDrawColor(renderer, Colors::SCROLLBAR_BG.r, Colors::SCROLLBAR_BG.g, Colors::SCROLLBAR_BG.b, 255);
+        queue.set_color(Colors::SCROLLBAR_BG.r, Colors::SCROLLBAR_BG.g, Colors::SCROLLBAR_BG.b, 255);
         SDL_Rect scrollbar_bg = {scrollbar_x, y_offset, scaled_scrollbar_width, visible_height};
-        SDL_RenderFillRect(renderer, &scrollbar_bg);
+        queue.fill_rect(scrollbar_bg);
 
         int thumb_height, thumb_y_pos;
         get_scrollbar_metrics(visible_height, scaled_scrollbar_min_thumb, thumb_height, thumb_y_pos, doc);
 
         SDL_Color thumb_color = scrollbar_dragging ? Colors::SCROLLBAR_THUMB_ACTIVE :
                                 (scrollbar_hovered ? Colors::SCROLLBAR_THUMB_HOVER : Colors::SCROLLBAR_THUMB);
-        SDL_SetRenderDrawColor(renderer, thumb_color.r, thumb_color.g, thumb_color.b, 255);
+        queue.set_color(thumb_color.r, thumb_color.g, thumb_color.b, 255);
 
         int thumb_margin = layout.scaled(2);
         SDL_Rect thumb_rect = {scrollbar_x + thumb_margin, y_offset + thumb_y_pos,
                                scaled_scrollbar_width - thumb_margin * 2, thumb_height};
-        SDL_RenderFillRect(renderer, &thumb_rect);
+        queue.fill_rect(thumb_rect);
     }
 }
 
 void EditorView::clear_caches() {
-    token_cache.clear();
-    viewport_tokens_buffer.clear();
-    line_render_cache.clear();
+    token_arena.clear();
     highlight_occurrences.clear();
     highlight_occurrences.shrink_to_fit();
     highlighted_identifier.clear();
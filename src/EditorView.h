@@ -5,12 +5,14 @@
 #include "Syntax.h"
 #include "Layout.h"
 #include "TextureCache.h"
+#include "GutterRenderer.h"
 #include "Constants.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include <span>
 
 class EditorView {
 public:
@@ -46,15 +48,16 @@ public:
     int scaled_scrollbar_min_thumb = SCROLLBAR_MIN_THUMB_HEIGHT;
 
     SyntaxHighlighter highlighter;
-    std::unordered_map<size_t, std::vector<Token>> token_cache;
-    std::unordered_map<LineIdx, std::vector<Token>> viewport_tokens_buffer;
-    LineRenderCache line_render_cache{300};
+    TokenArena token_arena;
+    std::vector<TSRange> changed_ranges_buffer;
 
     std::vector<HighlightRange> highlight_occurrences;
     std::string highlighted_identifier;
     LineIdx last_highlight_line = -1;
     ColIdx last_highlight_col = -1;
 
+    GutterRenderer gutter;
+
     std::vector<FoldRegion> fold_regions;
     std::unordered_set<LineIdx> folded_lines;
 
@@ -65,10 +68,17 @@ public:
 
     void init_for_file(const std::string& filepath, const TextDocument& doc);
     void mark_syntax_dirty();
+    // Drops cached tokens for the edited rows and moves later rows with the text.
+    void invalidate_tokens_for_edit(size_t start_row, size_t old_end_row, size_t new_end_row);
 
     void rebuild_syntax(const TextDocument& doc);
+    // Publishes a finished parse and starts the next one once edits settle.
+    // Returns true if highlighting changed.
+    bool update_syntax(const TextDocument& doc);
+    bool poll_syntax();
+    bool has_pending_syntax() const { return syntax_dirty || highlighter.is_parsing(); }
     void prefetch_viewport_tokens(LineIdx start_line, int visible_count, const TextDocument& doc);
-    const std::vector<Token>& get_line_tokens(size_t line_idx);
+    std::span<const Token> get_line_tokens(size_t line_idx) const;
 
     bool is_line_folded(LineIdx line) const;
     bool is_fold_start(LineIdx line) const;
@@ -78,7 +88,7 @@ public:
     bool toggle_fold_at_line(LineIdx line);
     void fold_all();
     void unfold_all();
-    void update_fold_regions(const TextDocument& doc);
+    void update_fold_regions();
     void update_folded_lines();
 
     int get_total_visible_lines(const TextDocument& doc) const;
@@ -97,6 +107,7 @@ public:
 
     void handle_scroll(float wheel_x, float wheel_y, int char_w, bool shift_held, const TextDocument& doc);
     void update_smooth_scroll(const TextDocument& doc);
+    bool is_scrolling() const;
     void sync_scroll_position(const TextDocument& doc);
     float get_max_scroll_pixels(const TextDocument& doc) const;
     void clamp_scroll_values(float max_scroll);
@@ -105,7 +116,7 @@ public:
         return static_cast<int>(precise_scroll_y) % line_height; 
     }
 
-    void render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& texture_cache,
+    void render(RenderQueue& queue, TTF_Font* font, TextureCache& texture_cache,
                 const TextDocument& doc,
                 LineIdx cursor_line, ColIdx cursor_col,
                 bool sel_active, LineIdx sel_start_line, ColIdx sel_start_col,
@@ -119,6 +130,5 @@ public:
     void clear_caches();
 
 private:
-    void collect_fold_regions_recursive(TSNode node, const TextDocument& doc);
-    bool is_foldable_node(TSNode node) const;
+    const FoldRegion* find_fold_region(LineIdx line) const;
 };
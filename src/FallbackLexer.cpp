@@ -0,0 +1,65 @@
+#include "FallbackLexer.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+bool is_word_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+}
+
+void lex_line_fallback(std::string_view line, const LanguageConfig& config, std::vector<Token>& out) {
+    out.clear();
+    const std::string& line_comment = config.line_comment_token;
+    const BlockComment& block = config.block_comment;
+
+    auto push = [&out](TokenType type, size_t start, size_t end) {
+        out.push_back({type, static_cast<ColIdx>(start), static_cast<ColIdx>(end)});
+    };
+
+    size_t n = line.size();
+    size_t i = 0;
+    while (i < n) {
+        std::string_view rest = line.substr(i);
+        char c = line[i];
+
+        if (!line_comment.empty() && rest.starts_with(line_comment)) {
+            push(TokenType::Comment, i, n);
+            return;
+        }
+
+        if (!block.start.empty() && rest.starts_with(block.start)) {
+            size_t close = block.end.empty() ? std::string_view::npos : line.find(block.end, i + block.start.size());
+            size_t end = (close == std::string_view::npos) ? n : close + block.end.size();
+            push(TokenType::Comment, i, end);
+            i = end;
+            continue;
+        }
+
+        if (c == '"' || c == '\'' || c == '`') {
+            size_t j = i + 1;
+            while (j < n && line[j] != c) {
+                j += (line[j] == '\\') ? 2 : 1;
+            }
+            size_t end = std::min(j + 1, n);
+            push(TokenType::String, i, end);
+            i = end;
+            continue;
+        }
+
+        if (is_word_char(c)) {
+            size_t j = i + 1;
+            bool number = std::isdigit(static_cast<unsigned char>(c)) != 0;
+            while (j < n && (is_word_char(line[j]) || (number && line[j] == '.'))) {
+                j++;
+            }
+            if (number) {
+                push(TokenType::Number, i, j);
+            }
+            i = j;
+            continue;
+        }
+
+        i++;
+    }
+}
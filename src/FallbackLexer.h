@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Types.h"
+#include "LanguageRegistry.h"
+#include <string_view>
+#include <vector>
+
+// Single-line scanner for comments, strings and numbers, used to colour the
+// viewport while a file has no syntax tree yet. It keeps no state between
+// lines, so block comments and strings are closed at the end of each line.
+void lex_line_fallback(std::string_view line, const LanguageConfig& config, std::vector<Token>& out);
@@ -159,13 +159,13 @@ void FileTree::refresh_git_status_async() {
     }).detach();
 }
 
-void FileTree::apply_pending_git_status() {
-    if (git_refresh_pending.load()) return;
+bool FileTree::apply_pending_git_status() {
+    if (git_refresh_pending.load()) return false;
     std::lock_guard<std::mutex> lock(git_mutex);
     bool has_pending = !pending_git_branch.empty() || !pending_git_staged.empty() ||
                        !pending_git_modified.empty() || !pending_git_untracked.empty() ||
                        !pending_git_ignored.empty();
-    if (!has_pending) return;
+    if (!has_pending) return false;
 
     bool changed = (pending_git_branch != current_git_branch) ||
                    (pending_git_staged != current_git_staged) ||
@@ -187,6 +187,7 @@ void FileTree::apply_pending_git_status() {
     git_modified_files = std::move(pending_git_modified);
     git_untracked_files = std::move(pending_git_untracked);
     git_ignored_files = std::move(pending_git_ignored);
+    return true;
 }
 
 void FileTree::check_git_changes() {
@@ -276,8 +277,8 @@ void FileTree::check_filesystem_changes() {
     }
 }
 
-void FileTree::apply_filesystem_refresh() {
-    if (!fs_needs_refresh.load()) return;
+bool FileTree::apply_filesystem_refresh() {
+    if (!fs_needs_refresh.load()) return false;
     fs_needs_refresh.store(false);
 
     std::unordered_set<std::string> expanded_paths;
@@ -304,6 +305,7 @@ void FileTree::apply_filesystem_refresh() {
     }
 
     refresh_git_status_async();
+    return true;
 }
 
 void FileTree::collect_expanded_paths(FileTreeNode* node, std::unordered_set<std::string>& paths) {
@@ -758,30 +760,30 @@ void FileTree::handle_scroll(int wheel_y, int visible_lines) {
     scroll_offset = std::min(scroll_offset, max_scroll);
 }
 
-void FileTree::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& texture_cache,
+void FileTree::render(RenderQueue& queue, TTF_Font* font, TextureCache& texture_cache,
                       int x, int y, int width, int height,
                       int line_height,
                       bool has_focus, bool cursor_visible,
                       const std::string& current_editor_path) {
     if (!is_loaded()) return;
 
-    SDL_SetRenderDrawColor(renderer, Colors::GUTTER.r, Colors::GUTTER.g, Colors::GUTTER.b, 255);
+    queue.set_color(Colors::GUTTER.r, Colors::GUTTER.g, Colors::GUTTER.b, 255);
     SDL_Rect tree_bg = {x, y, width, height};
-    SDL_RenderFillRect(renderer, &tree_bg);
+    queue.fill_rect(tree_bg);
 
-    SDL_SetRenderDrawColor(renderer, 50, 50, 55, 255);
+    queue.set_color(50, 50, 55, 255);
     SDL_Rect tree_border = {x + width - 1, y, 1, height};
-    SDL_RenderFillRect(renderer, &tree_border);
+    queue.fill_rect(tree_border);
 
-    render_toolbar(renderer, font, texture_cache, x, y, width);
+    render_toolbar(queue, font, texture_cache, x, y, width);
     int toolbar_offset = TOOLBAR_HEIGHT;
 
     int filter_bar_height = 0;
     if (is_filtering()) {
         filter_bar_height = line_height + PADDING;
-        SDL_SetRenderDrawColor(renderer, Colors::SEARCH_BG.r, Colors::SEARCH_BG.g, Colors::SEARCH_BG.b, 255);
+        queue.set_color(Colors::SEARCH_BG.r, Colors::SEARCH_BG.g, Colors::SEARCH_BG.b, 255);
         SDL_Rect filter_bg = {x, y + toolbar_offset, width, filter_bar_height};
-        SDL_RenderFillRect(renderer, &filter_bg);
+        queue.fill_rect(filter_bg);
 
         std::string filter_text = " " + filter_query;
         texture_cache.render_cached_text(filter_text, Colors::TEXT, x + PADDING, y + toolbar_offset + PADDING / 2);
@@ -789,15 +791,15 @@ void FileTree::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& text
         if (cursor_visible && has_focus) {
             int filter_w = 0;
             TTF_SizeUTF8(font, filter_text.c_str(), &filter_w, nullptr);
-            SDL_SetRenderDrawColor(renderer, Colors::CURSOR.r, Colors::CURSOR.g, Colors::CURSOR.b, 255);
+            queue.set_color(Colors::CURSOR.r, Colors::CURSOR.g, Colors::CURSOR.b, 255);
             SDL_Rect filter_cursor = {x + PADDING + filter_w, y + toolbar_offset + PADDING / 2, 2, line_height};
-            SDL_RenderFillRect(renderer, &filter_cursor);
+            queue.fill_rect(filter_cursor);
         }
     }
 
     int content_offset = toolbar_offset + filter_bar_height;
     SDL_Rect tree_clip = {x, y + content_offset, width, height - content_offset};
-    SDL_RenderSetClipRect(renderer, &tree_clip);
+    queue.set_clip(&tree_clip);
 
     auto& display_nodes = is_filtering() ? filtered_nodes : visible_nodes;
     int tree_y = y + PADDING + content_offset;
@@ -808,19 +810,19 @@ void FileTree::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& text
         FileTreeNode* node = display_nodes[idx];
 
         if (idx == selected_index && has_focus) {
-            SDL_SetRenderDrawColor(renderer, Colors::ACTIVE_LINE.r, Colors::ACTIVE_LINE.g, Colors::ACTIVE_LINE.b, 255);
+            queue.set_color(Colors::ACTIVE_LINE.r, Colors::ACTIVE_LINE.g, Colors::ACTIVE_LINE.b, 255);
             SDL_Rect sel_rect = {x, tree_y, width, line_height};
-            SDL_RenderFillRect(renderer, &sel_rect);
+            queue.fill_rect(sel_rect);
         } else if (idx == selected_index) {
-            SDL_SetRenderDrawColor(renderer, 35, 35, 40, 255);
+            queue.set_color(35, 35, 40, 255);
             SDL_Rect sel_rect = {x, tree_y, width, line_height};
-            SDL_RenderFillRect(renderer, &sel_rect);
+            queue.fill_rect(sel_rect);
         }
 
         if (idx == context_menu_index) {
-            SDL_SetRenderDrawColor(renderer, Colors::CURSOR.r, Colors::CURSOR.g, Colors::CURSOR.b, 255);
+            queue.set_color(Colors::CURSOR.r, Colors::CURSOR.g, Colors::CURSOR.b, 255);
             SDL_Rect border_rect = {x + 1, tree_y, width - 3, line_height};
-            SDL_RenderDrawRect(renderer, &border_rect);
+            queue.draw_rect(border_rect);
         }
 
         int indent = is_filtering() ? 0 : node->depth * 16;
@@ -855,7 +857,7 @@ void FileTree::render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& text
         tree_y += line_height;
     }
 
-    SDL_RenderSetClipRect(renderer, nullptr);
+    queue.set_clip(nullptr);
 }
 
 void FileTree::handle_mouse_click(int /* x */, int y, int line_height) {
@@ -1009,15 +1011,15 @@ SDL_Color FileTree::get_directory_git_color(const std::string& dir_path) const {
     return Colors::SYNTAX_FUNCTION;
 }
 
-void FileTree::render_toolbar(SDL_Renderer* renderer, TTF_Font* font, TextureCache& texture_cache, int x, int y, int width) {
+void FileTree::render_toolbar(RenderQueue& queue, TTF_Font* font, TextureCache& texture_cache, int x, int y, int width) {
     toolbar_width_ = width;
 
-    SDL_SetRenderDrawColor(renderer, 35, 35, 42, 255);
+    queue.set_color(35, 35, 42, 255);
     SDL_Rect toolbar_bg = {x, y, width, TOOLBAR_HEIGHT};
-    SDL_RenderFillRect(renderer, &toolbar_bg);
+    queue.fill_rect(toolbar_bg);
 
-    SDL_SetRenderDrawColor(renderer, 50, 50, 55, 255);
-    SDL_RenderDrawLine(renderer, x, y + TOOLBAR_HEIGHT - 1, x + width, y + TOOLBAR_HEIGHT - 1);
+    queue.set_color(50, 50, 55, 255);
+    queue.draw_line(x, y + TOOLBAR_HEIGHT - 1, x + width, y + TOOLBAR_HEIGHT - 1);
 
     int btn_y = y + (TOOLBAR_HEIGHT - TOOLBAR_BUTTON_SIZE) / 2;
 
@@ -1038,9 +1040,9 @@ void FileTree::render_toolbar(SDL_Renderer* renderer, TTF_Font* font, TextureCac
         bool is_hovered = (hovered_toolbar_button == i);
 
         if (is_hovered) {
-            SDL_SetRenderDrawColor(renderer, 60, 60, 70, 255);
+            queue.set_color(60, 60, 70, 255);
             SDL_Rect btn_bg = {btn_x - 2, btn_y - 2, TOOLBAR_BUTTON_SIZE + 4, TOOLBAR_BUTTON_SIZE + 4};
-            SDL_RenderFillRect(renderer, &btn_bg);
+            queue.fill_rect(btn_bg);
         }
 
         SDL_Color btn_color = buttons[i].active ? Colors::SYNTAX_KEYWORD :
@@ -9,6 +9,7 @@
 #include <atomic>
 
 struct TextureCache;
+class RenderQueue;
 
 enum class FileTreeAction {
     None,
@@ -104,7 +105,8 @@ struct FileTree {
     static constexpr Uint32 GIT_SCAN_INTERVAL_MS = 500;
 
     void refresh_git_status_async();
-    void apply_pending_git_status();
+    // Both return true if they changed what the tree shows.
+    bool apply_pending_git_status();
     void check_git_changes();
     bool is_file_staged(const std::string& path) const;
     bool is_file_modified(const std::string& path) const;
@@ -115,7 +117,7 @@ struct FileTree {
     void collect_fs_snapshot(const std::string& dir_path, std::unordered_set<std::string>& snapshot);
     void scan_filesystem_async();
     void check_filesystem_changes();
-    void apply_filesystem_refresh();
+    bool apply_filesystem_refresh();
     void collect_expanded_paths(FileTreeNode* node, std::unordered_set<std::string>& paths);
     void restore_expanded_paths(FileTreeNode* node, const std::unordered_set<std::string>& paths);
     void load_directory(const std::string& path);
@@ -152,7 +154,7 @@ struct FileTree {
     FileTreeNode* get_node_at_position(int y, int line_height);
     int get_index_at_position(int y, int line_height);
     void handle_scroll(int wheel_y, int visible_lines);
-    void render(SDL_Renderer* renderer, TTF_Font* font, TextureCache& texture_cache,
+    void render(RenderQueue& queue, TTF_Font* font, TextureCache& texture_cache,
                 int x, int y, int width, int height,
                 int line_height,
                 bool has_focus, bool cursor_visible,
@@ -170,7 +172,7 @@ struct FileTree {
     static constexpr int TOOLBAR_BUTTON_GAP = 6;
     int toolbar_width_ = 0;
     int get_toolbar_height() const { return TOOLBAR_HEIGHT; }
-    void render_toolbar(SDL_Renderer* renderer, TTF_Font* font, TextureCache& texture_cache, int x, int y, int width);
+    void render_toolbar(RenderQueue& queue, TTF_Font* font, TextureCache& texture_cache, int x, int y, int width);
     FileTreeToolbarAction handle_toolbar_click(int local_x, int local_y, int width);
     void update_toolbar_hover(int local_x, int local_y, int width);
 };
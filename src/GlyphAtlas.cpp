@@ -0,0 +1,288 @@
+#include "GlyphAtlas.h"
+#include "Utils.h"
+#include <algorithm>
+
+void GlyphAtlas::init(SDL_Renderer* r, TTF_Font* f, RenderQueue* q) {
+    clear();
+    renderer = r;
+    queue = q;
+    font = f;
+}
+
+void GlyphAtlas::set_font(TTF_Font* f) {
+    if (font != f) {
+        clear();
+        font = f;
+    }
+}
+
+void GlyphAtlas::clear() {
+    // Queued quads may still point into the pages about to be destroyed.
+    if (queue) queue->flush();
+    glyphs.clear();
+    pages.clear();
+    line_runs.clear();
+    generation_count++;
+}
+
+int GlyphAtlas::queue_text(std::string_view text, SDL_Color color, int x, int y, int& column,
+                           int clip_left, int clip_right) {
+    int space_advance = get(' ').advance;
+    int pen = x;
+    size_t i = 0;
+    while (i < text.size() && pen <= clip_right) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '\t') {
+            int spaces = TAB_WIDTH - (column % TAB_WIDTH);
+            pen += spaces * space_advance;
+            column += spaces;
+            i++;
+            continue;
+        }
+
+        int len = utf8_char_len(c);
+        const Glyph& glyph = get(utf8_decode_at(text, static_cast<ColIdx>(i)));
+        if (glyph.page >= 0 && pen + glyph.src.w > clip_left) {
+            push_quad(glyph, color, pen, y);
+        }
+        pen += glyph.advance;
+        // Tab stops count bytes, as expand_tabs does.
+        column += len;
+        i += static_cast<size_t>(len);
+    }
+    return pen;
+}
+
+int GlyphAtlas::queue_line(uint64_t key, std::string_view text, std::span<const Token> tokens, SDL_Color default_color,
+                           const std::function<SDL_Color(TokenType)>& get_color, int x, int y,
+                           int clip_left, int clip_right) {
+    if (text.size() <= MAX_CACHED_LINE_BYTES) {
+        auto it = line_runs.find(key);
+        if (it == line_runs.end()) {
+            LineRun run;
+            size_t generation_before = generation_count;
+            layout_line(text, tokens, default_color, get_color, run);
+            if (generation_count != generation_before) {
+                // The atlas started over part way through, so the first glyphs point at old pages.
+                run = LineRun{};
+                layout_line(text, tokens, default_color, get_color, run);
+            }
+            if (line_runs.size() >= MAX_CACHED_LINES) {
+                // Keep only the lines drawn by the most recent half of the lookups.
+                uint64_t oldest_kept = line_clock - MAX_CACHED_LINES / 2;
+                std::erase_if(line_runs, [&](const auto& entry) { return entry.second.last_use <= oldest_kept; });
+            }
+            it = line_runs.emplace(key, std::move(run)).first;
+        }
+
+        LineRun& run = it->second;
+        run.last_use = ++line_clock;
+        for (const PlacedGlyph& placed : run.glyphs) {
+            int pen = x + placed.x;
+            if (pen > clip_right) break;
+            if (pen + placed.glyph.src.w > clip_left) {
+                push_quad(placed.glyph, placed.color, pen, y);
+            }
+        }
+        return x + run.width;
+    }
+
+    int column = 0;
+    int pen = x;
+    size_t prev = 0;
+    for (const Token& tok : tokens) {
+        size_t start = std::clamp(static_cast<size_t>(std::max(tok.start, 0)), prev, text.size());
+        size_t end = std::clamp(static_cast<size_t>(std::max(tok.end, 0)), start, text.size());
+        if (start > prev) {
+            pen = queue_text(text.substr(prev, start - prev), default_color, pen, y, column, clip_left, clip_right);
+        }
+        if (end > start) {
+            pen = queue_text(text.substr(start, end - start), get_color(tok.type), pen, y, column, clip_left, clip_right);
+        }
+        prev = end;
+        if (pen > clip_right) return pen;
+    }
+    if (prev < text.size()) {
+        pen = queue_text(text.substr(prev), default_color, pen, y, column, clip_left, clip_right);
+    }
+    return pen;
+}
+
+uint64_t GlyphAtlas::line_key(std::string_view text, std::span<const Token> tokens, SDL_Color default_color) {
+    auto mix = [](uint64_t hash, uint64_t value) { return (hash ^ value) * 0x9e3779b97f4a7c15ull; };
+    uint64_t hash = std::hash<std::string_view>{}(text);
+    hash = mix(hash, text.size());
+    hash = mix(hash, static_cast<uint64_t>(default_color.r) << 24 | static_cast<uint64_t>(default_color.g) << 16 |
+                     static_cast<uint64_t>(default_color.b) << 8 | default_color.a);
+    for (const Token& tok : tokens) {
+        hash = mix(hash, static_cast<uint64_t>(static_cast<uint32_t>(tok.start)) << 32 | static_cast<uint32_t>(tok.end));
+        hash = mix(hash, static_cast<uint64_t>(tok.type));
+    }
+    return hash | 1;
+}
+
+void GlyphAtlas::layout_line(std::string_view text, std::span<const Token> tokens, SDL_Color default_color,
+                             const std::function<SDL_Color(TokenType)>& get_color, LineRun& run) {
+    int column = 0;
+    size_t prev = 0;
+    for (const Token& tok : tokens) {
+        size_t start = std::clamp(static_cast<size_t>(std::max(tok.start, 0)), prev, text.size());
+        size_t end = std::clamp(static_cast<size_t>(std::max(tok.end, 0)), start, text.size());
+        if (start > prev) {
+            layout_text(text.substr(prev, start - prev), default_color, column, run);
+        }
+        if (end > start) {
+            layout_text(text.substr(start, end - start), get_color(tok.type), column, run);
+        }
+        prev = end;
+    }
+    if (prev < text.size()) {
+        layout_text(text.substr(prev), default_color, column, run);
+    }
+}
+
+void GlyphAtlas::layout_text(std::string_view text, SDL_Color color, int& column, LineRun& run) {
+    int space_advance = get(' ').advance;
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '\t') {
+            int spaces = TAB_WIDTH - (column % TAB_WIDTH);
+            run.width += spaces * space_advance;
+            column += spaces;
+            i++;
+            continue;
+        }
+
+        int len = utf8_char_len(c);
+        const Glyph& glyph = get(utf8_decode_at(text, static_cast<ColIdx>(i)));
+        if (glyph.page >= 0) {
+            run.glyphs.push_back({glyph, run.width, color});
+        }
+        run.width += glyph.advance;
+        column += len;
+        i += static_cast<size_t>(len);
+    }
+}
+
+int GlyphAtlas::measure(std::string_view text) {
+    int space_advance = get(' ').advance;
+    int width = 0;
+    int column = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '\t') {
+            int spaces = TAB_WIDTH - (column % TAB_WIDTH);
+            width += spaces * space_advance;
+            column += spaces;
+            i++;
+            continue;
+        }
+        int len = utf8_char_len(c);
+        width += get(utf8_decode_at(text, static_cast<ColIdx>(i))).advance;
+        column += len;
+        i += static_cast<size_t>(len);
+    }
+    return width;
+}
+
+int GlyphAtlas::queue_glyph(uint32_t codepoint, SDL_Color color, int x, int y) {
+    const Glyph& glyph = get(codepoint);
+    if (glyph.page >= 0) {
+        push_quad(glyph, color, x, y);
+    }
+    return glyph.advance;
+}
+
+void GlyphAtlas::queue_glyph(const Glyph& glyph, SDL_Color color, int x, int y) {
+    if (glyph.page >= 0) {
+        push_quad(glyph, color, x, y);
+    }
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::get(uint32_t codepoint) {
+    auto it = glyphs.find(codepoint);
+    if (it != glyphs.end()) return it->second;
+
+    Glyph glyph;
+    if (!rasterize(codepoint, glyph)) {
+        // Every page is full: draw what is queued, then start the atlas over.
+        if (queue) queue->flush();
+        glyphs.clear();
+        line_runs.clear();
+        generation_count++;
+        pages.resize(1);
+        pages[0].shelf_x = 0;
+        pages[0].shelf_y = 0;
+        pages[0].shelf_height = 0;
+        rasterize(codepoint, glyph);
+    }
+    return glyphs.emplace(codepoint, glyph).first->second;
+}
+
+bool GlyphAtlas::rasterize(uint32_t codepoint, Glyph& glyph) {
+    glyph = Glyph{};
+    if (!font || !renderer) return true;
+
+    if (TTF_GlyphMetrics32(font, codepoint, nullptr, nullptr, nullptr, nullptr, &glyph.advance) != 0) {
+        glyph.advance = 0;
+    }
+
+    SurfacePtr rendered(TTF_RenderGlyph32_Blended(font, codepoint, SDL_Color{255, 255, 255, 255}));
+    if (!rendered) return true;
+    SurfacePtr pixels(SDL_ConvertSurfaceFormat(rendered.get(), SDL_PIXELFORMAT_ARGB8888, 0));
+    if (!pixels || pixels->w + 1 > PAGE_SIZE || pixels->h + 1 > PAGE_SIZE) return true;
+
+    if (!allocate(pixels->w, pixels->h, glyph)) {
+        // Running out of pages is left to the caller; a failed page just leaves the glyph blank.
+        return pages.size() < MAX_PAGES;
+    }
+    SDL_UpdateTexture(pages[static_cast<size_t>(glyph.page)].texture.get(), &glyph.src, pixels->pixels, pixels->pitch);
+    uploads++;
+    return true;
+}
+
+// Shelf packing: glyphs fill rows left to right, and a row is as tall as its
+// tallest glyph. Only the last page has room, so earlier pages are never revisited.
+bool GlyphAtlas::allocate(int w, int h, Glyph& glyph) {
+    int padded_w = w + 1;
+    int padded_h = h + 1;
+
+    if (!pages.empty()) {
+        Page& page = pages.back();
+        if (page.shelf_x + padded_w > PAGE_SIZE) {
+            page.shelf_y += page.shelf_height;
+            page.shelf_x = 0;
+            page.shelf_height = 0;
+        }
+    }
+
+    if (pages.empty() || pages.back().shelf_y + padded_h > PAGE_SIZE) {
+        if (pages.size() >= MAX_PAGES) return false;
+        TexturePtr texture(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                             PAGE_SIZE, PAGE_SIZE));
+        if (!texture) return false;
+        SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(texture.get(), SDL_ScaleModeNearest);
+        pages.emplace_back().texture = std::move(texture);
+    }
+
+    Page& page = pages.back();
+    glyph.page = static_cast<int>(pages.size() - 1);
+    glyph.src = {page.shelf_x, page.shelf_y, w, h};
+    page.shelf_x += padded_w;
+    page.shelf_height = std::max(page.shelf_height, padded_h);
+    return true;
+}
+
+void GlyphAtlas::push_quad(const Glyph& glyph, SDL_Color color, int x, int y) {
+    if (!queue) return;
+    constexpr float scale = 1.0f / static_cast<float>(PAGE_SIZE);
+
+    SDL_FRect dst = {static_cast<float>(x), static_cast<float>(y),
+                     static_cast<float>(glyph.src.w), static_cast<float>(glyph.src.h)};
+    SDL_FRect uv = {static_cast<float>(glyph.src.x) * scale, static_cast<float>(glyph.src.y) * scale,
+                    static_cast<float>(glyph.src.w) * scale, static_cast<float>(glyph.src.h) * scale};
+    queue->queue_quad(pages[static_cast<size_t>(glyph.page)].texture.get(), dst, uv, color);
+}
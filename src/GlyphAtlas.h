@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Types.h"
+#include "HandleTypes.h"
+#include "RenderQueue.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Glyphs are rasterized once, in white, into shared atlas pages and drawn as
+// quads tinted through their vertex colour. Drawing text queues those quads on
+// the frame's RenderQueue, which batches them per page, so once its glyphs
+// have been seen a line costs no surfaces and no texture uploads.
+//
+// Lines drawn through queue_line are also laid out once and kept by a hash of
+// their text and tokens, so a line that reappears, even somewhere else in the
+// file, replays its glyph positions instead of decoding them again.
+class GlyphAtlas {
+public:
+    static constexpr int PAGE_SIZE = 1024;
+    static constexpr size_t MAX_PAGES = 8;
+    static constexpr int TAB_WIDTH = 4;
+    // Longer lines are drawn without the line cache; they are rarely seen whole.
+    static constexpr size_t MAX_CACHED_LINE_BYTES = 1024;
+    static constexpr size_t MAX_CACHED_LINES = 2048;
+
+    struct Glyph {
+        int page = -1;
+        SDL_Rect src{};
+        int advance = 0;
+    };
+
+    void init(SDL_Renderer* r, TTF_Font* f, RenderQueue* q);
+    void set_font(TTF_Font* f);
+    void clear();
+
+    // Queues text starting at pen position x and returns where the pen ends.
+    // column is the tab-stop column of the first byte and is advanced past the
+    // text. Glyphs left of clip_left are skipped; drawing stops past clip_right.
+    int queue_text(std::string_view text, SDL_Color color, int x, int y, int& column,
+                   int clip_left = INT_MIN, int clip_right = INT_MAX);
+    // Never 0. Token colours are not part of the key, so get_color must give
+    // each type the same colour until clear().
+    static uint64_t line_key(std::string_view text, std::span<const Token> tokens, SDL_Color default_color);
+    // Queues a line coloured by its tokens, which must be sorted and disjoint.
+    // key is line_key() of the same line; callers keep it with the line, so it
+    // is computed once per change rather than on every frame.
+    int queue_line(uint64_t key, std::string_view text, std::span<const Token> tokens, SDL_Color default_color,
+                   const std::function<SDL_Color(TokenType)>& get_color, int x, int y,
+                   int clip_left = INT_MIN, int clip_right = INT_MAX);
+    // Width queue_text would advance the pen by, starting from column 0.
+    int measure(std::string_view text);
+    // Queues a single glyph and returns its advance.
+    int queue_glyph(uint32_t codepoint, SDL_Color color, int x, int y);
+    // For callers that keep glyphs across frames; they stay valid while generation() is unchanged.
+    const Glyph& get(uint32_t codepoint);
+    void queue_glyph(const Glyph& glyph, SDL_Color color, int x, int y);
+    size_t generation() const { return generation_count; }
+
+    // Texture updates so far; grows only when a glyph is seen for the first time.
+    size_t upload_count() const { return uploads; }
+    size_t cached_line_count() const { return line_runs.size(); }
+
+private:
+    struct Page {
+        TexturePtr texture;
+        int shelf_x = 0;
+        int shelf_y = 0;
+        int shelf_height = 0;
+    };
+
+    struct PlacedGlyph {
+        Glyph glyph;
+        int x = 0;
+        SDL_Color color{};
+    };
+
+    // A laid out line, with glyph positions relative to where it starts.
+    struct LineRun {
+        std::vector<PlacedGlyph> glyphs;
+        int width = 0;
+        uint64_t last_use = 0;
+    };
+
+    SDL_Renderer* renderer = nullptr;
+    RenderQueue* queue = nullptr;
+    TTF_Font* font = nullptr;
+    std::unordered_map<uint32_t, Glyph> glyphs;
+    std::vector<Page> pages;
+    size_t uploads = 0;
+    size_t generation_count = 0;
+    std::unordered_map<uint64_t, LineRun> line_runs;
+    uint64_t line_clock = 0;
+
+    void layout_line(std::string_view text, std::span<const Token> tokens, SDL_Color default_color,
+                     const std::function<SDL_Color(TokenType)>& get_color, LineRun& run);
+    void layout_text(std::string_view text, SDL_Color color, int& column, LineRun& run);
+    bool rasterize(uint32_t codepoint, Glyph& glyph);
+    bool allocate(int w, int h, Glyph& glyph);
+    void push_quad(const Glyph& glyph, SDL_Color color, int x, int y);
+};
@@ -0,0 +1,70 @@
+#include "GutterRenderer.h"
+#include "Constants.h"
+
+void GutterRenderer::begin(RenderQueue& q, GlyphAtlas& a, const SDL_Rect& r, int height) {
+    queue = &q;
+    atlas = &a;
+    rect = r;
+    line_height = height;
+    load_glyphs();
+
+    queue->set_color(Colors::GUTTER);
+    queue->fill_rect(rect);
+    queue->set_clip(&rect);
+}
+
+void GutterRenderer::draw_row(const GutterRow& row) {
+    if (row.highlighted) {
+        queue->set_color(Colors::ACTIVE_LINE);
+        queue->fill_rect({rect.x, row.y, rect.w, line_height});
+    }
+
+    if (row.mark != GutterMark::None) {
+        queue->set_color(mark_color(row.mark));
+        queue->fill_rect({rect.x, row.y, MARK_WIDTH, line_height});
+    }
+
+    // Digits are queued right to left, least significant first.
+    SDL_Color num_color = row.active ? Colors::LINE_NUM_ACTIVE : Colors::LINE_NUM;
+    int pen = rect.x + rect.w - NUMBER_RIGHT_MARGIN;
+    uint64_t number = static_cast<uint64_t>(row.line) + 1;
+    do {
+        const GlyphAtlas::Glyph& digit = digits[number % 10];
+        pen -= digit.advance;
+        atlas->queue_glyph(digit, num_color, pen, row.y);
+        number /= 10;
+    } while (number > 0);
+
+    if (row.fold != FoldMarker::None) {
+        const GlyphAtlas::Glyph& marker = row.fold == FoldMarker::Closed ? fold_closed : fold_open;
+        atlas->queue_glyph(marker, Colors::FOLD_INDICATOR, rect.x + FOLD_MARKER_X, row.y);
+    }
+}
+
+void GutterRenderer::end() {
+    queue->set_clip(nullptr);
+}
+
+void GutterRenderer::load_glyphs() {
+    // Fetching a glyph can start the atlas over, which invalidates the ones fetched before it.
+    while (atlas_generation != atlas->generation()) {
+        atlas_generation = atlas->generation();
+        for (uint32_t d = 0; d < 10; ++d) {
+            digits[d] = atlas->get('0' + d);
+        }
+        fold_open = atlas->get(U'▼');
+        fold_closed = atlas->get(U'▶');
+    }
+}
+
+SDL_Color GutterRenderer::mark_color(GutterMark mark) {
+    switch (mark) {
+        case GutterMark::Added: return Colors::GUTTER_ADDED;
+        case GutterMark::Modified: return Colors::GUTTER_MODIFIED;
+        case GutterMark::Deleted: return Colors::GUTTER_DELETED;
+        case GutterMark::Error: return Colors::GUTTER_ERROR;
+        case GutterMark::Warning: return Colors::GUTTER_WARNING;
+        case GutterMark::None: break;
+    }
+    return Colors::GUTTER;
+}
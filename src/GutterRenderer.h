@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Types.h"
+#include "GlyphAtlas.h"
+#include "RenderQueue.h"
+#include <SDL2/SDL.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+enum class FoldMarker : uint8_t { None, Open, Closed };
+
+// Change and diagnostic marks, shown as a stripe along the gutter's left edge.
+enum class GutterMark : uint8_t { None, Added, Modified, Deleted, Error, Warning };
+
+struct GutterRow {
+    LineIdx line = 0;
+    int y = 0;
+    bool active = false;
+    bool highlighted = false;
+    FoldMarker fold = FoldMarker::None;
+    GutterMark mark = GutterMark::None;
+};
+
+// Draws the editor gutter one row at a time. Line numbers are composed from
+// the ten digit glyphs, fetched from the atlas once per atlas generation, so
+// a row formats no strings and looks nothing up.
+class GutterRenderer {
+public:
+    static constexpr int NUMBER_RIGHT_MARGIN = 8;
+    static constexpr int FOLD_MARKER_X = 4;
+    static constexpr int MARK_WIDTH = 3;
+
+    // Fills the gutter background and clips the rows drawn until end() to rect.
+    void begin(RenderQueue& queue, GlyphAtlas& atlas, const SDL_Rect& rect, int line_height);
+    void draw_row(const GutterRow& row);
+    void end();
+
+private:
+    RenderQueue* queue = nullptr;
+    GlyphAtlas* atlas = nullptr;
+    SDL_Rect rect{};
+    int line_height = 0;
+
+    size_t atlas_generation = SIZE_MAX;
+    std::array<GlyphAtlas::Glyph, 10> digits{};
+    GlyphAtlas::Glyph fold_open{};
+    GlyphAtlas::Glyph fold_closed{};
+
+    void load_glyphs();
+    static SDL_Color mark_color(GutterMark mark);
+};
@@ -27,6 +27,8 @@ using TSTreePtr = Handle<TSTree, ts_tree_delete>;
 using TSQueryPtr = Handle<TSQuery, ts_query_delete>;
 using TSQueryCursorPtr = Handle<TSQueryCursor, ts_query_cursor_delete>;
 
+using FilePtr = Handle<FILE, fclose>;
+
 struct PipeDeleter {
     void operator()(FILE* f) const { if (f) pclose(f); }
 };
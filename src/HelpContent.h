@@ -125,6 +125,7 @@ VIEW
   Ctrl++              Increase font size
   Ctrl+-              Decrease font size
   Ctrl+0              Reset font size
+  F12                 Toggle render statistics in the status bar
 
 PANELS
 ────────────────────────────────────────────────────────────────────────────────
@@ -0,0 +1,50 @@
+#include "HighlightCache.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+TokenArena& HighlightCache::block(LineIdx index, LineIdx line_count) {
+    TokenArena& tokens = blocks.get_or_create(index);
+    LineIdx start = index * BLOCK_LINES;
+    LineIdx end = std::max(start, std::min(start + BLOCK_LINES, line_count));
+    tokens.set_window(start, static_cast<size_t>(end - start));
+    return tokens;
+}
+
+void HighlightCache::shift_for_edit(size_t start_row, size_t old_end_row, size_t new_end_row) {
+    auto first_block = static_cast<LineIdx>(start_row / BLOCK_LINES);
+    std::vector<LineIdx> shifted;
+    blocks.for_each([&](LineIdx index, TokenArena&) {
+        if (index >= first_block) shifted.push_back(index);
+    });
+    // Rows crossing into a neighbouring block land in rows that block has
+    // already vacated, so blocks are shifted starting from the far end.
+    if (new_end_row > old_end_row) {
+        std::ranges::sort(shifted, std::greater{});
+    } else {
+        std::ranges::sort(shifted);
+    }
+
+    auto delta = static_cast<int64_t>(new_end_row) - static_cast<int64_t>(old_end_row);
+    for (LineIdx index : shifted) {
+        TokenArena& tokens = *blocks.peek(index);
+        if (delta != 0) {
+            auto first_moved = std::max(tokens.first_line(), static_cast<LineIdx>(old_end_row + 1));
+            for (LineIdx line = first_moved; line < tokens.end_line(); ++line) {
+                auto moved = static_cast<LineIdx>(line + delta);
+                LineIdx target = moved / BLOCK_LINES;
+                if (target == index || !tokens.has_line(line)) continue;
+                if (TokenArena* neighbour = blocks.peek(target)) {
+                    neighbour->assign_line(moved, tokens.line_tokens(line));
+                }
+            }
+        }
+        tokens.shift_for_edit(start_row, old_end_row, new_end_row);
+    }
+}
+
+void HighlightCache::invalidate(size_t first_row, size_t last_row) {
+    blocks.for_each([&](LineIdx, TokenArena& tokens) {
+        tokens.invalidate(first_row, last_row);
+    });
+}
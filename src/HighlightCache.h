@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Types.h"
+#include "TokenArena.h"
+#include "LRUCache.h"
+#include <cstddef>
+
+// Query results cached per block of lines. Edits shift cached rows and drop
+// only the edited ones; a reparse drops the rows in its changed ranges.
+class HighlightCache {
+public:
+    static constexpr LineIdx BLOCK_LINES = 256;
+    static constexpr size_t MAX_BLOCKS = 64;
+
+    // The tokens of block index, windowed to its lines among line_count.
+    TokenArena& block(LineIdx index, LineIdx line_count);
+    TokenArena* peek(LineIdx index) { return blocks.peek(index); }
+
+    // An edit replaced rows [start_row, old_end_row] with [start_row, new_end_row].
+    void shift_for_edit(size_t start_row, size_t old_end_row, size_t new_end_row);
+    void invalidate(size_t first_row, size_t last_row);
+    void clear() { blocks.clear(); }
+    size_t size() const { return blocks.size(); }
+
+private:
+    LRUCache<LineIdx, TokenArena> blocks{MAX_BLOCKS};
+};
@@ -0,0 +1,228 @@
+#include "Injections.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+namespace {
+constexpr uint32_t MAX_LANGUAGE_NAME_BYTES = 32;
+
+struct Injection {
+    LoadedLanguage* language;
+    std::vector<TSRange> ranges;
+};
+
+std::string language_name(TSNode node, const TSInput& input) {
+    uint32_t byte = ts_node_start_byte(node);
+    uint32_t end = std::min(ts_node_end_byte(node), byte + MAX_LANGUAGE_NAME_BYTES);
+    std::string name;
+    while (byte < end) {
+        uint32_t length = 0;
+        const char* chunk = input.read(input.payload, byte, ts_node_start_point(node), &length);
+        if (!chunk || length == 0) break;
+        uint32_t taken = std::min(length, end - byte);
+        name.append(chunk, taken);
+        byte += taken;
+    }
+    for (char& c : name) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return name;
+}
+
+void collect_injections(const TSTree* tree, const LoadedLanguage& language, const TSInput& input,
+                        TSQueryCursor* cursor, const std::vector<const LoadedLanguage*>& parsed,
+                        std::vector<Injection>& injections) {
+    const TSQuery* query = language.injection_query.get();
+    if (!query) return;
+
+    LanguageRegistry& registry = LanguageRegistry::instance();
+    ts_query_cursor_exec(cursor, query, ts_tree_root_node(tree));
+
+    TSQueryMatch match;
+    while (ts_query_cursor_next_match(cursor, &match)) {
+        LoadedLanguage* injected = nullptr;
+        TSNode content{};
+        bool has_content = false;
+
+        for (uint16_t i = 0; i < match.capture_count; i++) {
+            const TSQueryCapture& capture = match.captures[i];
+            uint32_t length;
+            const char* name = ts_query_capture_name_for_id(query, capture.index, &length);
+            std::string_view capture_name(name, length);
+
+            if (capture_name == "injection.language") {
+                injected = registry.load_injected(language_name(capture.node, input));
+                continue;
+            }
+            if (capture_name != "injection.content") {
+                injected = registry.load_injected(std::string(capture_name));
+            }
+            content = capture.node;
+            has_content = true;
+        }
+
+        if (!has_content || !injected || ts_node_start_byte(content) >= ts_node_end_byte(content)) continue;
+        if (std::ranges::find(parsed, injected) != parsed.end()) continue;
+
+        auto it = std::ranges::find(injections, injected, &Injection::language);
+        if (it == injections.end()) {
+            it = injections.insert(injections.end(), {injected, {}});
+        }
+        it->ranges.push_back({ts_node_start_point(content), ts_node_end_point(content),
+                              ts_node_start_byte(content), ts_node_end_byte(content)});
+    }
+}
+
+// ts_parser_set_included_ranges wants ranges in order and not overlapping.
+void normalize_ranges(std::vector<TSRange>& ranges) {
+    std::ranges::sort(ranges, {}, &TSRange::start_byte);
+    size_t kept = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (kept > 0 && ranges[i].start_byte <= ranges[kept - 1].end_byte) {
+            if (ranges[i].end_byte > ranges[kept - 1].end_byte) {
+                ranges[kept - 1].end_byte = ranges[i].end_byte;
+                ranges[kept - 1].end_point = ranges[i].end_point;
+            }
+        } else {
+            ranges[kept++] = ranges[i];
+        }
+    }
+    ranges.resize(kept);
+}
+
+bool same_ranges(const std::vector<TSRange>& a, const std::vector<TSRange>& b) {
+    return std::ranges::equal(a, b, [](const TSRange& x, const TSRange& y) {
+        return x.start_byte == y.start_byte && x.end_byte == y.end_byte;
+    });
+}
+
+bool parse_layer(InjectionLayer& layer, std::vector<TSRange>& ranges, const TSInput& input,
+                 std::vector<TSRange>& changed_ranges, const size_t* cancel_flag) {
+    if (!layer.parser) {
+        layer.parser.reset(ts_parser_new());
+        if (!ts_parser_set_language(layer.parser.get(), layer.language->config.factory())) {
+            return false;
+        }
+    }
+
+    TSParser* parser = layer.parser.get();
+    ts_parser_set_cancellation_flag(parser, cancel_flag);
+    ts_parser_set_included_ranges(parser, ranges.data(), static_cast<uint32_t>(ranges.size()));
+    TSTree* result = ts_parser_parse(parser, layer.tree.get(), input);
+    ts_parser_set_cancellation_flag(parser, nullptr);
+    if (!result) {
+        ts_parser_reset(parser);
+        return false;
+    }
+
+    if (layer.tree) {
+        uint32_t count = 0;
+        TSRange* changed = ts_tree_get_changed_ranges(layer.tree.get(), result, &count);
+        changed_ranges.insert(changed_ranges.end(), changed, changed + count);
+        free(changed);
+    } else {
+        changed_ranges.insert(changed_ranges.end(), ranges.begin(), ranges.end());
+    }
+
+    layer.tree.reset(result);
+    layer.ranges = std::move(ranges);
+    layer.dirty = false;
+    return true;
+}
+
+void edit_position(uint32_t& byte, TSPoint& point, const TSInputEdit& edit) {
+    if (byte <= edit.start_byte) return;
+    if (byte < edit.old_end_byte) {
+        byte = edit.new_end_byte;
+        point = edit.new_end_point;
+        return;
+    }
+    if (point.row == edit.old_end_point.row) {
+        point.column = point.column - edit.old_end_point.column + edit.new_end_point.column;
+    }
+    point.row = point.row - edit.old_end_point.row + edit.new_end_point.row;
+    byte = byte - edit.old_end_byte + edit.new_end_byte;
+}
+}
+
+void update_injection_layers(const TSTree* host_tree, const LoadedLanguage& host, const TSInput& input,
+                             std::vector<InjectionLayer>& layers, std::vector<TSRange>& changed_ranges,
+                             const size_t* cancel_flag) {
+    std::vector<InjectionLayer> updated;
+    std::vector<const LoadedLanguage*> parsed = {&host};
+    std::vector<std::pair<const TSTree*, const LoadedLanguage*>> level = {{host_tree, &host}};
+    std::vector<Injection> injections;
+    TSQueryCursorPtr cursor(ts_query_cursor_new());
+
+    for (int depth = 0; depth < MAX_INJECTION_DEPTH && !level.empty(); ++depth) {
+        injections.clear();
+        for (auto [tree, language] : level) {
+            collect_injections(tree, *language, input, cursor.get(), parsed, injections);
+        }
+        level.clear();
+
+        for (Injection& injection : injections) {
+            parsed.push_back(injection.language);
+            normalize_ranges(injection.ranges);
+
+            InjectionLayer layer;
+            layer.language = injection.language;
+            auto it = std::ranges::find(layers, injection.language, &InjectionLayer::language);
+            if (it != layers.end()) {
+                layer = std::move(*it);
+                layers.erase(it);
+            }
+
+            bool current = layer.tree && !layer.dirty && same_ranges(layer.ranges, injection.ranges);
+            if (!current && !parse_layer(layer, injection.ranges, input, changed_ranges, cancel_flag)) {
+                changed_ranges.insert(changed_ranges.end(), layer.ranges.begin(), layer.ranges.end());
+                continue;
+            }
+            level.emplace_back(layer.tree.get(), layer.language);
+            updated.push_back(std::move(layer));
+        }
+    }
+
+    // Text that no language claims any more falls back to the host's highlighting.
+    for (const InjectionLayer& stale : layers) {
+        changed_ranges.insert(changed_ranges.end(), stale.ranges.begin(), stale.ranges.end());
+    }
+    layers = std::move(updated);
+}
+
+void edit_injection_layers(std::vector<InjectionLayer>& layers, const TSInputEdit& edit) {
+    for (InjectionLayer& layer : layers) {
+        if (layer.tree) {
+            ts_tree_edit(layer.tree.get(), &edit);
+        }
+        for (TSRange& range : layer.ranges) {
+            if (edit.start_byte <= range.end_byte && edit.old_end_byte >= range.start_byte) {
+                layer.dirty = true;
+            }
+            edit_range(range, edit);
+        }
+    }
+}
+
+std::vector<InjectionLayer> fork_injection_layers(std::vector<InjectionLayer>& layers) {
+    std::vector<InjectionLayer> forked;
+    forked.reserve(layers.size());
+    for (InjectionLayer& layer : layers) {
+        InjectionLayer& copy = forked.emplace_back();
+        copy.language = layer.language;
+        copy.parser = std::move(layer.parser);
+        if (layer.tree) {
+            copy.tree.reset(ts_tree_copy(layer.tree.get()));
+        }
+        copy.ranges = layer.ranges;
+        copy.dirty = layer.dirty;
+    }
+    return forked;
+}
+
+void edit_range(TSRange& range, const TSInputEdit& edit) {
+    edit_position(range.start_byte, range.start_point, edit);
+    edit_position(range.end_byte, range.end_point, edit);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Types.h"
+#include "HandleTypes.h"
+#include "LanguageRegistry.h"
+#include <vector>
+
+// One language embedded in a document. Every range the injection queries hand
+// to that language is parsed together into a single tree, with the parser
+// limited to those ranges through ts_parser_set_included_ranges.
+struct InjectionLayer {
+    LoadedLanguage* language = nullptr;
+    TSParserPtr parser;
+    TSTreePtr tree;
+    std::vector<TSRange> ranges;
+    // An edit touched one of ranges since tree was parsed.
+    bool dirty = false;
+};
+
+// Injections nest (PHP hands text to HTML, which hands scripts to JavaScript),
+// but only this many levels deep and with each language parsed once.
+constexpr int MAX_INJECTION_DEPTH = 3;
+
+// Finds the injected ranges of host_tree and brings layers up to date with
+// them. A layer whose ranges neither moved nor were edited keeps its tree;
+// the rest are reparsed incrementally from their previous tree. Spans whose
+// injected syntax changed are appended to changed_ranges.
+void update_injection_layers(const TSTree* host_tree, const LoadedLanguage& host, const TSInput& input,
+                             std::vector<InjectionLayer>& layers, std::vector<TSRange>& changed_ranges,
+                             const size_t* cancel_flag);
+
+// Applies a document edit to every layer's tree and ranges.
+void edit_injection_layers(std::vector<InjectionLayer>& layers, const TSInputEdit& edit);
+
+// Copies the trees of layers for a background parse, which takes over their parsers.
+std::vector<InjectionLayer> fork_injection_layers(std::vector<InjectionLayer>& layers);
+
+void edit_range(TSRange& range, const TSInputEdit& edit);
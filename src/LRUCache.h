@@ -29,6 +29,12 @@ public:
         return &it->second;
     }
 
+    // Like get(), but leaves the entry's place in the eviction order alone.
+    Value* peek(const Key& key) {
+        auto it = cache_.find(key);
+        return it == cache_.end() ? nullptr : &it->second;
+    }
+
     Value& get_or_create(const Key& key) {
         touch(key);
         evict_if_needed();
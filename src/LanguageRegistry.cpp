@@ -219,6 +219,12 @@ constexpr const char* MARKDOWN_QUERY = R"scm(
 (thematic_break) @operator
 )scm";
 
+constexpr const char* MARKDOWN_INJECTION_QUERY = R"scm(
+(fenced_code_block
+  (info_string (language) @injection.language)
+  (code_fence_content) @injection.content)
+)scm";
+
 constexpr const char* YAML_QUERY = R"scm(
 (comment) @comment
 (string_scalar) @string
@@ -439,6 +445,11 @@ constexpr const char* HTML_QUERY = R"scm(
 ["="] @operator
 )scm";
 
+constexpr const char* HTML_INJECTION_QUERY = R"scm(
+(script_element (raw_text) @javascript)
+(style_element (raw_text) @css)
+)scm";
+
 constexpr const char* CSS_QUERY = R"scm(
 (comment) @comment
 (string_value) @string
@@ -525,6 +536,10 @@ constexpr const char* PHP_QUERY = R"scm(
 ] @keyword
 )scm";
 
+constexpr const char* PHP_INJECTION_QUERY = R"scm(
+(text) @html
+)scm";
+
 constexpr const char* BASH_QUERY = R"scm(
 (comment) @comment
 
@@ -717,7 +732,19 @@ void LanguageRegistry::build_capture_map(LoadedLanguage& lang) {
     }
 }
 
+static TSQuery* compile_query(const TSLanguage* language, const char* source, const std::string& language_id) {
+    uint32_t error_offset;
+    TSQueryError error_type;
+    TSQuery* query = ts_query_new(language, source, static_cast<uint32_t>(strlen(source)), &error_offset, &error_type);
+    if (!query) {
+        fprintf(stderr, "Query compilation error for %s at offset %u, type %d\n",
+                language_id.c_str(), error_offset, error_type);
+    }
+    return query;
+}
+
 LoadedLanguage* LanguageRegistry::get_or_load(const std::string& language_id) {
+    std::lock_guard lock(loaded_mutex_);
     auto it = loaded_.find(language_id);
     if (it != loaded_.end()) {
         return it->second.get();
@@ -735,38 +762,39 @@ LoadedLanguage* LanguageRegistry::get_or_load(const std::string& language_id) {
     auto loaded = std::make_unique<LoadedLanguage>();
     loaded->config = def->config_factory();
 
-    uint32_t error_offset;
-    TSQueryError error_type;
-    loaded->query_owned.reset(ts_query_new(
-        loaded->config.factory(),
-        loaded->config.query_source,
-        static_cast<uint32_t>(strlen(loaded->config.query_source)),
-        &error_offset,
-        &error_type
-    ));
+    const TSLanguage* ts_language = loaded->config.factory();
+    loaded->query_owned.reset(compile_query(ts_language, loaded->config.query_source, language_id));
     loaded->query = loaded->query_owned.get();
-
-    if (!loaded->query) {
-        fprintf(stderr, "Query compilation error for %s at offset %u, type %d\n",
-                language_id.c_str(), error_offset, error_type);
-    } else {
+    if (loaded->query) {
         build_capture_map(*loaded);
     }
+    if (loaded->config.injection_query) {
+        loaded->injection_query.reset(compile_query(ts_language, loaded->config.injection_query, language_id));
+    }
 
     LoadedLanguage* ptr = loaded.get();
     loaded_[language_id] = std::move(loaded);
     return ptr;
 }
 
+LoadedLanguage* LanguageRegistry::load_injected(const std::string& name) {
+    if (LoadedLanguage* language = get_or_load(name)) return language;
+    const LanguageDefinition* def = find_by_extension(name);
+    return def ? get_or_load(def->id) : nullptr;
+}
+
 void LanguageRegistry::unload(const std::string& language_id) {
+    std::lock_guard lock(loaded_mutex_);
     loaded_.erase(language_id);
 }
 
 void LanguageRegistry::unload_all() {
+    std::lock_guard lock(loaded_mutex_);
     loaded_.clear();
 }
 
 bool LanguageRegistry::is_loaded(const std::string& language_id) const {
+    std::lock_guard lock(loaded_mutex_);
     return loaded_.find(language_id) != loaded_.end();
 }
 
@@ -832,7 +860,7 @@ void register_all_languages() {
     //     {"md", "markdown", "mkd", "mkdn"},
     //     {"README", "CHANGELOG"},
     //     []() -> LanguageConfig {
-    //         return {"markdown", tree_sitter_markdown, MARKDOWN_QUERY, "", {}, {}, {}};
+    //         return {"markdown", tree_sitter_markdown, MARKDOWN_QUERY, "", {}, {}, {}, MARKDOWN_INJECTION_QUERY};
     //     }
     // });
 
@@ -984,7 +1012,8 @@ void register_all_languages() {
                 "",
                 {"<!--", "-->"},
                 {{'<', '>'}, {'"', '"'}, {'\'', '\''}},
-                {}
+                {},
+                HTML_INJECTION_QUERY
             };
         }
     });
@@ -1018,7 +1047,8 @@ void register_all_languages() {
                 "//",
                 {"/*", "*/"},
                 {{'(', ')'}, {'[', ']'}, {'{', '}'}, {'"', '"'}, {'\'', '\''}},
-                {'{'}
+                {'{'},
+                PHP_INJECTION_QUERY
             };
         }
     });
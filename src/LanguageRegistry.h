@@ -7,6 +7,7 @@
 #include <vector>
 #include <functional>
 #include <memory>
+#include <mutex>
 
 using LanguageFactory = const TSLanguage* (*)();
 
@@ -28,6 +29,10 @@ struct LanguageConfig {
     BlockComment block_comment;
     std::vector<AutoPair> auto_pairs;
     std::vector<char> indent_triggers;
+    // Captures name the language their node is parsed as: either a language id
+    // or extension directly (@javascript), or @injection.content paired with an
+    // @injection.language capture whose text names it.
+    const char* injection_query = nullptr;
 };
 
 inline const std::vector<AutoPair> DEFAULT_AUTO_PAIRS = {
@@ -52,6 +57,7 @@ struct LoadedLanguage {
     TSQuery* query = nullptr;
     TSQueryPtr query_owned;
     std::vector<TokenType> capture_map;
+    TSQueryPtr injection_query;
 };
 
 class LanguageRegistry {
@@ -62,7 +68,10 @@ public:
     const LanguageDefinition* find_by_extension(const std::string& ext) const;
     const LanguageDefinition* find_by_filename(const std::string& filename) const;
     const LanguageDefinition* detect_language(const std::string& filepath) const;
+    // Safe to call from parse workers; loaded languages live until unloaded.
     LoadedLanguage* get_or_load(const std::string& language_id);
+    // Resolves a language id or file extension, as written in an injection.
+    LoadedLanguage* load_injected(const std::string& name);
     void unload(const std::string& language_id);
     void unload_all();
     bool is_loaded(const std::string& language_id) const;
@@ -77,6 +86,7 @@ private:
     std::unordered_map<std::string, std::string> ext_to_id_;
     std::unordered_map<std::string, std::string> filename_to_id_;
     std::unordered_map<std::string, std::unique_ptr<LoadedLanguage>> loaded_;
+    mutable std::mutex loaded_mutex_;
 
     void build_capture_map(LoadedLanguage& lang);
 };
@@ -0,0 +1,256 @@
+#include "LineOffsetTree.h"
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
+void LineOffsetTree::build_from_lines(const LineStore& lines) {
+    clear();
+    chunks.reserve(lines.size() / CHUNK_TARGET + 1);
+
+    lines.for_each_view([&](std::string_view line) {
+        if (chunks.empty() || chunks.back()->lines() >= CHUNK_TARGET) {
+            chunks.push_back(std::make_shared<Chunk>());
+            chunks.back()->starts.reserve(CHUNK_TARGET + 1);
+        }
+        Chunk& c = *chunks.back();
+        c.starts.push_back(c.bytes() + static_cast<ByteOff>(line.size() + 1));
+    });
+
+    actual_lines = lines.size();
+    for (const auto& c : chunks) {
+        total += c->bytes();
+    }
+    rebuild_index();
+}
+
+void LineOffsetTree::update(LineIdx line_idx, int64_t delta) {
+    if (delta == 0) return;
+    auto [chunk, offset] = locate_line(static_cast<size_t>(line_idx));
+    std::vector<ByteOff>& starts = own(chunk);
+    for (size_t k = offset + 1; k < starts.size(); ++k) {
+        starts[k] += delta;
+    }
+    index_add(chunk, 0, static_cast<ByteOff>(delta));
+    total += delta;
+}
+
+LineIdx LineOffsetTree::find_line_by_offset(ByteOff byte_offset) const {
+    size_t n = chunks.size();
+    size_t pos = 0;
+    size_t lines_before = 0;
+    ByteOff rem = byte_offset;
+    for (size_t mask = std::bit_floor(n); mask > 0; mask >>= 1) {
+        size_t next = pos + mask;
+        if (next <= n && index[next].bytes <= rem) {
+            pos = next;
+            rem -= index[next].bytes;
+            lines_before += index[next].lines;
+        }
+    }
+    if (pos == n) return static_cast<LineIdx>(actual_lines);
+
+    const std::vector<ByteOff>& starts = chunks[pos]->starts;
+    size_t in_chunk = std::upper_bound(starts.begin() + 1, starts.end(), rem) - (starts.begin() + 1);
+    return static_cast<LineIdx>(lines_before + in_chunk);
+}
+
+void LineOffsetTree::insert_lines(LineIdx line_idx, const std::vector<ByteOff>& lengths) {
+    if (lengths.empty()) return;
+
+    size_t line = static_cast<size_t>(line_idx);
+    if (line >= actual_lines) {
+        for (ByteOff length : lengths) {
+            append_line(length);
+        }
+        return;
+    }
+
+    size_t count = lengths.size();
+    ByteOff added = std::accumulate(lengths.begin(), lengths.end(), ByteOff{0});
+    auto [chunk, offset] = locate_line(line);
+    std::vector<ByteOff>& starts = own(chunk);
+    actual_lines += count;
+    total += added;
+
+    if (starts.size() - 1 + count <= CHUNK_MAX) {
+        std::vector<ByteOff> fresh(count);
+        ByteOff at = starts[offset];
+        for (size_t i = 0; i < count; ++i) {
+            fresh[i] = at;
+            at += lengths[i];
+        }
+        for (size_t k = offset; k < starts.size(); ++k) {
+            starts[k] += added;
+        }
+        starts.insert(starts.begin() + offset, fresh.begin(), fresh.end());
+        index_add(chunk, static_cast<ptrdiff_t>(count), added);
+        return;
+    }
+
+    std::vector<ByteOff> pending(lengths);
+    for (size_t k = offset; k + 1 < starts.size(); ++k) {
+        pending.push_back(starts[k + 1] - starts[k]);
+    }
+    starts.resize(offset + 1);
+
+    size_t i = 0;
+    while (i < pending.size() && starts.size() - 1 < CHUNK_TARGET) {
+        starts.push_back(starts.back() + pending[i++]);
+    }
+
+    std::vector<std::shared_ptr<Chunk>> fresh;
+    while (i < pending.size()) {
+        auto c = std::make_shared<Chunk>();
+        size_t take = std::min(CHUNK_TARGET, pending.size() - i);
+        c->starts.reserve(take + 1);
+        for (size_t k = 0; k < take; ++k) {
+            c->starts.push_back(c->bytes() + pending[i++]);
+        }
+        fresh.push_back(std::move(c));
+    }
+
+    chunks.insert(chunks.begin() + chunk + 1,
+                  std::make_move_iterator(fresh.begin()), std::make_move_iterator(fresh.end()));
+    rebuild_index();
+}
+
+void LineOffsetTree::append_line(ByteOff length) {
+    if (chunks.empty() || chunks.back()->lines() >= CHUNK_TARGET) {
+        auto c = std::make_shared<Chunk>();
+        c->starts.reserve(CHUNK_TARGET + 1);
+        c->starts.push_back(length);
+        chunks.push_back(std::move(c));
+        index_append(*chunks.back());
+    } else {
+        std::vector<ByteOff>& starts = own(chunks.size() - 1);
+        starts.push_back(starts.back() + length);
+        index_add(chunks.size() - 1, 1, length);
+    }
+    actual_lines++;
+    total += length;
+}
+
+void LineOffsetTree::remove_lines(LineIdx first, LineIdx last) {
+    size_t begin = static_cast<size_t>(first);
+    size_t end = std::min(static_cast<size_t>(last), actual_lines);
+    if (begin >= end) return;
+
+    auto [chunk, offset] = locate_line(begin);
+    size_t remaining = end - begin;
+    actual_lines -= remaining;
+
+    bool structural = false;
+    size_t ci = chunk;
+    while (remaining > 0) {
+        size_t lines = chunks[ci]->lines();
+
+        if (offset == 0 && remaining >= lines) {
+            remaining -= lines;
+            total -= chunks[ci]->bytes();
+            chunks.erase(chunks.begin() + ci);
+            structural = true;
+            continue;
+        }
+
+        std::vector<ByteOff>& starts = own(ci);
+        size_t take = std::min(remaining, lines - offset);
+        ByteOff removed = starts[offset + take] - starts[offset];
+        starts.erase(starts.begin() + offset + 1, starts.begin() + offset + take + 1);
+        for (size_t k = offset + 1; k < starts.size(); ++k) {
+            starts[k] -= removed;
+        }
+        total -= removed;
+        remaining -= take;
+
+        if (!structural) {
+            index_add(ci, -static_cast<ptrdiff_t>(take), static_cast<ByteOff>(0) - removed);
+        }
+        offset = 0;
+        ci++;
+    }
+
+    if (structural) {
+        rebuild_index();
+    }
+    merge_small_chunk(std::min(chunk, chunks.empty() ? 0 : chunks.size() - 1));
+}
+
+std::vector<ByteOff>& LineOffsetTree::own(size_t chunk) {
+    if (chunks[chunk].use_count() > 1) {
+        chunks[chunk] = std::make_shared<Chunk>(*chunks[chunk]);
+    }
+    return chunks[chunk]->starts;
+}
+
+std::pair<size_t, size_t> LineOffsetTree::locate_line(size_t line) const {
+    size_t n = chunks.size();
+    size_t pos = 0;
+    size_t rem = line;
+    for (size_t mask = std::bit_floor(n); mask > 0; mask >>= 1) {
+        size_t next = pos + mask;
+        if (next <= n && index[next].lines <= rem) {
+            pos = next;
+            rem -= index[next].lines;
+        }
+    }
+    return {pos, rem};
+}
+
+ByteOff LineOffsetTree::prefix_bytes(size_t chunk) const {
+    ByteOff sum = 0;
+    for (size_t i = chunk; i > 0; i -= i & (~i + 1)) {
+        sum += index[i].bytes;
+    }
+    return sum;
+}
+
+void LineOffsetTree::index_add(size_t chunk, ptrdiff_t lines, ByteOff bytes) {
+    size_t n = chunks.size();
+    for (size_t i = chunk + 1; i <= n; i += i & (~i + 1)) {
+        index[i].lines += lines;
+        index[i].bytes += bytes;
+    }
+}
+
+void LineOffsetTree::index_append(const Chunk& chunk) {
+    if (index.empty()) index.emplace_back();
+    size_t i = chunks.size();
+    size_t low = i & (~i + 1);
+    IndexNode node{chunk.lines(), chunk.bytes()};
+    for (size_t j = i - 1; j > i - low; j -= j & (~j + 1)) {
+        node.lines += index[j].lines;
+        node.bytes += index[j].bytes;
+    }
+    index.push_back(node);
+}
+
+void LineOffsetTree::rebuild_index() {
+    size_t n = chunks.size();
+    index.assign(n + 1, IndexNode{});
+    for (size_t i = 1; i <= n; ++i) {
+        index[i].lines += chunks[i - 1]->lines();
+        index[i].bytes += chunks[i - 1]->bytes();
+        size_t parent = i + (i & (~i + 1));
+        if (parent <= n) {
+            index[parent].lines += index[i].lines;
+            index[parent].bytes += index[i].bytes;
+        }
+    }
+}
+
+void LineOffsetTree::merge_small_chunk(size_t chunk) {
+    if (chunks.size() < 2 || chunk >= chunks.size()) return;
+    if (chunks[chunk]->lines() >= CHUNK_MIN) return;
+
+    size_t left = (chunk + 1 < chunks.size()) ? chunk : chunk - 1;
+    if (chunks[left]->lines() + chunks[left + 1]->lines() > CHUNK_MAX) return;
+
+    std::vector<ByteOff>& a = own(left);
+    const std::vector<ByteOff>& b = chunks[left + 1]->starts;
+    ByteOff base = a.back();
+    for (size_t k = 1; k < b.size(); ++k) {
+        a.push_back(base + b[k]);
+    }
+    chunks.erase(chunks.begin() + left + 1);
+    rebuild_index();
+}
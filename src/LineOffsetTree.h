@@ -1,126 +1,103 @@
 #pragma once
 
 #include "Types.h"
+#include "LineStore.h"
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 #include <string>
-
+#include <utility>
+#include <memory>
+
+// Byte offsets of line starts. Line lengths (including the newline) live in
+// chunks of a few hundred lines, each keeping its local prefix sums; a
+// Fenwick tree over per-chunk line and byte totals finds a chunk in
+// O(log chunks). Inserting or removing a line only touches its own chunk.
+// Copies share chunks the same way LineStore does.
 class LineOffsetTree {
 public:
-    void build_from_lines(const std::vector<std::string>& lines) {
-        actual_lines = lines.size();
-        size = 1;
-        while (size <= actual_lines) size *= 2;
-
-        tree.assign(size + 1, 0);
-        line_lengths.resize(actual_lines);
-
-        for (size_t i = 0; i < actual_lines; ++i) {
-            line_lengths[i] = static_cast<ByteOff>(lines[i].size() + 1);
-        }
-
-        for (size_t i = 1; i <= actual_lines; ++i) {
-            tree[i] += line_lengths[i - 1];
-            size_t parent = i + (i & -i);
-            if (parent <= size) {
-                tree[parent] += tree[i];
-            }
-        }
-    }
+    static constexpr size_t CHUNK_TARGET = 512;
+    static constexpr size_t CHUNK_MAX = CHUNK_TARGET * 2;
+    static constexpr size_t CHUNK_MIN = CHUNK_TARGET / 4;
 
-    void update(LineIdx line_idx, int delta) {
-        if (delta == 0) return;
-        line_lengths[line_idx] += delta;
-        size_t index = line_idx + 1;
-        while (index <= size) {
-            tree[index] += delta;
-            index += index & (-index);
-        }
-    }
+    void build_from_lines(const LineStore& lines);
+
+    void update(LineIdx line_idx, int64_t delta);
 
     ByteOff get_line_start_offset(LineIdx line_idx) const {
-        ByteOff sum = 0;
-        size_t index = static_cast<size_t>(line_idx);
-        while (index > 0) {
-            sum += tree[index];
-            index -= index & (-index);
-        }
-        return sum;
+        size_t line = static_cast<size_t>(line_idx);
+        if (line >= actual_lines) return total;
+        auto [chunk, offset] = locate_line(line);
+        return prefix_bytes(chunk) + chunks[chunk]->starts[offset];
     }
 
     ByteOff get_line_end_offset(LineIdx line_idx) const {
         return get_line_start_offset(line_idx + 1);
     }
 
-    LineIdx find_line_by_offset(ByteOff byte_offset) const {
-        size_t idx = 0;
-        ByteOff current_sum = 0;
-
-        for (size_t mask = size / 2; mask > 0; mask >>= 1) {
-            size_t next_idx = idx + mask;
-            if (next_idx <= actual_lines && current_sum + tree[next_idx] <= byte_offset) {
-                idx = next_idx;
-                current_sum += tree[idx];
-            }
-        }
-        return static_cast<LineIdx>(idx);
-    }
+    LineIdx find_line_by_offset(ByteOff byte_offset) const;
 
     void insert_line(LineIdx line_idx, ByteOff length) {
-        line_lengths.insert(line_lengths.begin() + line_idx, length);
-        actual_lines++;
-        if (actual_lines > size) {
-            size *= 2;
-        }
-        rebuild_tree();
+        insert_lines(line_idx, std::vector<ByteOff>{length});
     }
 
+    void insert_lines(LineIdx line_idx, const std::vector<ByteOff>& lengths);
+    void append_line(ByteOff length);
+
     void remove_line(LineIdx line_idx) {
-        line_lengths.erase(line_lengths.begin() + line_idx);
-        actual_lines--;
-        rebuild_tree();
+        remove_lines(line_idx, line_idx + 1);
     }
 
+    void remove_lines(LineIdx first, LineIdx last);
+
     void set_line_length(LineIdx line_idx, ByteOff new_length) {
-        int delta = static_cast<int>(new_length) - static_cast<int>(line_lengths[line_idx]);
+        int64_t delta = static_cast<int64_t>(new_length) - static_cast<int64_t>(get_line_length(line_idx));
         update(line_idx, delta);
     }
 
     ByteOff get_line_length(LineIdx line_idx) const {
-        return line_lengths[line_idx];
+        auto [chunk, offset] = locate_line(static_cast<size_t>(line_idx));
+        const std::vector<ByteOff>& starts = chunks[chunk]->starts;
+        return starts[offset + 1] - starts[offset];
     }
 
     size_t line_count() const { return actual_lines; }
 
-    ByteOff total_bytes() const {
-        return get_line_start_offset(static_cast<LineIdx>(actual_lines));
-    }
+    ByteOff total_bytes() const { return total; }
 
     void clear() {
-        tree.clear();
-        line_lengths.clear();
+        chunks.clear();
+        index.clear();
         actual_lines = 0;
-        size = 0;
+        total = 0;
     }
 
     bool empty() const { return actual_lines == 0; }
 
 private:
-    std::vector<ByteOff> tree;
-    std::vector<ByteOff> line_lengths;
-    size_t size = 0;
-    size_t actual_lines = 0;
+    // starts[i] is the offset of line i within the chunk; starts.back() is the chunk size.
+    struct Chunk {
+        std::vector<ByteOff> starts{0};
 
-    void rebuild_tree() {
-        size = 1;
-        while (size <= actual_lines) size *= 2;
-        tree.assign(size + 1, 0);
-        for (size_t i = 1; i <= actual_lines; ++i) {
-            tree[i] += line_lengths[i - 1];
-            size_t parent = i + (i & -i);
-            if (parent <= size) {
-                tree[parent] += tree[i];
-            }
-        }
-    }
+        size_t lines() const { return starts.size() - 1; }
+        ByteOff bytes() const { return starts.back(); }
+    };
+
+    struct IndexNode {
+        size_t lines = 0;
+        ByteOff bytes = 0;
+    };
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    std::vector<IndexNode> index;
+    size_t actual_lines = 0;
+    ByteOff total = 0;
+
+    std::vector<ByteOff>& own(size_t chunk);
+    std::pair<size_t, size_t> locate_line(size_t line) const;
+    ByteOff prefix_bytes(size_t chunk) const;
+    void index_add(size_t chunk, ptrdiff_t lines, ByteOff bytes);
+    void index_append(const Chunk& chunk);
+    void rebuild_index();
+    void merge_small_chunk(size_t chunk);
 };
@@ -0,0 +1,285 @@
+#include "LineStore.h"
+#include <algorithm>
+#include <bit>
+
+void LineStore::Chunk::materialize() {
+    size_t n = starts.size() - 1;
+    lines.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        lines.emplace_back(view(i));
+    }
+}
+
+std::shared_ptr<LineStore::Chunk> LineStore::Chunk::clone() const {
+    auto copy = std::make_shared<Chunk>();
+    if (mapped) {
+        copy->mapped = mapped;
+        copy->starts = starts;
+        copy->strip_cr = strip_cr;
+        copy->ends_with_newline = ends_with_newline;
+    } else {
+        copy->lines = lines;
+    }
+    return copy;
+}
+
+std::vector<std::string>& LineStore::own(size_t chunk) {
+    // Only this thread creates snapshots, so a count of 1 cannot grow behind our back.
+    if (chunks[chunk].use_count() > 1) {
+        chunks[chunk] = chunks[chunk]->clone();
+    }
+
+    Chunk& c = *chunks[chunk];
+    if (c.mapped) {
+        std::call_once(c.materialized, [&c] { c.materialize(); });
+        c.mapped = nullptr;
+        c.starts.clear();
+        c.starts.shrink_to_fit();
+    }
+    return c.lines;
+}
+
+void LineStore::append_mapped(const char* base, std::vector<uint64_t>&& starts, bool strip_cr,
+                              bool ends_with_newline) {
+    if (starts.size() < 2) return;
+    auto chunk = std::make_shared<Chunk>();
+    chunk->mapped = base;
+    chunk->starts = std::move(starts);
+    chunk->strip_cr = strip_cr;
+    chunk->ends_with_newline = ends_with_newline;
+    size_t count = chunk->size();
+    chunks.push_back(std::move(chunk));
+    index_append(count);
+    total += count;
+}
+
+size_t LineStore::detach_backing(size_t readable_bytes) {
+    if (!backing) return 0;
+
+    size_t lost = 0;
+    for (auto& chunk : chunks) {
+        Chunk& c = *chunk;
+        if (!c.mapped) continue;
+
+        // Snapshots may share the chunk, so it is replaced rather than changed.
+        auto copy = std::make_shared<Chunk>();
+        size_t n = c.size();
+        size_t chunk_offset = static_cast<size_t>(c.mapped - backing->data());
+        copy->lines.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (chunk_offset + c.starts[i + 1] - 1 <= readable_bytes) {
+                copy->lines.emplace_back(c.view(i));
+            } else {
+                copy->lines.emplace_back();
+                lost++;
+            }
+        }
+        chunk = std::move(copy);
+    }
+    backing.reset();
+    return lost;
+}
+
+std::pair<size_t, size_t> LineStore::locate(size_t idx) const {
+    size_t n = chunks.size();
+    size_t pos = 0;
+    size_t rem = idx;
+    for (size_t mask = std::bit_floor(n); mask > 0; mask >>= 1) {
+        size_t next = pos + mask;
+        if (next <= n && index[next] <= rem) {
+            pos = next;
+            rem -= index[next];
+        }
+    }
+    return {pos, rem};
+}
+
+void LineStore::index_add(size_t chunk, ptrdiff_t delta) {
+    size_t n = chunks.size();
+    for (size_t i = chunk + 1; i <= n; i += i & (~i + 1)) {
+        index[i] += delta;
+    }
+}
+
+void LineStore::index_append(size_t count) {
+    if (index.empty()) index.push_back(0);
+    size_t i = chunks.size();
+    size_t low = i & (~i + 1);
+    size_t value = count;
+    for (size_t j = i - 1; j > i - low; j -= j & (~j + 1)) {
+        value += index[j];
+    }
+    index.push_back(value);
+}
+
+void LineStore::rebuild_index() {
+    size_t n = chunks.size();
+    index.assign(n + 1, 0);
+    for (size_t i = 1; i <= n; ++i) {
+        index[i] += chunks[i - 1]->size();
+        size_t parent = i + (i & (~i + 1));
+        if (parent <= n) {
+            index[parent] += index[i];
+        }
+    }
+}
+
+void LineStore::split_chunk(size_t chunk) {
+    std::vector<std::string>& src = own(chunk);
+    size_t half = src.size() / 2;
+    auto tail = std::make_shared<Chunk>();
+    tail->lines.assign(std::make_move_iterator(src.begin() + half), std::make_move_iterator(src.end()));
+    src.erase(src.begin() + half, src.end());
+    chunks.insert(chunks.begin() + chunk + 1, std::move(tail));
+    rebuild_index();
+}
+
+void LineStore::merge_small_chunk(size_t chunk) {
+    if (chunks.size() < 2 || chunk >= chunks.size()) return;
+    if (chunks[chunk]->size() >= CHUNK_MIN) return;
+
+    size_t left = (chunk + 1 < chunks.size()) ? chunk : chunk - 1;
+    if (chunks[left]->size() + chunks[left + 1]->size() > CHUNK_MAX) return;
+
+    std::vector<std::string>& a = own(left);
+    std::vector<std::string>& b = own(left + 1);
+
+    a.insert(a.end(), std::make_move_iterator(b.begin()), std::make_move_iterator(b.end()));
+    chunks.erase(chunks.begin() + left + 1);
+    rebuild_index();
+}
+
+void LineStore::insert(size_t idx, std::string line) {
+    if (idx >= total) {
+        emplace_back(std::move(line));
+        return;
+    }
+
+    auto [chunk, offset] = locate(idx);
+    std::vector<std::string>& target = own(chunk);
+    target.insert(target.begin() + offset, std::move(line));
+    total++;
+
+    if (target.size() > CHUNK_MAX) {
+        split_chunk(chunk);
+    } else {
+        index_add(chunk, 1);
+    }
+}
+
+void LineStore::insert(size_t idx, std::vector<std::string>&& new_lines) {
+    size_t count = new_lines.size();
+    if (count == 0) return;
+
+    if (idx >= total) {
+        for (auto& line : new_lines) {
+            emplace_back(std::move(line));
+        }
+        return;
+    }
+
+    auto [chunk, offset] = locate(idx);
+    std::vector<std::string>& target = own(chunk);
+
+    if (target.size() + count <= CHUNK_MAX) {
+        target.insert(target.begin() + offset,
+                      std::make_move_iterator(new_lines.begin()), std::make_move_iterator(new_lines.end()));
+        total += count;
+        index_add(chunk, static_cast<ptrdiff_t>(count));
+        return;
+    }
+
+    std::vector<std::string> tail(std::make_move_iterator(target.begin() + offset), std::make_move_iterator(target.end()));
+    target.erase(target.begin() + offset, target.end());
+
+    size_t i = 0;
+    while (i < count && target.size() < CHUNK_TARGET) {
+        target.push_back(std::move(new_lines[i++]));
+    }
+
+    std::vector<std::shared_ptr<Chunk>> fresh;
+    while (i < count) {
+        size_t take = std::min(CHUNK_TARGET, count - i);
+        auto c = std::make_shared<Chunk>();
+        c->lines.reserve(take);
+        for (size_t k = 0; k < take; ++k) {
+            c->lines.push_back(std::move(new_lines[i++]));
+        }
+        fresh.push_back(std::move(c));
+    }
+
+    if (!tail.empty()) {
+        std::vector<std::string>& last = fresh.empty() ? target : fresh.back()->lines;
+        if (last.size() + tail.size() <= CHUNK_MAX) {
+            last.insert(last.end(), std::make_move_iterator(tail.begin()), std::make_move_iterator(tail.end()));
+        } else {
+            auto c = std::make_shared<Chunk>();
+            c->lines = std::move(tail);
+            fresh.push_back(std::move(c));
+        }
+    }
+
+    chunks.insert(chunks.begin() + chunk + 1,
+                  std::make_move_iterator(fresh.begin()), std::make_move_iterator(fresh.end()));
+    total += count;
+    rebuild_index();
+}
+
+void LineStore::erase(size_t first, size_t last) {
+    last = std::min(last, total);
+    if (first >= last) return;
+
+    auto [chunk, offset] = locate(first);
+    size_t remaining = last - first;
+    total -= remaining;
+
+    bool structural = false;
+    size_t ci = chunk;
+    while (remaining > 0) {
+        if (offset == 0 && remaining >= chunks[ci]->size()) {
+            remaining -= chunks[ci]->size();
+            chunks.erase(chunks.begin() + ci);
+            structural = true;
+            continue;
+        }
+
+        std::vector<std::string>& c = own(ci);
+        size_t take = std::min(remaining, c.size() - offset);
+        c.erase(c.begin() + offset, c.begin() + offset + take);
+        remaining -= take;
+        offset = 0;
+
+        if (c.empty()) {
+            chunks.erase(chunks.begin() + ci);
+            structural = true;
+        } else {
+            if (!structural) {
+                index_add(ci, -static_cast<ptrdiff_t>(take));
+            }
+            ci++;
+        }
+    }
+
+    if (structural) {
+        rebuild_index();
+    }
+    merge_small_chunk(std::min(chunk, chunks.empty() ? 0 : chunks.size() - 1));
+}
+
+void LineStore::clear() {
+    chunks.clear();
+    index.clear();
+    total = 0;
+    backing.reset();
+}
+
+void LineStore::reserve(size_t line_count) {
+    size_t chunk_count = line_count / CHUNK_TARGET + 1;
+    chunks.reserve(chunk_count);
+    index.reserve(chunk_count + 1);
+}
+
+void LineStore::shrink_to_fit() {
+    chunks.shrink_to_fit();
+    index.shrink_to_fit();
+}
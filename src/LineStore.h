@@ -0,0 +1,185 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+// Line storage split into chunks of a few hundred lines. A Fenwick tree over
+// chunk sizes maps a line index to its chunk in O(log chunks), so an edit only
+// shifts the lines of the chunk it touches instead of the whole buffer.
+//
+// Chunks created by append_mapped() read straight from a MappedFile and only
+// build their std::string lines on first access; the first edit to a chunk
+// detaches it from the mapping.
+//
+// Copies share chunks: snapshot() costs O(chunks), and an edit to a chunk that
+// is still shared with a snapshot works on a private copy of that chunk.
+class LineStore {
+public:
+    static constexpr size_t CHUNK_TARGET = 256;
+    static constexpr size_t CHUNK_MAX = CHUNK_TARGET * 2;
+    static constexpr size_t CHUNK_MIN = CHUNK_TARGET / 4;
+
+    struct Chunk {
+        std::vector<std::string> lines;
+        const char* mapped = nullptr;
+        std::vector<uint64_t> starts;
+        bool strip_cr = false;
+        // False when the chunk's last line is the file's last and has no '\n'.
+        bool ends_with_newline = true;
+        std::once_flag materialized;
+
+        size_t size() const { return mapped ? starts.size() - 1 : lines.size(); }
+        std::shared_ptr<Chunk> clone() const;
+        std::string_view view(size_t i) const {
+            size_t len = starts[i + 1] - starts[i] - 1;
+            // Only a '\r' right before a '\n' is part of the line ending.
+            bool has_newline = i + 2 < starts.size() || ends_with_newline;
+            if (strip_cr && has_newline && len > 0 && mapped[starts[i] + len - 1] == '\r') len--;
+            return {mapped + starts[i], len};
+        }
+        void materialize();
+    };
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string*;
+        using reference = const std::string&;
+
+        const_iterator() = default;
+        const_iterator(const LineStore* store, size_t chunk, size_t offset)
+            : store(store), chunk(chunk), offset(offset) {}
+
+        reference operator*() const { return store->chunk_line(chunk, offset); }
+        pointer operator->() const { return &store->chunk_line(chunk, offset); }
+
+        const_iterator& operator++() {
+            if (++offset >= store->chunks[chunk]->size()) {
+                chunk++;
+                offset = 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return chunk == other.chunk && offset == other.offset;
+        }
+
+    private:
+        const LineStore* store = nullptr;
+        size_t chunk = 0;
+        size_t offset = 0;
+    };
+
+    size_t size() const { return total; }
+    bool empty() const { return total == 0; }
+
+    const std::string& operator[](size_t idx) const {
+        auto [chunk, offset] = locate(idx);
+        return chunk_line(chunk, offset);
+    }
+
+    std::string& operator[](size_t idx) {
+        auto [chunk, offset] = locate(idx);
+        return own(chunk)[offset];
+    }
+
+    std::string_view view(size_t idx) const {
+        auto [chunk, offset] = locate(idx);
+        return chunk_view(chunk, offset);
+    }
+
+    const std::string& back() const { return chunk_line(chunks.size() - 1, chunks.back()->size() - 1); }
+    std::string& back() { return own(chunks.size() - 1).back(); }
+
+    const_iterator begin() const { return {this, 0, 0}; }
+    const_iterator end() const { return {this, chunks.size(), 0}; }
+
+    template <typename Fn>
+    void for_each_view(Fn&& fn) const {
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            size_t n = chunks[c]->size();
+            for (size_t i = 0; i < n; ++i) {
+                fn(chunk_view(c, i));
+            }
+        }
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if (chunks.empty() || chunks.back()->mapped || chunks.back()->size() >= CHUNK_TARGET) {
+            chunks.push_back(std::make_shared<Chunk>());
+            chunks.back()->lines.reserve(CHUNK_TARGET);
+            chunks.back()->lines.emplace_back(std::forward<Args>(args)...);
+            index_append(1);
+        } else {
+            own(chunks.size() - 1).emplace_back(std::forward<Args>(args)...);
+            index_add(chunks.size() - 1, 1);
+        }
+        total++;
+    }
+
+    void push_back(std::string line) { emplace_back(std::move(line)); }
+
+    void set_backing(std::shared_ptr<const MappedFile> file) { backing = std::move(file); }
+    const MappedFile* backing_file() const { return backing.get(); }
+    // Copies every line still read from the mapping into memory and drops the
+    // mapping. Only the first readable_bytes of the file are read; lines past
+    // them come back empty, and their count is returned.
+    size_t detach_backing(size_t readable_bytes);
+    void append_mapped(const char* base, std::vector<uint64_t>&& starts, bool strip_cr = false,
+                       bool ends_with_newline = true);
+
+    LineStore snapshot() const { return *this; }
+
+    void insert(size_t idx, std::string line);
+    void insert(size_t idx, std::vector<std::string>&& new_lines);
+    void erase(size_t first, size_t last);
+    void clear();
+    void reserve(size_t line_count);
+    void shrink_to_fit();
+
+    size_t chunk_count() const { return chunks.size(); }
+
+private:
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    std::vector<size_t> index;
+    size_t total = 0;
+    std::shared_ptr<const MappedFile> backing;
+
+    const std::string& chunk_line(size_t chunk, size_t offset) const {
+        Chunk& c = *chunks[chunk];
+        if (c.mapped) {
+            std::call_once(c.materialized, [&c] { c.materialize(); });
+        }
+        return c.lines[offset];
+    }
+
+    std::string_view chunk_view(size_t chunk, size_t offset) const {
+        const Chunk& c = *chunks[chunk];
+        return c.mapped ? c.view(offset) : std::string_view(c.lines[offset]);
+    }
+
+    std::vector<std::string>& own(size_t chunk);
+    std::pair<size_t, size_t> locate(size_t idx) const;
+    void index_add(size_t chunk, ptrdiff_t delta);
+    void index_append(size_t count);
+    void rebuild_index();
+    void split_chunk(size_t chunk);
+    void merge_small_chunk(size_t chunk);
+};
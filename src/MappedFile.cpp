@@ -0,0 +1,84 @@
+#include "MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace {
+timespec modification_time(const struct stat& st) {
+#ifdef __APPLE__
+    return st.st_mtimespec;
+#else
+    return st.st_mtim;
+#endif
+}
+}
+
+std::expected<std::shared_ptr<const MappedFile>, std::string> MappedFile::open(const std::filesystem::path& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::unexpected("Failed to open file: " + path.string());
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return std::unexpected("Failed to determine file size: " + path.string());
+    }
+
+    size_t length = static_cast<size_t>(st.st_size);
+    void* addr = nullptr;
+    if (length > 0) {
+        addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            return std::unexpected("Failed to map file: " + path.string());
+        }
+    }
+
+    return std::shared_ptr<const MappedFile>(new MappedFile(fd, addr, length, modification_time(st)));
+}
+
+MappedFile::~MappedFile() {
+    if (addr) {
+        munmap(addr, length);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool MappedFile::changed_on_disk() const {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return false;
+    timespec now = modification_time(st);
+    return static_cast<size_t>(st.st_size) != length || now.tv_sec != mtime.tv_sec || now.tv_nsec != mtime.tv_nsec;
+}
+
+size_t MappedFile::readable_size() const {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return 0;
+    return std::min(static_cast<size_t>(st.st_size), length);
+}
+
+bool MappedFile::is_same_file(const std::filesystem::path& path) const {
+    struct stat own;
+    struct stat other;
+    if (fstat(fd, &own) != 0 || stat(path.c_str(), &other) != 0) return false;
+    return own.st_dev == other.st_dev && own.st_ino == other.st_ino;
+}
+
+void MappedFile::advise_sequential() const {
+    if (addr) {
+        madvise(addr, length, MADV_SEQUENTIAL);
+    }
+}
+
+void MappedFile::advise_release(size_t offset, size_t len) const {
+    if (!addr || offset >= length) return;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t aligned = offset - offset % static_cast<size_t>(page);
+    len = std::min(len + (offset - aligned), length - aligned);
+    madvise(static_cast<char*>(addr) + aligned, len, MADV_DONTNEED);
+}
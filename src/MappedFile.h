@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <expected>
+#include <filesystem>
+#include <cstddef>
+#include <ctime>
+
+// Read-only private mapping of a file. Empty files map to a null range.
+//
+// Pages not yet read come from the file itself, so a file truncated or
+// rewritten in place shows through the mapping, and reading past its new end
+// raises SIGBUS. The file stays open so such changes can be detected before
+// the mapping is read again.
+class MappedFile {
+public:
+    static std::expected<std::shared_ptr<const MappedFile>, std::string> open(const std::filesystem::path& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return static_cast<const char*>(addr); }
+    size_t size() const { return length; }
+
+    void advise_sequential() const;
+    void advise_release(size_t offset, size_t len) const;
+
+    // True once the mapped file was truncated, grown or written in place.
+    // Replacing it through a rename leaves the mapping intact and is no change.
+    bool changed_on_disk() const;
+    // Bytes of the mapping that can still be read.
+    size_t readable_size() const;
+    // The file now ends before the mapping does, so reading the rest raises SIGBUS.
+    bool truncated() const { return readable_size() < length; }
+    // Whether `path` names the mapped file itself, under any of its links.
+    bool is_same_file(const std::filesystem::path& path) const;
+
+private:
+    MappedFile(int fd, void* addr, size_t length, timespec mtime)
+        : fd(fd), addr(addr), length(length), mtime(mtime) {}
+
+    int fd = -1;
+    void* addr = nullptr;
+    size_t length = 0;
+    timespec mtime{};
+};
@@ -321,13 +321,13 @@ public:
         }
     }
 
-    void render(SDL_Renderer* renderer, TextureCache& texture_cache, int window_w, int line_height) {
-        SDL_SetRenderDrawColor(renderer, MENU_BAR_BG.r, MENU_BAR_BG.g, MENU_BAR_BG.b, 255);
+    void render(RenderQueue& queue, TextureCache& texture_cache, int window_w, int line_height) {
+        queue.set_color(MENU_BAR_BG.r, MENU_BAR_BG.g, MENU_BAR_BG.b, 255);
         SDL_Rect bar_bg = {0, 0, window_w, L->menu_bar_height};
-        SDL_RenderFillRect(renderer, &bar_bg);
+        queue.fill_rect(bar_bg);
 
-        SDL_SetRenderDrawColor(renderer, MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
-        SDL_RenderDrawLine(renderer, 0, L->menu_bar_height - 1, window_w, L->menu_bar_height - 1);
+        queue.set_color(MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
+        queue.draw_line(0, L->menu_bar_height - 1, window_w, L->menu_bar_height - 1);
 
         for (int i = 0; i < static_cast<int>(menus.size()); i++) {
             const Menu& menu = menus[i];
@@ -335,13 +335,13 @@ public:
             bool is_hovered = (hovered_menu == i);
 
             if (is_active) {
-                SDL_SetRenderDrawColor(renderer, MENU_ITEM_ACTIVE.r, MENU_ITEM_ACTIVE.g, MENU_ITEM_ACTIVE.b, 255);
+                queue.set_color(MENU_ITEM_ACTIVE.r, MENU_ITEM_ACTIVE.g, MENU_ITEM_ACTIVE.b, 255);
                 SDL_Rect item_bg = {menu.x_offset, 0, menu.width, L->menu_bar_height};
-                SDL_RenderFillRect(renderer, &item_bg);
+                queue.fill_rect(item_bg);
             } else if (is_hovered) {
-                SDL_SetRenderDrawColor(renderer, MENU_ITEM_HOVER.r, MENU_ITEM_HOVER.g, MENU_ITEM_HOVER.b, 255);
+                queue.set_color(MENU_ITEM_HOVER.r, MENU_ITEM_HOVER.g, MENU_ITEM_HOVER.b, 255);
                 SDL_Rect item_bg = {menu.x_offset, 0, menu.width, L->menu_bar_height};
-                SDL_RenderFillRect(renderer, &item_bg);
+                queue.fill_rect(item_bg);
             }
 
             int text_y = (L->menu_bar_height - line_height) / 2;
@@ -350,14 +350,14 @@ public:
         }
     }
 
-    void render_dropdown_overlay(SDL_Renderer* renderer, TextureCache& texture_cache, int line_height) {
+    void render_dropdown_overlay(RenderQueue& queue, TextureCache& texture_cache, int line_height) {
         if (dropdown_open && active_menu >= 0 && active_menu < static_cast<int>(menus.size())) {
-            render_dropdown(renderer, texture_cache, line_height);
+            render_dropdown(queue, texture_cache, line_height);
         }
     }
 
 private:
-    void render_dropdown(SDL_Renderer* renderer, TextureCache& texture_cache, int line_height) {
+    void render_dropdown(RenderQueue& queue, TextureCache& texture_cache, int line_height) {
         const Menu& menu = menus[active_menu];
         int dropdown_x = menu.x_offset;
         int dropdown_y = L->menu_bar_height;
@@ -370,12 +370,12 @@ private:
             }
         }
 
-        SDL_SetRenderDrawColor(renderer, MENU_DROPDOWN_BG.r, MENU_DROPDOWN_BG.g, MENU_DROPDOWN_BG.b, 255);
+        queue.set_color(MENU_DROPDOWN_BG.r, MENU_DROPDOWN_BG.g, MENU_DROPDOWN_BG.b, 255);
         SDL_Rect dropdown_bg = {dropdown_x, dropdown_y, menu.dropdown_width, dropdown_height};
-        SDL_RenderFillRect(renderer, &dropdown_bg);
+        queue.fill_rect(dropdown_bg);
 
-        SDL_SetRenderDrawColor(renderer, MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
-        SDL_RenderDrawRect(renderer, &dropdown_bg);
+        queue.set_color(MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
+        queue.draw_rect(dropdown_bg);
 
         int item_y = dropdown_y;
         for (int i = 0; i < static_cast<int>(menu.items.size()); i++) {
@@ -384,10 +384,10 @@ private:
             bool is_hovered = (hovered_item == i) && enabled;
 
             if (is_hovered) {
-                SDL_SetRenderDrawColor(renderer, MENU_DROPDOWN_HOVER.r, MENU_DROPDOWN_HOVER.g,
+                queue.set_color(MENU_DROPDOWN_HOVER.r, MENU_DROPDOWN_HOVER.g,
                                        MENU_DROPDOWN_HOVER.b, 255);
                 SDL_Rect item_bg = {dropdown_x + 1, item_y, menu.dropdown_width - 2, L->menu_dropdown_item_height};
-                SDL_RenderFillRect(renderer, &item_bg);
+                queue.fill_rect(item_bg);
             }
 
             SDL_Color text_color = enabled ? MENU_TEXT : MENU_DISABLED;
@@ -406,8 +406,8 @@ private:
 
             if (item.separator_after) {
                 int sep_y = item_y + L->scaled(3);
-                SDL_SetRenderDrawColor(renderer, MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
-                SDL_RenderDrawLine(renderer, dropdown_x + L->scaled(8), sep_y,
+                queue.set_color(MENU_SEPARATOR.r, MENU_SEPARATOR.g, MENU_SEPARATOR.b, 255);
+                queue.draw_line(dropdown_x + L->scaled(8), sep_y,
                                    dropdown_x + menu.dropdown_width - L->scaled(8), sep_y);
                 item_y += L->scaled(6);
             }
@@ -0,0 +1,126 @@
+#include "NewlineScan.h"
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NEWLINE_SCAN_X86 1
+#endif
+
+namespace {
+
+uint64_t newline_mask_scalar(const char* block) {
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; ++i) {
+        mask |= static_cast<uint64_t>(block[i] == '\n') << i;
+    }
+    return mask;
+}
+
+ByteClassMasks byte_classes_scalar(const char* block) {
+    ByteClassMasks masks;
+    for (int i = 0; i < 64; ++i) {
+        unsigned char c = static_cast<unsigned char>(block[i]);
+        uint64_t bit = uint64_t{1} << i;
+        if (c == '\n') masks.newline |= bit;
+        if (c == '\r') masks.carriage_return |= bit;
+        if (c == 0) masks.nul |= bit;
+        if (c >= 0x80) masks.high |= bit;
+    }
+    return masks;
+}
+
+#ifdef NEWLINE_SCAN_X86
+__attribute__((target("sse2")))
+uint64_t newline_mask_sse2(const char* block) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+        uint32_t bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)));
+        mask |= static_cast<uint64_t>(bits) << (i * 16);
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+uint64_t newline_mask_avx2(const char* block) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    uint32_t lo_bits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)));
+    uint32_t hi_bits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)));
+    return static_cast<uint64_t>(lo_bits) | (static_cast<uint64_t>(hi_bits) << 32);
+}
+
+__attribute__((target("sse2")))
+ByteClassMasks byte_classes_sse2(const char* block) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+    const __m128i zero = _mm_setzero_si128();
+    ByteClassMasks masks;
+    for (int i = 0; i < 4; ++i) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+        int shift = i * 16;
+        masks.newline |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)))) << shift;
+        masks.carriage_return |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, carriage_return)))) << shift;
+        masks.nul |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)))) << shift;
+        masks.high |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(bytes))) << shift;
+    }
+    return masks;
+}
+
+__attribute__((target("avx2")))
+ByteClassMasks byte_classes_avx2(const char* block) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriage_return = _mm256_set1_epi8('\r');
+    const __m256i zero = _mm256_setzero_si256();
+    ByteClassMasks masks;
+    for (int i = 0; i < 2; ++i) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i * 32));
+        int shift = i * 32;
+        masks.newline |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, newline)))) << shift;
+        masks.carriage_return |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, carriage_return)))) << shift;
+        masks.nul |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, zero)))) << shift;
+        masks.high |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(bytes))) << shift;
+    }
+    return masks;
+}
+#endif
+
+std::vector<NewlineKernel> detect_kernels() {
+    std::vector<NewlineKernel> kernels;
+#ifdef NEWLINE_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", newline_mask_avx2, byte_classes_avx2});
+    if (__builtin_cpu_supports("sse2")) kernels.push_back({"sse2", newline_mask_sse2, byte_classes_sse2});
+#endif
+    kernels.push_back({"scalar", newline_mask_scalar, byte_classes_scalar});
+    return kernels;
+}
+
+}
+
+std::span<const NewlineKernel> supported_newline_kernels() {
+    static const std::vector<NewlineKernel> kernels = detect_kernels();
+    return kernels;
+}
+
+NewlineMaskFn newline_mask_kernel() {
+    return supported_newline_kernels().front().newline_mask;
+}
+
+ByteClassFn byte_class_kernel() {
+    return supported_newline_kernels().front().byte_classes;
+}
+
+size_t count_newlines(const char* begin, const char* end, NewlineMaskFn kernel) {
+    size_t count = 0;
+    const char* ptr = begin;
+    for (; end - ptr >= 64; ptr += 64) {
+        count += static_cast<size_t>(std::popcount(kernel(ptr)));
+    }
+    for (; ptr < end; ++ptr) {
+        count += (*ptr == '\n');
+    }
+    return count;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Newline search over 64-byte blocks. Each kernel returns a mask with bit i
+// set when block[i] == '\n'; the widest one the CPU supports (AVX2, SSE2,
+// scalar) is picked on first use.
+using NewlineMaskFn = uint64_t (*)(const char* block);
+
+// Per-block masks used to sniff line endings, NULs and non-ASCII bytes.
+struct ByteClassMasks {
+    uint64_t newline = 0;
+    uint64_t carriage_return = 0;
+    uint64_t nul = 0;
+    uint64_t high = 0;
+};
+using ByteClassFn = ByteClassMasks (*)(const char* block);
+
+struct NewlineKernel {
+    const char* name;
+    NewlineMaskFn newline_mask;
+    ByteClassFn byte_classes;
+};
+
+// Every kernel the CPU can run, widest first; the first one is in use.
+std::span<const NewlineKernel> supported_newline_kernels();
+NewlineMaskFn newline_mask_kernel();
+ByteClassFn byte_class_kernel();
+size_t count_newlines(const char* begin, const char* end, NewlineMaskFn kernel = newline_mask_kernel());
+
+template <typename Fn>
+void for_each_newline(const char* begin, const char* end, Fn&& fn, NewlineMaskFn kernel = newline_mask_kernel()) {
+    const char* ptr = begin;
+    for (; end - ptr >= 64; ptr += 64) {
+        uint64_t mask = kernel(ptr);
+        while (mask) {
+            fn(ptr + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+    for (; ptr < end; ++ptr) {
+        if (*ptr == '\n') fn(ptr);
+    }
+}
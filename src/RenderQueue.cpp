@@ -0,0 +1,172 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void RenderQueue::init(SDL_Renderer* r) {
+    renderer = r;
+    batch_count = 0;
+}
+
+void RenderQueue::set_clip(const SDL_Rect* rect) {
+    has_clip = rect != nullptr;
+    requested_clip = rect ? *rect : SDL_Rect{};
+    update_clip();
+}
+
+void RenderQueue::set_base_clip(const SDL_Rect* rect) {
+    has_base_clip = rect != nullptr;
+    base_clip = rect ? *rect : SDL_Rect{};
+    update_clip();
+}
+
+// SDL treats an empty clip rect as no clip at all, so shapes clipped to
+// nothing are dropped instead of queued.
+void RenderQueue::update_clip() {
+    clipped = has_clip || has_base_clip;
+    if (has_clip && has_base_clip) {
+        if (!SDL_IntersectRect(&requested_clip, &base_clip, &clip)) {
+            clip = {0, 0, 0, 0};
+        }
+    } else {
+        clip = has_clip ? requested_clip : base_clip;
+    }
+}
+
+void RenderQueue::fill_rect(const SDL_Rect& rect) {
+    if (rect.w <= 0 || rect.h <= 0) return;
+    SDL_FRect dst = {static_cast<float>(rect.x), static_cast<float>(rect.y),
+                     static_cast<float>(rect.w), static_cast<float>(rect.h)};
+    queue_quad(nullptr, dst, {0, 0, 0, 0}, color);
+}
+
+// Same pixels as SDL_RenderDrawRect: a one pixel outline just inside rect.
+void RenderQueue::draw_rect(const SDL_Rect& rect) {
+    if (rect.w <= 0 || rect.h <= 0) return;
+    fill_rect({rect.x, rect.y, rect.w, 1});
+    if (rect.h > 1) fill_rect({rect.x, rect.y + rect.h - 1, rect.w, 1});
+    if (rect.h > 2) {
+        fill_rect({rect.x, rect.y + 1, 1, rect.h - 2});
+        if (rect.w > 1) fill_rect({rect.x + rect.w - 1, rect.y + 1, 1, rect.h - 2});
+    }
+}
+
+void RenderQueue::draw_line(int x1, int y1, int x2, int y2) {
+    if (x1 == x2 || y1 == y2) {
+        // Endpoints are inclusive, as with SDL_RenderDrawLine.
+        fill_rect({std::min(x1, x2), std::min(y1, y2), std::abs(x2 - x1) + 1, std::abs(y2 - y1) + 1});
+        return;
+    }
+
+    if (clipped_away()) return;
+
+    // Anything else becomes a one pixel wide quad through the pixel centres.
+    float ax = static_cast<float>(x1) + 0.5f;
+    float ay = static_cast<float>(y1) + 0.5f;
+    float bx = static_cast<float>(x2) + 0.5f;
+    float by = static_cast<float>(y2) + 0.5f;
+    float length = std::hypot(bx - ax, by - ay);
+    float nx = -(by - ay) / length * 0.5f;
+    float ny = (bx - ax) / length * 0.5f;
+
+    SDL_FPoint corners[4] = {{ax + nx, ay + ny}, {bx + nx, by + ny}, {ax - nx, ay - ny}, {bx - nx, by - ny}};
+    SDL_Rect bounds = {std::min(x1, x2) - 1, std::min(y1, y2) - 1, std::abs(x2 - x1) + 3, std::abs(y2 - y1) + 3};
+    push_quad(batch_for(nullptr, bounds), corners, {0, 0, 0, 0}, color);
+}
+
+void RenderQueue::copy(SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect& dst) {
+    if (!texture || dst.w <= 0 || dst.h <= 0) return;
+
+    SDL_FRect uv = {0, 0, 1, 1};
+    if (src) {
+        int tex_w = 0;
+        int tex_h = 0;
+        SDL_QueryTexture(texture, nullptr, nullptr, &tex_w, &tex_h);
+        if (tex_w <= 0 || tex_h <= 0) return;
+        uv = {static_cast<float>(src->x) / static_cast<float>(tex_w), static_cast<float>(src->y) / static_cast<float>(tex_h),
+              static_cast<float>(src->w) / static_cast<float>(tex_w), static_cast<float>(src->h) / static_cast<float>(tex_h)};
+    }
+
+    SDL_FRect fdst = {static_cast<float>(dst.x), static_cast<float>(dst.y),
+                      static_cast<float>(dst.w), static_cast<float>(dst.h)};
+    queue_quad(texture, fdst, uv, {255, 255, 255, 255});
+}
+
+void RenderQueue::queue_quad(SDL_Texture* texture, const SDL_FRect& dst, const SDL_FRect& uv, SDL_Color c) {
+    if (clipped_away()) return;
+
+    int left = static_cast<int>(std::floor(dst.x));
+    int top = static_cast<int>(std::floor(dst.y));
+    SDL_Rect bounds = {left, top, static_cast<int>(std::ceil(dst.x + dst.w)) - left,
+                       static_cast<int>(std::ceil(dst.y + dst.h)) - top};
+    SDL_FPoint corners[4] = {{dst.x, dst.y}, {dst.x + dst.w, dst.y},
+                             {dst.x, dst.y + dst.h}, {dst.x + dst.w, dst.y + dst.h}};
+    push_quad(batch_for(texture, bounds), corners, uv, c);
+}
+
+void RenderQueue::flush() {
+    if (batch_count == 0) return;
+
+    for (size_t i = 0; i < batch_count; ++i) {
+        Batch& batch = batches[i];
+        SDL_RenderSetClipRect(renderer, batch.clipped ? &batch.clip : nullptr);
+        if (!batch.texture) {
+            SDL_SetRenderDrawBlendMode(renderer, batch.blend_mode);
+        }
+        SDL_RenderGeometry(renderer, batch.texture,
+                           batch.vertices.data(), static_cast<int>(batch.vertices.size()),
+                           batch.indices.data(), static_cast<int>(batch.indices.size()));
+        draw_calls++;
+        batch.vertices.clear();
+        batch.indices.clear();
+    }
+    batch_count = 0;
+
+    SDL_RenderSetClipRect(renderer, clipped ? &clip : nullptr);
+    SDL_SetRenderDrawBlendMode(renderer, blend_mode);
+}
+
+void RenderQueue::end_frame() {
+    flush();
+    last_draw_calls = draw_calls;
+    draw_calls = 0;
+}
+
+RenderQueue::Batch& RenderQueue::batch_for(SDL_Texture* texture, const SDL_Rect& bounds) {
+    size_t lookback_end = batch_count > MERGE_LOOKBACK ? batch_count - MERGE_LOOKBACK : 0;
+    for (size_t i = batch_count; i > lookback_end; --i) {
+        Batch& batch = batches[i - 1];
+        bool same_key = batch.texture == texture &&
+                        (texture || batch.blend_mode == blend_mode) &&
+                        batch.clipped == clipped &&
+                        (!clipped || SDL_RectEquals(&batch.clip, &clip));
+        if (same_key) {
+            SDL_UnionRect(&batch.bounds, &bounds, &batch.bounds);
+            return batch;
+        }
+        // Joining a batch further back would draw this shape under one that overlaps it.
+        if (SDL_HasIntersection(&batch.bounds, &bounds)) break;
+    }
+
+    if (batch_count == batches.size()) {
+        batches.emplace_back();
+    }
+    Batch& batch = batches[batch_count++];
+    batch.texture = texture;
+    batch.blend_mode = blend_mode;
+    batch.clipped = clipped;
+    batch.clip = clip;
+    batch.bounds = bounds;
+    return batch;
+}
+
+void RenderQueue::push_quad(Batch& batch, const SDL_FPoint (&corners)[4], const SDL_FRect& uv, SDL_Color c) {
+    int base = static_cast<int>(batch.vertices.size());
+    batch.vertices.push_back({corners[0], c, {uv.x, uv.y}});
+    batch.vertices.push_back({corners[1], c, {uv.x + uv.w, uv.y}});
+    batch.vertices.push_back({corners[2], c, {uv.x, uv.y + uv.h}});
+    batch.vertices.push_back({corners[3], c, {uv.x + uv.w, uv.y + uv.h}});
+    for (int offset : {0, 1, 2, 2, 1, 3}) {
+        batch.indices.push_back(base + offset);
+    }
+}
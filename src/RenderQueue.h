@@ -0,0 +1,78 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+
+// Collects a frame's rectangles and textured quads and submits them with as
+// few SDL_RenderGeometry calls as draw order allows. Components use it like
+// the renderer's own draw state: set a colour, blend mode or clip, then queue
+// shapes. A shape joins an earlier batch with the same texture, blend mode and
+// clip as long as nothing queued after that batch overlaps it, so fills end up
+// in one batch and text in one batch per texture instead of a call per shape.
+//
+// Queued textures must stay alive until flush(); owners that free or reuse a
+// texture mid-frame flush first.
+class RenderQueue {
+public:
+    // How many recent batches a shape looks back through for one it can join.
+    static constexpr size_t MERGE_LOOKBACK = 16;
+
+    void init(SDL_Renderer* r);
+    SDL_Renderer* get_renderer() const { return renderer; }
+
+    void set_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) { color = {r, g, b, a}; }
+    void set_color(SDL_Color c) { color = c; }
+    // Applies to untextured shapes; textured ones use their texture's blend mode.
+    void set_blend_mode(SDL_BlendMode mode) { blend_mode = mode; }
+    void set_clip(const SDL_Rect* rect);
+    // Confines everything queued to rect, including shapes with a clip of their
+    // own, which is intersected with it. Used to redraw only a damaged region.
+    void set_base_clip(const SDL_Rect* rect);
+
+    void fill_rect(const SDL_Rect& rect);
+    void draw_rect(const SDL_Rect& rect);
+    void draw_line(int x1, int y1, int x2, int y2);
+    void copy(SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect& dst);
+    // Queues a quad whose uv coordinates are already normalized, tinted by c.
+    void queue_quad(SDL_Texture* texture, const SDL_FRect& dst, const SDL_FRect& uv, SDL_Color c);
+
+    void flush();
+    // Flushes and starts counting the next frame's draw calls.
+    void end_frame();
+
+    int frame_draw_calls() const { return draw_calls; }
+    int last_frame_draw_calls() const { return last_draw_calls; }
+
+private:
+    struct Batch {
+        SDL_Texture* texture = nullptr;
+        SDL_BlendMode blend_mode = SDL_BLENDMODE_NONE;
+        bool clipped = false;
+        SDL_Rect clip{};
+        SDL_Rect bounds{};
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+    };
+
+    SDL_Renderer* renderer = nullptr;
+    SDL_Color color{255, 255, 255, 255};
+    SDL_BlendMode blend_mode = SDL_BLENDMODE_NONE;
+    bool clipped = false;
+    SDL_Rect clip{};
+    bool has_clip = false;
+    SDL_Rect requested_clip{};
+    bool has_base_clip = false;
+    SDL_Rect base_clip{};
+
+    // Batches are reused between flushes so their vectors keep their capacity.
+    std::vector<Batch> batches;
+    size_t batch_count = 0;
+    int draw_calls = 0;
+    int last_draw_calls = 0;
+
+    void update_clip();
+    bool clipped_away() const { return clipped && SDL_RectEmpty(&clip); }
+    Batch& batch_for(SDL_Texture* texture, const SDL_Rect& bounds);
+    void push_quad(Batch& batch, const SDL_FPoint (&corners)[4], const SDL_FRect& uv, SDL_Color c);
+};
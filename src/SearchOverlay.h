@@ -144,7 +144,7 @@ public:
         }
     }
 
-    void render(SDL_Renderer* renderer, const Layout& layout, TextureCache& cache,
+    void render(RenderQueue& queue, const Layout& layout, TextureCache& cache,
                 TTF_Font* font, int window_w, int window_h) {
         if (!visible) return;
 
@@ -163,14 +163,15 @@ public:
         int list_h = overlay_h - header_h - pad;
         visible_count_ = std::max(1, list_h / row_h);
 
-        render_overlay_background(renderer, window_w, window_h);
-        render_window(renderer, x, y, overlay_w, overlay_h);
-        render_input_box(renderer, cache, font, x, y, overlay_w, pad, input_h);
+        render_overlay_background(queue, window_w, window_h);
+        render_window(queue, x, y, overlay_w, overlay_h);
+        render_input_box(queue, cache, font, x, y, overlay_w, pad, input_h);
         render_status(cache, x, y, pad, input_h);
-        render_results(renderer, cache, font, x, y, overlay_w, overlay_h, pad, input_h, line_h);
+        render_results(queue, cache, font, x, y, overlay_w, overlay_h, pad, input_h, line_h);
     }
 
     bool has_ripgrep() const { return !ripgrep_path_.empty(); }
+    bool is_searching() const { return searching_.load(); }
 
 private:
     static constexpr int INPUT_HEIGHT = 44;
@@ -436,31 +437,31 @@ private:
         }
     }
 
-    void render_overlay_background(SDL_Renderer* renderer, int window_w, int window_h) {
-        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 150);
+    void render_overlay_background(RenderQueue& queue, int window_w, int window_h) {
+        queue.set_blend_mode(SDL_BLENDMODE_BLEND);
+        queue.set_color(0, 0, 0, 150);
         SDL_Rect full_screen = {0, 0, window_w, window_h};
-        SDL_RenderFillRect(renderer, &full_screen);
-        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        queue.fill_rect(full_screen);
+        queue.set_blend_mode(SDL_BLENDMODE_NONE);
     }
 
-    void render_window(SDL_Renderer* renderer, int x, int y, int w, int h) {
-        SDL_SetRenderDrawColor(renderer, Colors::BG.r, Colors::BG.g, Colors::BG.b, 255);
+    void render_window(RenderQueue& queue, int x, int y, int w, int h) {
+        queue.set_color(Colors::BG.r, Colors::BG.g, Colors::BG.b, 255);
         SDL_Rect win_rect = {x, y, w, h};
-        SDL_RenderFillRect(renderer, &win_rect);
+        queue.fill_rect(win_rect);
 
-        SDL_SetRenderDrawColor(renderer, TAB_BORDER_COLOR.r, TAB_BORDER_COLOR.g, TAB_BORDER_COLOR.b, 255);
-        SDL_RenderDrawRect(renderer, &win_rect);
+        queue.set_color(TAB_BORDER_COLOR.r, TAB_BORDER_COLOR.g, TAB_BORDER_COLOR.b, 255);
+        queue.draw_rect(win_rect);
     }
 
-    void render_input_box(SDL_Renderer* renderer, TextureCache& cache, TTF_Font* font,
+    void render_input_box(RenderQueue& queue, TextureCache& cache, TTF_Font* font,
                           int x, int y, int w, int pad, int input_h) {
-        SDL_SetRenderDrawColor(renderer, Colors::SEARCH_BG.r, Colors::SEARCH_BG.g, Colors::SEARCH_BG.b, 255);
+        queue.set_color(Colors::SEARCH_BG.r, Colors::SEARCH_BG.g, Colors::SEARCH_BG.b, 255);
         SDL_Rect input_rect = {x + pad, y + pad, w - pad * 2, input_h};
-        SDL_RenderFillRect(renderer, &input_rect);
+        queue.fill_rect(input_rect);
 
-        SDL_SetRenderDrawColor(renderer, TAB_BORDER_COLOR.r, TAB_BORDER_COLOR.g, TAB_BORDER_COLOR.b, 255);
-        SDL_RenderDrawRect(renderer, &input_rect);
+        queue.set_color(TAB_BORDER_COLOR.r, TAB_BORDER_COLOR.g, TAB_BORDER_COLOR.b, 255);
+        queue.draw_rect(input_rect);
 
         int line_h = TTF_FontHeight(font);
         int text_y = y + pad + (input_h - line_h) / 2;
@@ -508,7 +509,7 @@ private:
         }
     }
 
-    void render_results(SDL_Renderer* renderer, TextureCache& cache, TTF_Font* font,
+    void render_results(RenderQueue& queue, TextureCache& cache, TTF_Font* font,
                         int x, int y, int w, int h, int pad, int input_h, int line_h) {
         int header_h = pad + input_h + pad + line_h + pad;
         int list_y = y + header_h;
@@ -518,7 +519,7 @@ private:
         int content_w = w - pad * 2 - scrollbar_w - pad;
 
         SDL_Rect clip = {x + pad, list_y, w - pad * 2, list_h};
-        SDL_RenderSetClipRect(renderer, &clip);
+        queue.set_clip(&clip);
 
         std::lock_guard lock(results_mutex_);
         int draw_y = list_y;
@@ -527,10 +528,10 @@ private:
              i < static_cast<int>(results_.size()) && draw_y < list_y + list_h;
              ++i) {
             if (i == selected_idx_) {
-                SDL_SetRenderDrawColor(renderer, Colors::SELECTION.r, Colors::SELECTION.g,
+                queue.set_color(Colors::SELECTION.r, Colors::SELECTION.g,
                                        Colors::SELECTION.b, Colors::SELECTION.a);
                 SDL_Rect row = {x + pad, draw_y, w - pad * 2, row_h};
-                SDL_RenderFillRect(renderer, &row);
+                queue.fill_rect(row);
             }
 
             const auto& res = results_[i];
@@ -555,20 +556,20 @@ private:
             draw_y += row_h;
         }
 
-        SDL_RenderSetClipRect(renderer, nullptr);
+        queue.set_clip(nullptr);
 
         if (static_cast<int>(results_.size()) > visible_count_) {
-            render_scrollbar(renderer, x + w - pad - scrollbar_w, list_y, scrollbar_w, list_h,
+            render_scrollbar(queue, x + w - pad - scrollbar_w, list_y, scrollbar_w, list_h,
                             static_cast<int>(results_.size()), visible_count_, scroll_offset_);
         }
     }
 
-    void render_scrollbar(SDL_Renderer* renderer, int x, int y, int w, int h,
+    void render_scrollbar(RenderQueue& queue, int x, int y, int w, int h,
                           int total_items, int visible_items, int scroll_pos) {
-        SDL_SetRenderDrawColor(renderer, Colors::SCROLLBAR_BG.r, Colors::SCROLLBAR_BG.g,
+        queue.set_color(Colors::SCROLLBAR_BG.r, Colors::SCROLLBAR_BG.g,
                                Colors::SCROLLBAR_BG.b, 255);
         SDL_Rect bg = {x, y, w, h};
-        SDL_RenderFillRect(renderer, &bg);
+        queue.fill_rect(bg);
 
         if (total_items <= visible_items) return;
 
@@ -576,9 +577,9 @@ private:
         int max_scroll = total_items - visible_items;
         int thumb_y = y + (h - thumb_h) * scroll_pos / max_scroll;
 
-        SDL_SetRenderDrawColor(renderer, Colors::SCROLLBAR_THUMB.r, Colors::SCROLLBAR_THUMB.g,
+        queue.set_color(Colors::SCROLLBAR_THUMB.r, Colors::SCROLLBAR_THUMB.g,
                                Colors::SCROLLBAR_THUMB.b, 255);
         SDL_Rect thumb = {x, thumb_y, w, thumb_h};
-        SDL_RenderFillRect(renderer, &thumb);
+        queue.fill_rect(thumb);
     }
 };
@@ -1,9 +1,114 @@
 #include "Syntax.h"
+#include "TextDocument.h"
+#include "FallbackLexer.h"
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+struct SyntaxHighlighter::BackgroundParse {
+    std::shared_ptr<const DocumentSnapshot> snapshot;
+    LinesReadContext read_context;
+    TSTreePtr old_tree;
+    TSTreePtr result;
+    std::vector<FoldRegion> folds;
+    const LoadedLanguage* language = nullptr;
+    std::vector<InjectionLayer> injections;
+    std::vector<TSRange> injection_changes;
+    size_t cancel_flag = 0;
+    std::thread worker;
+    std::atomic<bool> done{false};
+};
+
+namespace {
+bool is_foldable_node(TSNode node) {
+    const char* type = ts_node_type(node);
+    return strcmp(type, "function_definition") == 0 ||
+           strcmp(type, "compound_statement") == 0 ||
+           strcmp(type, "class_specifier") == 0 ||
+           strcmp(type, "struct_specifier") == 0 ||
+           strcmp(type, "namespace_definition") == 0 ||
+           strcmp(type, "if_statement") == 0 ||
+           strcmp(type, "for_statement") == 0 ||
+           strcmp(type, "while_statement") == 0 ||
+           strcmp(type, "switch_statement") == 0 ||
+           strcmp(type, "enum_specifier") == 0 ||
+           strcmp(type, "comment") == 0 ||
+           strcmp(type, "class_definition") == 0 ||
+           strcmp(type, "function_declaration") == 0 ||
+           strcmp(type, "method_definition") == 0 ||
+           strcmp(type, "arrow_function") == 0 ||
+           strcmp(type, "class_declaration") == 0 ||
+           strcmp(type, "try_statement") == 0 ||
+           strcmp(type, "catch_clause") == 0 ||
+           strcmp(type, "with_statement") == 0 ||
+           strcmp(type, "do_statement") == 0 ||
+           strcmp(type, "statement_block") == 0 ||
+           strcmp(type, "object") == 0 ||
+           strcmp(type, "array") == 0 ||
+           strcmp(type, "block") == 0 ||
+           strcmp(type, "if_expression") == 0 ||
+           strcmp(type, "match_expression") == 0 ||
+           strcmp(type, "else_clause") == 0 ||
+           strcmp(type, "elif_clause") == 0 ||
+           strcmp(type, "except_clause") == 0 ||
+           strcmp(type, "finally_clause") == 0 ||
+           strcmp(type, "for_in_statement") == 0 ||
+           strcmp(type, "repeat_statement") == 0 ||
+           strcmp(type, "function_statement") == 0 ||
+           strcmp(type, "local_function") == 0 ||
+           strcmp(type, "fenced_code_block") == 0 ||
+           strcmp(type, "block_mapping") == 0 ||
+           strcmp(type, "block_sequence") == 0 ||
+           strcmp(type, "table") == 0 ||
+           strcmp(type, "inline_table") == 0 ||
+           strcmp(type, "array_of_tables") == 0 ||
+           strcmp(type, "rule_set") == 0 ||
+           strcmp(type, "media_statement") == 0 ||
+           strcmp(type, "keyframes_statement") == 0 ||
+           strcmp(type, "element") == 0;
+}
+
+// Pre-order walk, so start lines never decrease and a node sharing its start
+// line with an enclosing region can only follow it directly. Single-line
+// nodes are not descended into since nothing below them can span lines.
+void collect_fold_regions(const TSTree* tree, std::vector<FoldRegion>& folds) {
+    folds.clear();
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+    for (;;) {
+        TSNode node = ts_tree_cursor_current_node(&cursor);
+        TSPoint start = ts_node_start_point(node);
+        TSPoint end = ts_node_end_point(node);
+        bool multiline = end.row > start.row;
+
+        if (multiline && is_foldable_node(node) &&
+            (folds.empty() || folds.back().start_line != static_cast<LineIdx>(start.row))) {
+            folds.push_back({static_cast<LineIdx>(start.row), static_cast<LineIdx>(end.row), false});
+        }
+
+        if (multiline && ts_tree_cursor_goto_first_child(&cursor)) continue;
+        while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if (!ts_tree_cursor_goto_parent(&cursor)) {
+                ts_tree_cursor_delete(&cursor);
+                return;
+            }
+        }
+    }
+}
 
-void LinesReadContext::set(const std::vector<std::string>& l, const LineOffsetTree& t) {
+LineIdx shift_row(LineIdx row, const TSInputEdit& edit) {
+    auto start = static_cast<LineIdx>(edit.start_point.row);
+    auto old_end = static_cast<LineIdx>(edit.old_end_point.row);
+    auto new_end = static_cast<LineIdx>(edit.new_end_point.row);
+    if (row <= start) return row;
+    if (row >= old_end) return row - old_end + new_end;
+    return std::min(row, new_end);
+}
+}
+
+void LinesReadContext::set(const LineStore& l, const LineOffsetTree& t) {
     lines = &l;
     offset_tree = &t;
     last_line_idx = 0;
@@ -55,7 +160,7 @@ const char* ts_input_read_callback(
         return "";
     }
 
-    const std::string& line = (*ctx->lines)[line_idx];
+    std::string_view line = ctx->lines->view(line_idx);
 
     if (offset_in_line < line.size()) {
         *bytes_read = static_cast<uint32_t>(line.size() - offset_in_line);
@@ -74,7 +179,11 @@ const char* ts_input_read_callback(
 
 SyntaxHighlighter::SyntaxHighlighter() : parser(ts_parser_new()) {}
 
-bool SyntaxHighlighter::set_language_for_file(const std::string& filepath, const std::vector<std::string>& lines, const LineOffsetTree& offset_tree) {
+SyntaxHighlighter::~SyntaxHighlighter() {
+    cancel_parse();
+}
+
+bool SyntaxHighlighter::set_language_for_file(const std::string& filepath, const LineStore& lines, const LineOffsetTree& offset_tree) {
     LanguageRegistry& registry = LanguageRegistry::instance();
     const LanguageDefinition* def = registry.detect_language(filepath);
 
@@ -88,6 +197,8 @@ bool SyntaxHighlighter::set_language_for_file(const std::string& filepath, const
         return true;
     }
 
+    cancel_parse();
+    discard_suspended_parse();
     current_language = registry.get_or_load(def->id);
     if (!current_language) {
         current_language_id.clear();
@@ -108,16 +219,23 @@ bool SyntaxHighlighter::set_language_for_file(const std::string& filepath, const
         return false;
     }
 
-    tree.reset();
+    set_tree(nullptr);
 
     if (!lines.empty()) {
-        parse(lines, offset_tree);
+        parse(lines, offset_tree, SYNC_PARSE_BUDGET_MICROS);
     }
 
     return true;
 }
 
-void SyntaxHighlighter::parse(const std::vector<std::string>& lines, const LineOffsetTree& offset_tree) {
+void SyntaxHighlighter::parse(const LineStore& lines, const LineOffsetTree& offset_tree, uint64_t budget_micros) {
+    cancel_parse();
+    discard_suspended_parse();
+    if (offset_tree.total_bytes() > MAX_PARSE_BYTES) {
+        set_tree(nullptr);
+        return;
+    }
+
     read_context.set(lines, offset_tree);
 
     TSInput input;
@@ -125,104 +243,176 @@ void SyntaxHighlighter::parse(const std::vector<std::string>& lines, const LineO
     input.read = ts_input_read_callback;
     input.encoding = TSInputEncodingUTF8;
 
-    tree.reset(ts_parser_parse(parser.get(), nullptr, input));
+    ts_parser_set_timeout_micros(parser.get(), budget_micros);
+    TSTree* result = ts_parser_parse(parser.get(), nullptr, input);
+    ts_parser_set_timeout_micros(parser.get(), 0);
+
+    parse_suspended = !result && budget_micros > 0;
+    set_tree(result);
+    if (tree) {
+        collect_fold_regions(tree.get(), folds);
+    }
 }
 
 void SyntaxHighlighter::apply_edit(ByteOff start_byte, ByteOff old_end_byte, ByteOff new_end_byte,
                                     TSPoint start_point, TSPoint old_end_point, TSPoint new_end_point) {
-    if (!tree) return;
+    discard_suspended_parse();
+    if (!tree && !background) return;
+    if (old_end_byte > MAX_PARSE_BYTES || new_end_byte > MAX_PARSE_BYTES) {
+        reset_tree();
+        return;
+    }
 
     TSInputEdit edit = {
-        .start_byte = start_byte,
-        .old_end_byte = old_end_byte,
-        .new_end_byte = new_end_byte,
+        .start_byte = static_cast<uint32_t>(start_byte),
+        .old_end_byte = static_cast<uint32_t>(old_end_byte),
+        .new_end_byte = static_cast<uint32_t>(new_end_byte),
         .start_point = start_point,
         .old_end_point = old_end_point,
         .new_end_point = new_end_point
     };
-    ts_tree_edit(tree.get(), &edit);
+    if (tree) {
+        ts_tree_edit(tree.get(), &edit);
+        edit_injection_layers(injections, edit);
+        highlight_cache.shift_for_edit(start_point.row, old_end_point.row, new_end_point.row);
+        tree_edited = true;
+    }
+    if (background) {
+        edits_since_snapshot.push_back(edit);
+    }
 }
 
-void SyntaxHighlighter::parse_incremental(const std::vector<std::string>& lines, const LineOffsetTree& offset_tree) {
-    read_context.set(lines, offset_tree);
-
-    TSInput input;
-    input.payload = &read_context;
-    input.read = ts_input_read_callback;
-    input.encoding = TSInputEncodingUTF8;
-
-    TSTree* new_tree = ts_parser_parse(parser.get(), tree.get(), input);
+void SyntaxHighlighter::reset_tree() {
+    cancel_parse();
+    discard_suspended_parse();
+    set_tree(nullptr);
+}
 
-    if (new_tree) {
-        tree.reset(new_tree);
-    } else {
-        tree.reset();
-        ts_parser_reset(parser.get());
-        tree.reset(ts_parser_parse(parser.get(), nullptr, input));
+void SyntaxHighlighter::set_tree(TSTree* new_tree, bool edited) {
+    tree.reset(new_tree);
+    tree_edited = edited;
+    highlight_cache.clear();
+    if (!tree) {
+        folds.clear();
+        injections.clear();
     }
 }
 
-std::vector<Token> SyntaxHighlighter::get_line_tokens(ByteOff line_start_byte, ByteOff line_end_byte) const {
-    std::vector<Token> tokens;
-    if (!tree || !current_language || !current_language->query) {
-        return tokens;
-    }
+void SyntaxHighlighter::discard_suspended_parse() {
+    if (!parse_suspended) return;
+    ts_parser_reset(parser.get());
+    parse_suspended = false;
+}
 
-    TSQueryCursorPtr cursor(ts_query_cursor_new());
-    ts_query_cursor_set_byte_range(cursor.get(), line_start_byte, line_end_byte);
-    ts_query_cursor_exec(cursor.get(), current_language->query, ts_tree_root_node(tree.get()));
+void SyntaxHighlighter::parse_async(std::shared_ptr<const DocumentSnapshot> snapshot) {
+    cancel_parse();
+    if (!current_language) return;
+    if (snapshot->offsets.total_bytes() > MAX_PARSE_BYTES) {
+        set_tree(nullptr);
+        return;
+    }
 
-    TSQueryMatch match;
-    while (ts_query_cursor_next_match(cursor.get(), &match)) {
-        for (uint16_t i = 0; i < match.capture_count; i++) {
-            const TSQueryCapture& capture = match.captures[i];
-            uint32_t id = capture.index;
+    background = std::make_unique<BackgroundParse>();
+    BackgroundParse* job = background.get();
+    job->snapshot = std::move(snapshot);
+    job->read_context.set(job->snapshot->lines, job->snapshot->offsets);
+    job->language = current_language;
+    if (tree) {
+        job->old_tree.reset(ts_tree_copy(tree.get()));
+        job->injections = fork_injection_layers(injections);
+    }
+    // A suspended parse has seen no edits since, so the worker picks it up where it stopped.
+    parse_suspended = false;
+
+    // The parser belongs to the worker until the job is joined.
+    ts_parser_set_cancellation_flag(parser.get(), &job->cancel_flag);
+    job->worker = std::thread([job, parser = parser.get()]() {
+        TSInput input{};
+        input.payload = &job->read_context;
+        input.read = ts_input_read_callback;
+        input.encoding = TSInputEncodingUTF8;
+
+        TSTree* result = ts_parser_parse(parser, job->old_tree.get(), input);
+        if (!result && job->old_tree && std::atomic_ref<size_t>(job->cancel_flag).load() == 0) {
+            ts_parser_reset(parser);
+            result = ts_parser_parse(parser, nullptr, input);
+        }
+        if (!result) {
+            ts_parser_reset(parser);
+        } else {
+            collect_fold_regions(result, job->folds);
+            update_injection_layers(result, *job->language, input, job->injections, job->injection_changes,
+                                    &job->cancel_flag);
+        }
+        job->result.reset(result);
+        job->done = true;
+    });
+}
 
-            if (id < current_language->capture_map.size() && current_language->capture_map[id] != TokenType::Default) {
-                uint32_t node_start = ts_node_start_byte(capture.node);
-                uint32_t node_end = ts_node_end_byte(capture.node);
+bool SyntaxHighlighter::poll_parse(std::vector<TSRange>& changed_ranges) {
+    changed_ranges.clear();
+    if (!background || !background->done) return false;
 
-                int start = static_cast<int>(std::max(node_start, line_start_byte) - line_start_byte);
-                int end = static_cast<int>(std::min(node_end, line_end_byte) - line_start_byte);
+    background->worker.join();
+    ts_parser_set_cancellation_flag(parser.get(), nullptr);
+    TSTreePtr result = std::move(background->result);
+    std::vector<FoldRegion> new_folds = std::move(background->folds);
+    std::vector<InjectionLayer> new_injections = std::move(background->injections);
+    std::vector<TSRange> injection_changes = std::move(background->injection_changes);
+    background.reset();
 
-                if (start < end) {
-                    tokens.push_back({current_language->capture_map[id], start, end});
-                }
-            }
-        }
+    if (!result) {
+        edits_since_snapshot.clear();
+        return false;
     }
-
-    std::sort(tokens.begin(), tokens.end(), [](const Token& a, const Token& b) {
-        if (a.start != b.start) return a.start < b.start;
-        return (a.end - a.start) < (b.end - b.start);
-    });
-
-    std::vector<Token> resolved;
-    for (const auto& tok : tokens) {
-        if (resolved.empty()) {
-            resolved.push_back(tok);
-            continue;
+    for (const TSInputEdit& edit : edits_since_snapshot) {
+        ts_tree_edit(result.get(), &edit);
+        edit_injection_layers(new_injections, edit);
+        for (TSRange& range : injection_changes) {
+            edit_range(range, edit);
         }
-        Token& last = resolved.back();
-        if (tok.start >= last.end) {
-            resolved.push_back(tok);
-        } else if (tok.start == last.start && tok.end <= last.end) {
-            last = tok;
-        } else if (tok.start > last.start && tok.end <= last.end) {
-            Token before = {last.type, last.start, tok.start};
-            Token after = {last.type, tok.end, last.end};
-            resolved.pop_back();
-            if (before.start < before.end) resolved.push_back(before);
-            resolved.push_back(tok);
-            if (after.start < after.end) resolved.push_back(after);
-        } else if (tok.start < last.end && tok.end > last.end) {
-            last.end = tok.start;
-            if (last.start >= last.end) resolved.pop_back();
-            resolved.push_back(tok);
+        for (FoldRegion& fold : new_folds) {
+            fold.start_line = shift_row(fold.start_line, edit);
+            fold.end_line = shift_row(fold.end_line, edit);
+        }
+    }
+    bool edited = !edits_since_snapshot.empty();
+    edits_since_snapshot.clear();
+
+    if (tree) {
+        uint32_t count = 0;
+        TSRange* ranges = ts_tree_get_changed_ranges(tree.get(), result.get(), &count);
+        changed_ranges.assign(ranges, ranges + count);
+        free(ranges);
+    } else {
+        changed_ranges.push_back({{0, 0}, {UINT32_MAX, UINT32_MAX}, 0, UINT32_MAX});
+    }
+    changed_ranges.insert(changed_ranges.end(), injection_changes.begin(), injection_changes.end());
+
+    // Rows outside the changed ranges highlight the same under the new tree.
+    bool had_tree = tree != nullptr;
+    tree.reset(result.release());
+    tree_edited = edited;
+    if (!had_tree) {
+        highlight_cache.clear();
+    } else {
+        for (const TSRange& range : changed_ranges) {
+            highlight_cache.invalidate(range.start_point.row, range.end_point.row);
         }
     }
+    folds = std::move(new_folds);
+    injections = std::move(new_injections);
+    return true;
+}
 
-    return resolved;
+void SyntaxHighlighter::cancel_parse() {
+    if (!background) return;
+
+    std::atomic_ref<size_t>(background->cancel_flag).store(1);
+    background->worker.join();
+    ts_parser_set_cancellation_flag(parser.get(), nullptr);
+    background.reset();
+    edits_since_snapshot.clear();
 }
 
 LineIdx SyntaxHighlighter::find_line_for_byte_in_range(ByteOff byte_pos, LineIdx hint_line, LineIdx range_start, LineIdx range_end,
@@ -250,40 +440,188 @@ LineIdx SyntaxHighlighter::find_line_for_byte_in_range(ByteOff byte_pos, LineIdx
 void SyntaxHighlighter::get_viewport_tokens(
     LineIdx start_line, LineIdx end_line,
     const LineOffsetTree& offset_tree,
-    const std::vector<std::string>& lines,
-    std::unordered_map<LineIdx, std::vector<Token>>& result
+    const LineStore& lines,
+    TokenArena& out
 ) const {
-    for (auto it = result.begin(); it != result.end(); ) {
-        if (it->first < start_line || it->first >= end_line) {
-            it = result.erase(it);
+    if (!tree || !current_language || start_line < 0) {
+        query_tokens(start_line, end_line, offset_tree, lines, out);
+        return;
+    }
+
+    auto line_count = static_cast<LineIdx>(lines.size());
+    for (LineIdx block = start_line / HighlightCache::BLOCK_LINES; block * HighlightCache::BLOCK_LINES < end_line; ++block) {
+        LineIdx block_start = block * HighlightCache::BLOCK_LINES;
+        LineIdx block_end = std::min(block_start + HighlightCache::BLOCK_LINES, line_count);
+        LineIdx visible_start = std::max(start_line, block_start);
+        LineIdx visible_end = std::min(end_line, block_end);
+        if (block_end <= block_start) break;
+
+        TokenArena& cached = highlight_cache.block(block, line_count);
+
+        // Only rows dropped by edits and reparses are queried again. An edited
+        // tree is about to be replaced, so its results go to out without being kept.
+        TokenArena& fill = tree_edited ? out : cached;
+        LineIdx fill_start = tree_edited ? visible_start : block_start;
+        LineIdx fill_end = tree_edited ? visible_end : block_end;
+        bool hit = true;
+        for (LineIdx line = fill_start; line < fill_end;) {
+            if (cached.has_line(line)) {
+                ++line;
+                continue;
+            }
+            LineIdx run_end = line + 1;
+            while (run_end < fill_end && !cached.has_line(run_end)) ++run_end;
+            query_tokens(line, run_end, offset_tree, lines, fill);
+            hit = false;
+            line = run_end;
+        }
+        if (hit) {
+            cache_stats.hits++;
         } else {
-            it->second.clear();
-            ++it;
+            cache_stats.misses++;
+        }
+
+        for (LineIdx line = visible_start; line < visible_end; ++line) {
+            if (cached.has_line(line)) {
+                out.assign_line(line, cached.line_tokens(line));
+            }
+        }
+    }
+}
+
+void SyntaxHighlighter::query_tokens(LineIdx start_line, LineIdx end_line, const LineOffsetTree& offset_tree,
+                                     const LineStore& lines, TokenArena& out) const {
+    static thread_local std::vector<LineToken> captured;
+    static thread_local std::vector<LineToken> injected;
+    static thread_local std::vector<LineToken> masks;
+    static thread_local std::vector<Token> resolved;
+    static thread_local std::vector<Token> layered;
+    static thread_local std::vector<Token> merged;
+    captured.clear();
+    injected.clear();
+    masks.clear();
+
+    if (!tree && current_language && start_line >= 0) {
+        LineIdx lexed_end = std::min(end_line, static_cast<LineIdx>(lines.size()));
+        for (LineIdx line_idx = start_line; line_idx < lexed_end; line_idx++) {
+            lex_line_fallback(lines.view(static_cast<size_t>(line_idx)), current_language->config, resolved);
+            out.assign_line(line_idx, resolved);
         }
+        return;
     }
 
-    if (!tree || !current_language || !current_language->query || start_line < 0 || end_line > static_cast<LineIdx>(lines.size())) {
+    bool queryable = tree && current_language && current_language->query && start_line >= 0 &&
+                     end_line <= static_cast<LineIdx>(lines.size()) &&
+                     !offset_tree.empty() && offset_tree.total_bytes() <= MAX_PARSE_BYTES;
+    if (!queryable) {
+        for (LineIdx line_idx = start_line; line_idx < end_line; line_idx++) {
+            out.assign_line(line_idx, {});
+        }
         return;
     }
-    if (offset_tree.empty()) return;
 
     ByteOff vp_start_byte = offset_tree.get_line_start_offset(start_line);
     ByteOff vp_end_byte = (static_cast<size_t>(end_line) < offset_tree.line_count())
         ? offset_tree.get_line_start_offset(end_line) : offset_tree.total_bytes();
 
-    TSQueryCursorPtr cursor(ts_query_cursor_new());
-    ts_query_cursor_set_byte_range(cursor.get(), vp_start_byte, vp_end_byte);
-    ts_query_cursor_exec(cursor.get(), current_language->query, ts_tree_root_node(tree.get()));
+    capture_tokens(*current_language, tree.get(), start_line, end_line, vp_start_byte, vp_end_byte,
+                   offset_tree, lines, captured);
+
+    for (const InjectionLayer& layer : injections) {
+        if (!layer.tree) continue;
+        if (layer.language->query) {
+            capture_tokens(*layer.language, layer.tree.get(), start_line, end_line, vp_start_byte, vp_end_byte,
+                           offset_tree, lines, injected);
+        }
+        for (const TSRange& range : layer.ranges) {
+            if (range.end_byte <= vp_start_byte || range.start_byte >= vp_end_byte) continue;
+            auto first_row = static_cast<LineIdx>(range.start_point.row);
+            auto last_row = static_cast<LineIdx>(range.end_point.row);
+            for (LineIdx line_idx = std::max(first_row, start_line); line_idx <= std::min(last_row, end_line - 1); line_idx++) {
+                auto line_len = static_cast<ColIdx>(lines.view(static_cast<size_t>(line_idx)).size());
+                ColIdx col_start = (line_idx == first_row) ? std::min(static_cast<ColIdx>(range.start_point.column), line_len) : 0;
+                ColIdx col_end = (line_idx == last_row) ? std::min(static_cast<ColIdx>(range.end_point.column), line_len) : line_len;
+                if (col_start < col_end) {
+                    masks.push_back({line_idx, {TokenType::Default, col_start, col_end}});
+                }
+            }
+        }
+    }
+
+    auto by_position = [](const LineToken& a, const LineToken& b) {
+        if (a.line != b.line) return a.line < b.line;
+        if (a.token.start != b.token.start) return a.token.start < b.token.start;
+        return a.token.end < b.token.end;
+    };
+    std::sort(captured.begin(), captured.end(), by_position);
+    std::sort(injected.begin(), injected.end(), by_position);
+    std::sort(masks.begin(), masks.end(), by_position);
+
+    // Nested layers can claim overlapping spans of a line.
+    size_t kept = 0;
+    for (size_t i = 0; i < masks.size(); ++i) {
+        LineToken* last = kept > 0 ? &masks[kept - 1] : nullptr;
+        if (last && last->line == masks[i].line && masks[i].token.start <= last->token.end) {
+            last->token.end = std::max(last->token.end, masks[i].token.end);
+        } else {
+            masks[kept++] = masks[i];
+        }
+    }
+    masks.resize(kept);
+
+    auto line_run = [](const std::vector<LineToken>& tokens, size_t& next, LineIdx line_idx) {
+        size_t begin = next;
+        while (next < tokens.size() && tokens[next].line == line_idx) next++;
+        return std::span<const LineToken>(tokens.data() + begin, next - begin);
+    };
+
+    size_t next_captured = 0;
+    size_t next_injected = 0;
+    size_t next_mask = 0;
+    for (LineIdx line_idx = start_line; line_idx < end_line; line_idx++) {
+        resolve_overlaps(line_run(captured, next_captured, line_idx), resolved);
+        std::span<const LineToken> line_injected = line_run(injected, next_injected, line_idx);
+        std::span<const LineToken> line_masks = line_run(masks, next_mask, line_idx);
+        if (line_masks.empty()) {
+            out.assign_line(line_idx, resolved);
+            continue;
+        }
+
+        // Injected text belongs to its own language: the host's tokens are cut
+        // out of it and the injected layers' tokens fill it in.
+        resolve_overlaps(line_injected, layered);
+        merged.clear();
+        for (const Token& tok : resolved) {
+            split_by_masks(tok, line_masks, false, merged);
+        }
+        for (const Token& tok : layered) {
+            split_by_masks(tok, line_masks, true, merged);
+        }
+        std::ranges::sort(merged, {}, &Token::start);
+        out.assign_line(line_idx, merged);
+    }
+}
+
+void SyntaxHighlighter::capture_tokens(const LoadedLanguage& language, const TSTree* source,
+                                       LineIdx start_line, LineIdx end_line, ByteOff start_byte, ByteOff end_byte,
+                                       const LineOffsetTree& offset_tree, const LineStore& lines,
+                                       std::vector<LineToken>& out) const {
+    if (!query_cursor) {
+        query_cursor.reset(ts_query_cursor_new());
+    }
+    TSQueryCursor* cursor = query_cursor.get();
+    ts_query_cursor_set_byte_range(cursor, static_cast<uint32_t>(start_byte), static_cast<uint32_t>(end_byte));
+    ts_query_cursor_exec(cursor, language.query, ts_tree_root_node(source));
 
     LineIdx last_hint_line = start_line;
 
     TSQueryMatch match;
-    while (ts_query_cursor_next_match(cursor.get(), &match)) {
+    while (ts_query_cursor_next_match(cursor, &match)) {
         for (uint16_t i = 0; i < match.capture_count; i++) {
             const TSQueryCapture& capture = match.captures[i];
             uint32_t id = capture.index;
 
-            if (id < current_language->capture_map.size() && current_language->capture_map[id] != TokenType::Default) {
+            if (id < language.capture_map.size() && language.capture_map[id] != TokenType::Default) {
                 ByteOff node_start = ts_node_start_byte(capture.node);
                 ByteOff node_end = ts_node_end_byte(capture.node);
 
@@ -306,53 +644,64 @@ void SyntaxHighlighter::get_viewport_tokens(
                         ColIdx col_start = static_cast<ColIdx>(seg_start - line_start_abs);
                         ColIdx col_end = static_cast<ColIdx>(seg_end - line_start_abs);
 
-                        ColIdx line_len = static_cast<ColIdx>(lines[line_idx].size());
+                        ColIdx line_len = static_cast<ColIdx>(lines.view(static_cast<size_t>(line_idx)).size());
                         if (col_end > line_len) col_end = line_len;
                         if (col_start > line_len) col_start = line_len;
 
                         if (col_start < col_end) {
-                            result[line_idx].push_back({current_language->capture_map[id], col_start, col_end});
+                            out.push_back({line_idx, {language.capture_map[id], col_start, col_end}});
                         }
                     }
                 }
             }
         }
     }
+}
 
-    static thread_local std::vector<Token> resolved;
-    for (auto& [line_idx, tokens] : result) {
-        if (tokens.empty()) continue;
-
-        std::sort(tokens.begin(), tokens.end(), [](const Token& a, const Token& b) {
-            if (a.start != b.start) return a.start < b.start;
-            return a.end < b.end;
-        });
-
-        resolved.clear();
-        for (const auto& tok : tokens) {
-            if (resolved.empty()) {
-                resolved.push_back(tok);
-                continue;
-            }
-            Token& last = resolved.back();
-            if (tok.start >= last.end) {
-                resolved.push_back(tok);
-            } else if (tok.start == last.start && tok.end <= last.end) {
-                last = tok;
-            } else if (tok.start > last.start && tok.end <= last.end) {
-                Token before = {last.type, last.start, tok.start};
-                Token after = {last.type, tok.end, last.end};
-                resolved.pop_back();
-                if (before.start < before.end) resolved.push_back(before);
-                resolved.push_back(tok);
-                if (after.start < after.end) resolved.push_back(after);
-            } else if (tok.start < last.end && tok.end > last.end) {
-                last.end = tok.start;
-                if (last.start >= last.end) resolved.pop_back();
-                resolved.push_back(tok);
-            }
+void SyntaxHighlighter::resolve_overlaps(std::span<const LineToken> tokens, std::vector<Token>& out) {
+    out.clear();
+    for (const LineToken& line_token : tokens) {
+        const Token& tok = line_token.token;
+        if (out.empty()) {
+            out.push_back(tok);
+            continue;
+        }
+        Token& last = out.back();
+        if (tok.start >= last.end) {
+            out.push_back(tok);
+        } else if (tok.start == last.start && tok.end <= last.end) {
+            last = tok;
+        } else if (tok.start > last.start && tok.end <= last.end) {
+            Token before = {last.type, last.start, tok.start};
+            Token after = {last.type, tok.end, last.end};
+            out.pop_back();
+            if (before.start < before.end) out.push_back(before);
+            out.push_back(tok);
+            if (after.start < after.end) out.push_back(after);
+        } else if (tok.start < last.end && tok.end > last.end) {
+            last.end = tok.start;
+            if (last.start >= last.end) out.pop_back();
+            out.push_back(tok);
+        }
+    }
+}
+
+void SyntaxHighlighter::split_by_masks(const Token& tok, std::span<const LineToken> masks, bool inside,
+                                       std::vector<Token>& out) {
+    ColIdx pos = tok.start;
+    for (const LineToken& mask : masks) {
+        const Token& span = mask.token;
+        if (span.end <= pos) continue;
+        if (span.start >= tok.end) break;
+        if (inside) {
+            out.push_back({tok.type, std::max(pos, span.start), std::min(tok.end, span.end)});
+        } else if (span.start > pos) {
+            out.push_back({tok.type, pos, span.start});
         }
-        tokens = resolved;
+        pos = span.end;
+    }
+    if (!inside && pos < tok.end) {
+        out.push_back({tok.type, pos, tok.end});
     }
 }
 
@@ -4,16 +4,24 @@
 #include "HandleTypes.h"
 #include "LanguageRegistry.h"
 #include "LineOffsetTree.h"
+#include "TokenArena.h"
+#include "Injections.h"
+#include "HighlightCache.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <limits>
+#include <memory>
+#include <span>
+
+struct DocumentSnapshot;
 
 struct LinesReadContext {
-    const std::vector<std::string>* lines = nullptr;
+    const LineStore* lines = nullptr;
     const LineOffsetTree* offset_tree = nullptr;
     mutable size_t last_line_idx = 0;
 
-    void set(const std::vector<std::string>& l, const LineOffsetTree& t);
+    void set(const LineStore& l, const LineOffsetTree& t);
     std::pair<size_t, ByteOff> find_line_and_offset(ByteOff byte_index) const;
 };
 
@@ -22,31 +30,97 @@ const char* ts_input_read_callback(
 );
 
 struct SyntaxHighlighter {
+    // tree-sitter addresses input with 32-bit offsets; larger documents only get the fallback lexer.
+    static constexpr ByteOff MAX_PARSE_BYTES = std::numeric_limits<uint32_t>::max();
+    // Opening a file parses on the spot for at most this long, so small files are
+    // highlighted on the first frame; a parse that runs out of time is resumed
+    // by the background worker rather than restarted.
+    static constexpr uint64_t SYNC_PARSE_BUDGET_MICROS = 8000;
+    struct HighlightCacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+
+        double hit_rate() const {
+            size_t total = hits + misses;
+            return total > 0 ? static_cast<double>(hits) / static_cast<double>(total) : 0.0;
+        }
+    };
+
     TSParserPtr parser;
     TSTreePtr tree;
     LoadedLanguage* current_language = nullptr;
     LinesReadContext read_context;
     std::string current_language_id;
+    // Multi-line foldable nodes of tree, ordered by start line.
+    std::vector<FoldRegion> folds;
+    // Languages embedded in tree, kept in step with it.
+    std::vector<InjectionLayer> injections;
 
     SyntaxHighlighter();
+    ~SyntaxHighlighter();
 
-    bool set_language_for_file(const std::string& filepath, const std::vector<std::string>& lines, const LineOffsetTree& offset_tree);
-    void parse(const std::vector<std::string>& lines, const LineOffsetTree& offset_tree);
+    bool set_language_for_file(const std::string& filepath, const LineStore& lines, const LineOffsetTree& offset_tree);
+    void parse(const LineStore& lines, const LineOffsetTree& offset_tree, uint64_t budget_micros = 0);
     void apply_edit(ByteOff start_byte, ByteOff old_end_byte, ByteOff new_end_byte,
                     TSPoint start_point, TSPoint old_end_point, TSPoint new_end_point);
-    void parse_incremental(const std::vector<std::string>& lines, const LineOffsetTree& offset_tree);
-    std::vector<Token> get_line_tokens(ByteOff line_start_byte, ByteOff line_end_byte) const;
+    void reset_tree();
+
+    // Reparses the snapshot on a worker thread, starting from a copy of the
+    // current tree. Until poll_parse() picks up the result, tree stays in use
+    // and keeps following edits through apply_edit().
+    void parse_async(std::shared_ptr<const DocumentSnapshot> snapshot);
+    // Swaps in a finished background tree, with the edits made since its
+    // snapshot applied on top. Returns true when tree changed; changed_ranges
+    // then holds the spans whose syntax differs from the previous tree.
+    bool poll_parse(std::vector<TSRange>& changed_ranges);
+    void cancel_parse();
+    bool is_parsing() const { return background != nullptr; }
+
     LineIdx find_line_for_byte_in_range(ByteOff byte_pos, LineIdx hint_line, LineIdx range_start, LineIdx range_end,
                                     const LineOffsetTree& offset_tree) const;
     void get_viewport_tokens(
         LineIdx start_line, LineIdx end_line,
         const LineOffsetTree& offset_tree,
-        const std::vector<std::string>& lines,
-        std::unordered_map<LineIdx, std::vector<Token>>& result
+        const LineStore& lines,
+        TokenArena& out
     ) const;
     const std::string& get_line_comment_token() const;
     const BlockComment& get_block_comment() const;
     const std::vector<AutoPair>& get_auto_pairs() const;
     const std::vector<char>& get_indent_triggers() const;
     bool has_language() const;
+    const HighlightCacheStats& highlight_cache_stats() const { return cache_stats; }
+
+private:
+    struct BackgroundParse;
+
+    struct LineToken {
+        LineIdx line;
+        Token token;
+    };
+
+    std::unique_ptr<BackgroundParse> background;
+    mutable TSQueryCursorPtr query_cursor;
+    std::vector<TSInputEdit> edits_since_snapshot;
+
+    // The tree was edited after it was parsed, so its queries only approximate the text.
+    bool tree_edited = false;
+    // A budgeted parse ran out of time; the parser holds its progress until reset.
+    bool parse_suspended = false;
+    mutable HighlightCache highlight_cache;
+    mutable HighlightCacheStats cache_stats;
+
+    void set_tree(TSTree* new_tree, bool edited = false);
+    void discard_suspended_parse();
+    void query_tokens(LineIdx start_line, LineIdx end_line, const LineOffsetTree& offset_tree,
+                      const LineStore& lines, TokenArena& out) const;
+    void capture_tokens(const LoadedLanguage& language, const TSTree* source,
+                        LineIdx start_line, LineIdx end_line, ByteOff start_byte, ByteOff end_byte,
+                        const LineOffsetTree& offset_tree, const LineStore& lines,
+                        std::vector<LineToken>& out) const;
+    // Flattens one line's sorted, possibly nested tokens so inner ones win.
+    static void resolve_overlaps(std::span<const LineToken> tokens, std::vector<Token>& out);
+    // Appends the parts of tok inside (or outside) masks, which are sorted and disjoint.
+    static void split_by_masks(const Token& tok, std::span<const LineToken> masks, bool inside,
+                               std::vector<Token>& out);
 };
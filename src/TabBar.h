@@ -16,6 +16,7 @@
 struct Tab {
     std::unique_ptr<Editor> editor;
     std::string title;
+    int load_toast_id = -1;
 
     Tab() : editor(std::make_unique<Editor>()) {}
 
@@ -91,6 +92,13 @@ public:
         return nullptr;
     }
 
+    const Editor* get_active_editor() const {
+        if (active_tab >= 0 && active_tab < static_cast<int>(tabs.size())) {
+            return tabs[active_tab].editor.get();
+        }
+        return nullptr;
+    }
+
     const Tab* get_tab(int index) const {
         if (index >= 0 && index < static_cast<int>(tabs.size())) {
             return &tabs[index];
@@ -363,15 +371,15 @@ public:
         }
     }
 
-    void render(SDL_Renderer* renderer, TextureCache& texture_cache,
+    void render(RenderQueue& queue, TextureCache& texture_cache,
                 int x_offset, int y_offset, int bar_width, int line_height,
                 const FileTree* file_tree = nullptr) {
 
-        SDL_SetRenderDrawColor(renderer, TAB_BG_COLOR.r, TAB_BG_COLOR.g, TAB_BG_COLOR.b, 255);
+        queue.set_color(TAB_BG_COLOR.r, TAB_BG_COLOR.g, TAB_BG_COLOR.b, 255);
         SDL_Rect bar_bg = {x_offset, y_offset, bar_width, L->tab_bar_height};
-        SDL_RenderFillRect(renderer, &bar_bg);
+        queue.fill_rect(bar_bg);
 
-        SDL_RenderSetClipRect(renderer, &bar_bg);
+        queue.set_clip(&bar_bg);
 
         int x = x_offset - scroll_offset;
         for (int i = 0; i < static_cast<int>(tabs.size()); i++) {
@@ -381,32 +389,32 @@ public:
             SDL_Color bg = (i == active_tab) ? TAB_ACTIVE_COLOR :
                            (i == hovered_tab) ? TAB_HOVER_COLOR : TAB_BG_COLOR;
 
-            SDL_SetRenderDrawColor(renderer, bg.r, bg.g, bg.b, 255);
+            queue.set_color(bg.r, bg.g, bg.b, 255);
             SDL_Rect tab_rect = {x, y_offset, tab_w, L->tab_bar_height};
-            SDL_RenderFillRect(renderer, &tab_rect);
+            queue.fill_rect(tab_rect);
 
             if (i == active_tab) {
-                SDL_SetRenderDrawColor(renderer, TAB_ACTIVE_INDICATOR.r, TAB_ACTIVE_INDICATOR.g,
+                queue.set_color(TAB_ACTIVE_INDICATOR.r, TAB_ACTIVE_INDICATOR.g,
                                        TAB_ACTIVE_INDICATOR.b, 255);
                 SDL_Rect indicator = {x, y_offset + L->tab_bar_height - L->scaled(2), tab_w, L->scaled(2)};
-                SDL_RenderFillRect(renderer, &indicator);
+                queue.fill_rect(indicator);
             }
 
-            SDL_SetRenderDrawColor(renderer, TAB_BORDER_COLOR.r, TAB_BORDER_COLOR.g,
+            queue.set_color(TAB_BORDER_COLOR.r, TAB_BORDER_COLOR.g,
                                    TAB_BORDER_COLOR.b, 255);
-            SDL_RenderDrawLine(renderer, x + tab_w - 1, y_offset + L->scaled(4),
+            queue.draw_line(x + tab_w - 1, y_offset + L->scaled(4),
                                x + tab_w - 1, y_offset + L->tab_bar_height - L->scaled(4));
 
             int text_x = x + L->tab_padding;
             int text_y = y_offset + (L->tab_bar_height - line_height) / 2;
 
             if (tab.is_modified()) {
-                SDL_SetRenderDrawColor(renderer, TAB_MODIFIED_DOT.r, TAB_MODIFIED_DOT.g,
+                queue.set_color(TAB_MODIFIED_DOT.r, TAB_MODIFIED_DOT.g,
                                        TAB_MODIFIED_DOT.b, 255);
                 int dot_y = y_offset + L->tab_bar_height / 2;
                 int dot_size = L->scaled(6);
                 SDL_Rect dot = {text_x, dot_y - dot_size / 2, dot_size, dot_size};
-                SDL_RenderFillRect(renderer, &dot);
+                queue.fill_rect(dot);
                 text_x += L->scaled(10);
             }
 
@@ -428,30 +436,30 @@ public:
             int close_y = y_offset + (L->tab_bar_height - L->tab_close_size) / 2;
 
             if (i == hovered_close) {
-                SDL_SetRenderDrawColor(renderer, TAB_CLOSE_HOVER_BG.r, TAB_CLOSE_HOVER_BG.g,
+                queue.set_color(TAB_CLOSE_HOVER_BG.r, TAB_CLOSE_HOVER_BG.g,
                                        TAB_CLOSE_HOVER_BG.b, 255);
                 SDL_Rect close_bg = {close_x - L->scaled(2), close_y - L->scaled(2),
                                      L->tab_close_size + L->scaled(4), L->tab_close_size + L->scaled(4)};
-                SDL_RenderFillRect(renderer, &close_bg);
+                queue.fill_rect(close_bg);
             }
 
             SDL_Color close_color = (i == hovered_close) ? TAB_CLOSE_COLOR_HOVER : TAB_CLOSE_COLOR;
-            SDL_SetRenderDrawColor(renderer, close_color.r, close_color.g, close_color.b, 255);
+            queue.set_color(close_color.r, close_color.g, close_color.b, 255);
 
             int cx = close_x + L->tab_close_size / 2;
             int cy = close_y + L->tab_close_size / 2;
             int half = L->tab_close_size / 3;
-            SDL_RenderDrawLine(renderer, cx - half, cy - half, cx + half, cy + half);
-            SDL_RenderDrawLine(renderer, cx + half, cy - half, cx - half, cy + half);
+            queue.draw_line(cx - half, cy - half, cx + half, cy + half);
+            queue.draw_line(cx + half, cy - half, cx - half, cy + half);
 
             x += tab_w;
         }
 
-        SDL_RenderSetClipRect(renderer, nullptr);
+        queue.set_clip(nullptr);
 
-        SDL_SetRenderDrawColor(renderer, TAB_BORDER_COLOR.r, TAB_BORDER_COLOR.g,
+        queue.set_color(TAB_BORDER_COLOR.r, TAB_BORDER_COLOR.g,
                                TAB_BORDER_COLOR.b, 255);
-        SDL_RenderDrawLine(renderer, x_offset, y_offset + L->tab_bar_height - 1,
+        queue.draw_line(x_offset, y_offset + L->tab_bar_height - 1,
                            x_offset + bar_width, y_offset + L->tab_bar_height - 1);
     }
 };
@@ -1,4 +1,5 @@
 #include "Terminal.h"
+#include "TextureCache.h"
 #include <fcntl.h>
 #include <termios.h>
 #include <unistd.h>
@@ -22,7 +23,6 @@ TerminalEmulator::~TerminalEmulator() {
 }
 
 void TerminalEmulator::destroy() {
-    glyph_cache.clear();
     scrollback_buffer.clear();
     scroll_offset = 0;
     if (master_fd != -1) {
@@ -117,14 +117,13 @@ int TerminalEmulator::sb_popline_callback(int cols, VTermScreenCell* cells, void
     return 1;
 }
 
-void TerminalEmulator::spawn(int width, int height, int fw, int fh, FocusPanel* focus_ptr, SDL_Renderer* renderer, TTF_Font* font) {
+void TerminalEmulator::spawn(int width, int height, int fw, int fh, FocusPanel* focus_ptr) {
     font_width = fw;
     font_height = fh;
     current_focus = focus_ptr;
     term_cols = std::max(10, width / std::max(1, fw));
     term_rows = std::max(2, height / std::max(1, fh));
 
-    glyph_cache.init(renderer, font);
     scrollback_buffer.clear();
     scroll_offset = 0;
 
@@ -260,13 +259,13 @@ void TerminalEmulator::handle_mouse_wheel(int wheel_y) {
     }
 }
 
-void TerminalEmulator::render(SDL_Renderer* renderer, TTF_Font* font, int x, int y, int width, int height) {
+void TerminalEmulator::render(RenderQueue& queue, TextureCache& texture_cache, int x, int y, int width, int height) {
     if (!screen) return;
 
-    (void)font;
+    GlyphAtlas& glyph_atlas = texture_cache.glyph_atlas;
 
     SDL_Rect term_rect = {x, y, width, height};
-    SDL_RenderSetClipRect(renderer, &term_rect);
+    queue.set_clip(&term_rect);
 
     VTermState* state = vterm_obtain_state(vterm);
     VTermPos cursor_pos;
@@ -345,9 +344,9 @@ void TerminalEmulator::render(SDL_Renderer* renderer, TTF_Font* font, int x, int
 
             bool bg_not_default = (bg.r != default_bg.r || bg.g != default_bg.g || bg.b != default_bg.b);
             if (bg_not_default || is_cursor) {
-                SDL_SetRenderDrawColor(renderer, bg.r, bg.g, bg.b, 255);
+                queue.set_color(bg.r, bg.g, bg.b, 255);
                 SDL_Rect cell_rect = {draw_x, draw_y, font_width * cell_width, font_height};
-                SDL_RenderFillRect(renderer, &cell_rect);
+                queue.fill_rect(cell_rect);
             }
 
             if (codepoint != 0 && codepoint != ' ') {
@@ -358,11 +357,7 @@ void TerminalEmulator::render(SDL_Renderer* renderer, TTF_Font* font, int x, int
                     render_fg.b = static_cast<uint8_t>(std::min(255, render_fg.b + 50));
                 }
 
-                auto* glyph = glyph_cache.get_or_create(codepoint, render_fg, bold ? 1 : 0);
-                if (glyph && glyph->texture) {
-                    SDL_Rect dst = {draw_x, draw_y, glyph->width, glyph->height};
-                    SDL_RenderCopy(renderer, glyph->texture.get(), nullptr, &dst);
-                }
+                glyph_atlas.queue_glyph(codepoint, render_fg, draw_x, draw_y);
             }
 
             draw_x += font_width * cell_width;
@@ -378,16 +373,12 @@ void TerminalEmulator::render(SDL_Renderer* renderer, TTF_Font* font, int x, int
         int info_x = x + width - static_cast<int>(scroll_text.size()) * font_width - 5;
         int info_y = y + 2;
         for (char c : scroll_text) {
-            auto* g = glyph_cache.get_or_create(static_cast<uint32_t>(c), info_color);
-            if (g && g->texture) {
-                SDL_Rect dst = {info_x, info_y, g->width, g->height};
-                SDL_RenderCopy(renderer, g->texture.get(), nullptr, &dst);
-                info_x += font_width;
-            }
+            glyph_atlas.queue_glyph(static_cast<uint32_t>(c), info_color, info_x, info_y);
+            info_x += font_width;
         }
     }
 
-    SDL_RenderSetClipRect(renderer, nullptr);
+    queue.set_clip(nullptr);
     needs_redraw = false;
 }
 
@@ -1,13 +1,15 @@
 #pragma once
 
 #include "Types.h"
-#include "GlyphCache.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <deque>
 #include <vector>
 #include <cstdint>
 
+struct TextureCache;
+class RenderQueue;
+
 extern "C" {
     #include <vterm.h>
 }
@@ -32,7 +34,6 @@ struct TerminalEmulator {
     int font_height = 0;
     bool needs_redraw = true;
     FocusPanel* current_focus = nullptr;
-    GlyphCache glyph_cache;
 
     std::deque<std::vector<ScrollbackCell>> scrollback_buffer;
     int scroll_offset = 0;
@@ -70,7 +71,7 @@ struct TerminalEmulator {
     static int sb_pushline_callback(int cols, const VTermScreenCell* cells, void* user);
     static int sb_popline_callback(int cols, VTermScreenCell* cells, void* user);
 
-    void spawn(int width, int height, int fw, int fh, FocusPanel* focus_ptr, SDL_Renderer* renderer, TTF_Font* font);
+    void spawn(int width, int height, int fw, int fh, FocusPanel* focus_ptr);
     void resize(int width, int height);
     void write_input(const char* data, size_t len);
     void write_input(const std::string& data);
@@ -79,6 +80,6 @@ struct TerminalEmulator {
     void handle_mouse_wheel(int wheel_y);
     void handle_key_event(const SDL_Event& event);
     void flush_output();
-    void render(SDL_Renderer* renderer, TTF_Font* font, int x, int y, int width, int height);
+    void render(RenderQueue& queue, TextureCache& texture_cache, int x, int y, int width, int height);
     bool is_running() const;
 };
@@ -1,110 +1,436 @@
 #include "TextDocument.h"
-#include <fstream>
+#include "NewlineScan.h"
 #include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+namespace {
+constexpr size_t MAPPED_CHUNK_SPAN = size_t{1} << 30;
+constexpr size_t STREAMING_FIRST_SCREEN_BYTES = size_t{1} << 20;
+constexpr size_t STREAMING_BATCH_BYTES = size_t{8} << 20;
+constexpr size_t STREAMING_POLL_LINES = size_t{1} << 17;
+
+// Collects line starts of a mapped file into LineStore-sized chunks. scan()
+// may be called on consecutive ranges; the partial chunk carries over.
+class ChunkScanner {
+public:
+    explicit ChunkScanner(const char* base) : text_begin(base) { reset(base); }
+
+    template <typename Emit>
+    void scan(const char* ptr, const char* end, Emit&& emit) {
+        for_each_newline(ptr, end, [&](const char* newline) {
+            if (newline == text_begin || newline[-1] != '\r') bare_newline = true;
+            const char* next = newline + 1;
+            starts.push_back(static_cast<uint64_t>(next - chunk_base));
+
+            if (starts.size() > LineStore::CHUNK_TARGET || static_cast<size_t>(next - chunk_base) > MAPPED_CHUNK_SPAN) {
+                emit(chunk_base, std::move(starts), true);
+                reset(next);
+            }
+        });
+    }
+
+    // The last line runs to the end of the file without a '\n' of its own.
+    template <typename Emit>
+    void finish(const char* end, Emit&& emit) {
+        starts.push_back(static_cast<uint64_t>(end - chunk_base + 1));
+        emit(chunk_base, std::move(starts), false);
+    }
+
+    // Whether any newline scanned so far lacks a '\r' before it.
+    bool saw_bare_newline() const { return bare_newline; }
+
+private:
+    const char* text_begin;
+    const char* chunk_base = nullptr;
+    std::vector<uint64_t> starts;
+    bool bare_newline = false;
+
+    void reset(const char* base) {
+        chunk_base = base;
+        starts.clear();
+        starts.reserve(LineStore::CHUNK_TARGET + 1);
+        starts.push_back(0);
+    }
+};
+}
+
+struct TextDocument::StreamingLoad {
+    struct Chunk {
+        const char* base;
+        std::vector<uint64_t> starts;
+        bool ends_with_newline;
+    };
+
+    std::shared_ptr<const MappedFile> file;
+    // Chosen from the first screen; `bare_newline` reports whether the rest agreed.
+    bool strip_cr = false;
+    bool bare_newline = false;
+    // Restored when loading ends; the document is read-only only while it streams.
+    bool was_readonly = false;
+    std::mutex mutex;
+    std::deque<Chunk> pending;
+    bool done = false;
+    std::atomic<size_t> bytes_scanned{0};
+    std::atomic<bool> cancelled{false};
+};
+
+struct TextDocument::BackgroundSave {
+    std::filesystem::path path;
+    uint64_t version = 0;
+    std::thread worker;
+    std::atomic<bool> done{false};
+    std::expected<SaveStats, std::string> result;
+};
 
 TextDocument::TextDocument() {
     lines.emplace_back("");
     rebuild_line_offsets();
 }
 
-std::expected<void, std::string> TextDocument::load(const std::filesystem::path& path) {
-    FILE* f = fopen(path.c_str(), "rb");
-    if (!f) {
-        return std::unexpected("Failed to open file: " + path.string());
-    }
-
-    fseek(f, 0, SEEK_END);
-    long fsize = ftell(f);
-    fseek(f, 0, SEEK_SET);
+TextDocument::~TextDocument() {
+    cancel_loading();
+    wait_for_save();
+}
 
-    if (fsize < 0) {
-        fclose(f);
-        return std::unexpected("Failed to determine file size: " + path.string());
+std::expected<void, std::string> TextDocument::load(const std::filesystem::path& path) {
+    auto mapped = MappedFile::open(path);
+    if (!mapped) {
+        return std::unexpected(mapped.error());
     }
+    std::shared_ptr<const MappedFile> file = std::move(*mapped);
 
-    std::string buffer;
-    buffer.resize(fsize);
-    size_t read_size = fread(buffer.data(), 1, fsize, f);
-    fclose(f);
-    buffer.resize(read_size);
-
+    cancel_loading();
+    wait_for_save();
     lines.clear();
     lines.shrink_to_fit();
     offset_manager.clear();
 
-    lines.reserve(fsize / 40);
+    file_path = path.string();
+    format = TextFormat{};
+    readonly = false;
+    reset_version();
 
-    const char* ptr = buffer.data();
-    const char* end = ptr + buffer.size();
-    const char* line_start = ptr;
+    if (file->size() == 0) {
+        lines.emplace_back("");
+        rebuild_line_offsets();
+        return {};
+    }
 
-    while (ptr < end) {
-        if (*ptr == '\n') {
-            lines.emplace_back(line_start, ptr - line_start);
-            line_start = ptr + 1;
-        }
-        ptr++;
+    // Large files are sniffed on the first screen only; the rest is not read up front.
+    size_t sample = file->size() >= STREAMING_LOAD_MIN_BYTES ? STREAMING_FIRST_SCREEN_BYTES : file->size();
+    format = detect_text_format(file->data(), sample, sample < file->size());
+
+    if (format.encoding == TextEncoding::Binary) {
+        lines.emplace_back("Binary file (" + std::to_string(file->size()) + " bytes), opened read-only");
+        rebuild_line_offsets();
+        readonly = true;
+        return {};
     }
 
-    if (line_start < end) {
-        lines.emplace_back(line_start, end - line_start);
-    } else {
-        lines.emplace_back("");
+    if (format.is_utf16()) {
+        size_t bom = format.bom_size();
+        std::string text = decode_utf16(file->data() + bom, file->size() - bom,
+                                        format.encoding == TextEncoding::Utf16BE, format.lossy);
+        format.line_ending = detect_text_format(text.data(), text.size()).line_ending;
+        assign_text(text, format.line_ending == LineEnding::CRLF);
+        // Saving would silently replace what could not be decoded.
+        readonly = format.lossy;
+        return {};
     }
 
-    if (lines.empty()) {
-        lines.push_back("");
+    bool strip_cr = format.line_ending == LineEnding::CRLF;
+    const char* base = file->data() + format.bom_size();
+    const char* end = file->data() + file->size();
+    file->advise_sequential();
+    lines.set_backing(file);
+
+    auto append = [this, strip_cr](const char* chunk_base, std::vector<uint64_t>&& starts, bool ends_with_newline) {
+        lines.append_mapped(chunk_base, std::move(starts), strip_cr, ends_with_newline);
+    };
+
+    if (file->size() < STREAMING_LOAD_MIN_BYTES) {
+        lines.reserve(count_newlines(base, end) + 1);
+    }
+
+    ChunkScanner scanner(base);
+    const char* scanned = base;
+    size_t sync_bytes = file->size() >= STREAMING_LOAD_MIN_BYTES ? STREAMING_FIRST_SCREEN_BYTES : file->size();
+    do {
+        const char* limit = scanned + std::min(sync_bytes, static_cast<size_t>(end - scanned));
+        scanner.scan(scanned, limit, append);
+        scanned = limit;
+    } while (lines.empty() && scanned < end);
+
+    if (scanned == end) {
+        scanner.finish(end, append);
+        file->advise_release(0, file->size());
+        rebuild_line_offsets();
+        return {};
     }
 
     rebuild_line_offsets();
 
-    file_path = path.string();
-    modified = false;
+    streaming = std::make_shared<StreamingLoad>();
+    streaming->was_readonly = readonly;
+    readonly = true;
+    streaming->file = file;
+    streaming->strip_cr = strip_cr;
+    streaming->bytes_scanned = static_cast<size_t>(scanned - file->data());
+
+    std::thread([state = streaming, scanner = std::move(scanner), scanned]() mutable {
+        const char* base = state->file->data();
+        const char* end = base + state->file->size();
+        std::vector<StreamingLoad::Chunk> batch;
+        auto collect = [&batch](const char* chunk_base, std::vector<uint64_t>&& starts, bool ends_with_newline) {
+            batch.push_back({chunk_base, std::move(starts), ends_with_newline});
+        };
+
+        while (scanned < end) {
+            if (state->cancelled) return;
+            const char* limit = scanned + std::min(STREAMING_BATCH_BYTES, static_cast<size_t>(end - scanned));
+            scanner.scan(scanned, limit, collect);
+            state->file->advise_release(scanned - base, limit - scanned);
+            scanned = limit;
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            std::move(batch.begin(), batch.end(), std::back_inserter(state->pending));
+            batch.clear();
+            state->bytes_scanned = static_cast<size_t>(scanned - base);
+        }
+
+        scanner.finish(end, collect);
+        std::lock_guard<std::mutex> lock(state->mutex);
+        std::move(batch.begin(), batch.end(), std::back_inserter(state->pending));
+        state->bare_newline = scanner.saw_bare_newline();
+        state->done = true;
+    }).detach();
 
     return {};
 }
 
-std::expected<void, std::string> TextDocument::save() {
+float TextDocument::load_progress() const {
+    if (!streaming) return 1.0f;
+    return static_cast<float>(streaming->bytes_scanned) / static_cast<float>(streaming->file->size());
+}
+
+bool TextDocument::poll_loading() {
+    if (!streaming) return false;
+
+    // Bounded per call so a fast scanner cannot stall the frame that drains it.
+    std::vector<StreamingLoad::Chunk> batch;
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(streaming->mutex);
+        size_t taken = 0;
+        while (!streaming->pending.empty() && taken < STREAMING_POLL_LINES) {
+            taken += streaming->pending.front().starts.size() - 1;
+            batch.push_back(std::move(streaming->pending.front()));
+            streaming->pending.pop_front();
+        }
+        done = streaming->done && streaming->pending.empty();
+    }
+
+    for (auto& chunk : batch) {
+        size_t first = lines.size();
+        lines.append_mapped(chunk.base, std::move(chunk.starts), streaming->strip_cr, chunk.ends_with_newline);
+        for (size_t i = first; i < lines.size(); ++i) {
+            offset_manager.append_line(static_cast<ByteOff>(lines.view(i).size() + 1));
+        }
+    }
+    if (!batch.empty()) {
+        reset_version();
+    }
+
+    if (!done) return false;
+
+    readonly = streaming->was_readonly;
+    if (streaming->strip_cr && streaming->bare_newline) {
+        // Saving would write CRLF after lines that ended in a bare LF.
+        format.lossy = true;
+        readonly = true;
+    }
+    streaming.reset();
+    return true;
+}
+
+void TextDocument::cancel_loading() {
+    if (!streaming) return;
+    streaming->cancelled = true;
+    readonly = streaming->was_readonly;
+    streaming.reset();
+}
+
+bool TextDocument::file_changed_on_disk() const {
+    const MappedFile* file = lines.backing_file();
+    return file && file->changed_on_disk();
+}
+
+bool TextDocument::file_truncated_on_disk() const {
+    const MappedFile* file = lines.backing_file();
+    return file && file->truncated();
+}
+
+size_t TextDocument::detach_from_file() {
+    const MappedFile* file = lines.backing_file();
+    if (!file) return 0;
+
+    // Lines past where loading stopped were never indexed, so saving would cut the file short.
+    bool partial = is_loading();
+    cancel_loading();
+    if (partial) readonly = true;
+    // A running save reads the same chunks; its result is still picked up by poll_save().
+    if (background_save && background_save->worker.joinable()) {
+        background_save->worker.join();
+    }
+    size_t lost = lines.detach_backing(file->readable_size());
+    rebuild_line_offsets();
+    if (lost > 0) {
+        version++;
+        modified = true;
+    }
+    return lost;
+}
+
+void TextDocument::detach_before_save(const std::filesystem::path& path) {
+    const MappedFile* file = lines.backing_file();
+    if (!file) return;
+    // Overwriting the mapped file in place would change the lines while they are written out.
+    if (file->changed_on_disk() || (file->is_same_file(path) && save_overwrites_in_place(path))) {
+        detach_from_file();
+    }
+}
+
+std::expected<SaveStats, std::string> TextDocument::save() {
     if (file_path.empty()) {
         return std::unexpected("No file path set");
     }
     return save_as(file_path);
 }
 
-std::expected<void, std::string> TextDocument::save_as(const std::filesystem::path& path) {
-    std::ofstream file(path);
-    if (!file.is_open()) {
-        return std::unexpected("Failed to open file for writing: " + path.string());
+std::expected<SaveStats, std::string> TextDocument::save_as(const std::filesystem::path& path) {
+    if (auto blocked = check_can_save(); !blocked) {
+        return std::unexpected(blocked.error());
     }
 
-    for (size_t i = 0; i < lines.size(); i++) {
-        file << lines[i];
-        if (i < lines.size() - 1) {
-            file << '\n';
-        }
+    // Let an in-flight background save land first so this one wins the rename.
+    if (background_save) {
+        background_save->worker.join();
+    }
+    detach_before_save(path);
+
+    auto result = save_lines_atomic(path, lines, format);
+    if (!result) {
+        return result;
     }
 
     file_path = path.string();
+    saved_version = version;
     modified = false;
+    return result;
+}
+
+std::expected<void, std::string> TextDocument::save_as_async(const std::filesystem::path& path) {
+    if (auto blocked = check_can_save(); !blocked) {
+        return blocked;
+    }
+    if (background_save) {
+        return std::unexpected("A save is already in progress");
+    }
+    detach_before_save(path);
+
+    background_save = std::make_unique<BackgroundSave>();
+    BackgroundSave* job = background_save.get();
+    job->path = path;
+    job->version = version;
+    job->worker = std::thread([job, snap = snapshot(), format = format]() {
+        job->result = save_lines_atomic(job->path, snap->lines, format);
+        job->done = true;
+    });
     return {};
 }
 
+std::optional<std::expected<SaveStats, std::string>> TextDocument::poll_save() {
+    if (!background_save || !background_save->done) {
+        return std::nullopt;
+    }
+
+    if (background_save->worker.joinable()) {
+        background_save->worker.join();
+    }
+    auto result = std::move(background_save->result);
+    if (result && background_save->version >= saved_version) {
+        file_path = background_save->path.string();
+        saved_version = background_save->version;
+        modified = version != saved_version;
+    }
+    background_save.reset();
+    return result;
+}
+
+std::expected<void, std::string> TextDocument::check_can_save() const {
+    if (streaming) {
+        return std::unexpected("File is still loading");
+    }
+    if (format.encoding == TextEncoding::Binary) {
+        return std::unexpected("Binary files are opened read-only");
+    }
+    if (format.lossy) {
+        return std::unexpected(format.is_utf16() ? "File has invalid UTF-16 and was opened read-only"
+                                                 : "File mixes CRLF and LF line endings and was opened read-only");
+    }
+    if (readonly) {
+        return std::unexpected("Document is read-only");
+    }
+    return {};
+}
+
+void TextDocument::wait_for_save() {
+    if (!background_save) return;
+    if (background_save->worker.joinable()) {
+        background_save->worker.join();
+    }
+    background_save.reset();
+}
+
+std::shared_ptr<const DocumentSnapshot> TextDocument::snapshot() const {
+    return std::make_shared<const DocumentSnapshot>(lines.snapshot(), offset_manager, version);
+}
+
+void TextDocument::reset_version() {
+    version++;
+    saved_version = version;
+    modified = false;
+}
+
 void TextDocument::load_text(const std::string& text) {
+    cancel_loading();
+    wait_for_save();
+    format = TextFormat{};
+    assign_text(text, false);
+    reset_version();
+}
+
+void TextDocument::assign_text(std::string_view text, bool strip_cr) {
     lines.clear();
     lines.shrink_to_fit();
     offset_manager.clear();
 
-    const char* ptr = text.data();
-    const char* end = ptr + text.size();
-    const char* line_start = ptr;
+    const char* line_start = text.data();
+    const char* end = line_start + text.size();
+    lines.reserve(count_newlines(line_start, end) + 1);
 
-    while (ptr < end) {
-        if (*ptr == '\n') {
-            lines.emplace_back(line_start, ptr - line_start);
-            line_start = ptr + 1;
-        }
-        ptr++;
-    }
+    for_each_newline(line_start, end, [&](const char* newline) {
+        const char* line_end = newline;
+        if (strip_cr && line_end > line_start && line_end[-1] == '\r') line_end--;
+        lines.emplace_back(line_start, line_end - line_start);
+        line_start = newline + 1;
+    });
 
     if (line_start < end) {
         lines.emplace_back(line_start, end - line_start);
@@ -117,16 +443,18 @@ void TextDocument::load_text(const std::string& text) {
     }
 
     rebuild_line_offsets();
-    modified = false;
 }
 
 void TextDocument::clear() {
+    cancel_loading();
+    wait_for_save();
     lines.clear();
     lines.emplace_back("");
     offset_manager.clear();
     rebuild_line_offsets();
     file_path.clear();
-    modified = false;
+    format = TextFormat{};
+    reset_version();
 }
 
 void TextDocument::rebuild_line_offsets() {
@@ -146,42 +474,54 @@ void TextDocument::insert_at(TextPos pos, const std::string& text, TextPos& out_
     LineIdx current_line = pos.line;
     ColIdx current_col = pos.col;
 
-    uint32_t start_byte = get_byte_offset(pos);
+    ByteOff start_byte = get_byte_offset(pos);
     TSPoint start_point = {static_cast<uint32_t>(current_line), static_cast<uint32_t>(current_col)};
     TSPoint old_end_point = start_point;
 
-    size_t str_pos = 0;
-    while (str_pos < text.size()) {
-        size_t newline = text.find('\n', str_pos);
-        if (newline == std::string::npos) {
-            lines[current_line].insert(current_col, text.substr(str_pos));
-            current_col += static_cast<int>(text.size() - str_pos);
-            break;
+    size_t newline = text.find('\n');
+    if (newline == std::string::npos) {
+        lines[current_line].insert(current_col, text);
+        current_col += static_cast<int>(text.size());
+    } else {
+        std::string& first = lines[current_line];
+        std::string remainder = first.substr(current_col);
+        first.erase(current_col);
+        first.append(text, 0, newline);
+
+        std::vector<std::string> new_lines;
+        size_t str_pos = newline + 1;
+        while ((newline = text.find('\n', str_pos)) != std::string::npos) {
+            new_lines.emplace_back(text, str_pos, newline - str_pos);
+            str_pos = newline + 1;
         }
-        lines[current_line].insert(current_col, text.substr(str_pos, newline - str_pos));
-        current_col += static_cast<int>(newline - str_pos);
-        std::string remainder = lines[current_line].substr(current_col);
-        lines[current_line] = lines[current_line].substr(0, current_col);
-        current_line++;
-        current_col = 0;
-        lines.insert(lines.begin() + current_line, remainder);
-        str_pos = newline + 1;
+        new_lines.emplace_back(text, str_pos);
+
+        current_line += static_cast<int>(new_lines.size());
+        current_col = static_cast<int>(new_lines.back().size());
+        new_lines.back() += remainder;
+
+        std::vector<ByteOff> lengths;
+        lengths.reserve(new_lines.size());
+        for (const std::string& line : new_lines) {
+            lengths.push_back(static_cast<ByteOff>(line.size() + 1));
+        }
+        offset_manager.set_line_length(pos.line, static_cast<ByteOff>(first.size() + 1));
+        offset_manager.insert_lines(pos.line + 1, lengths);
+        lines.insert(pos.line + 1, std::move(new_lines));
     }
 
     out_end.line = current_line;
     out_end.col = current_col;
 
     modified = true;
+    version++;
 
-    bool has_newlines = text.find('\n') != std::string::npos;
-    if (has_newlines) {
-        rebuild_line_offsets();
-    } else {
+    if (text.find('\n') == std::string::npos) {
         update_line_offsets(pos.line, static_cast<int>(text.size()));
     }
 
     TSPoint new_end_point = {static_cast<uint32_t>(current_line), static_cast<uint32_t>(current_col)};
-    notify_tree_edit(start_byte, 0, static_cast<uint32_t>(text.size()), start_point, old_end_point, new_end_point);
+    notify_tree_edit(start_byte, 0, static_cast<ByteOff>(text.size()), start_point, old_end_point, new_end_point);
 }
 
 void TextDocument::delete_range(TextPos start, TextPos end, std::string& out_deleted) {
@@ -198,14 +538,15 @@ void TextDocument::delete_range(TextPos start, TextPos end, std::string& out_del
     out_deleted.clear();
     for (int i = s_line; i <= e_line; i++) {
         int col_start = (i == s_line) ? s_col : 0;
-        int col_end = (i == e_line) ? e_col : static_cast<int>(lines[i].size());
-        out_deleted += lines[i].substr(col_start, col_end - col_start);
+        std::string_view line = lines.view(i);
+        int col_end = (i == e_line) ? e_col : static_cast<int>(line.size());
+        out_deleted += line.substr(col_start, col_end - col_start);
         if (i < e_line) out_deleted += '\n';
     }
 
-    uint32_t start_byte = get_byte_offset({s_line, s_col});
-    uint32_t end_byte = get_byte_offset({e_line, e_col});
-    uint32_t bytes_removed = end_byte - start_byte;
+    ByteOff start_byte = get_byte_offset({s_line, s_col});
+    ByteOff end_byte = get_byte_offset({e_line, e_col});
+    ByteOff bytes_removed = end_byte - start_byte;
     TSPoint start_point = {static_cast<uint32_t>(s_line), static_cast<uint32_t>(s_col)};
     TSPoint old_end_point = {static_cast<uint32_t>(e_line), static_cast<uint32_t>(e_col)};
 
@@ -213,13 +554,17 @@ void TextDocument::delete_range(TextPos start, TextPos end, std::string& out_del
         lines[s_line].erase(s_col, e_col - s_col);
         update_line_offsets(s_line, -static_cast<int>(bytes_removed));
     } else {
-        std::string new_line_content = lines[s_line].substr(0, s_col) + lines[e_line].substr(e_col);
-        lines.erase(lines.begin() + s_line, lines.begin() + e_line + 1);
-        lines.insert(lines.begin() + s_line, new_line_content);
-        rebuild_line_offsets();
+        std::string tail = lines[e_line].substr(e_col);
+        std::string& first = lines[s_line];
+        first.erase(s_col);
+        first += tail;
+        offset_manager.set_line_length(s_line, static_cast<ByteOff>(first.size() + 1));
+        offset_manager.remove_lines(s_line + 1, e_line + 1);
+        lines.erase(s_line + 1, e_line + 1);
     }
 
     modified = true;
+    version++;
     notify_tree_edit(start_byte, bytes_removed, 0, start_point, old_end_point, start_point);
 }
 
@@ -227,29 +572,25 @@ void TextDocument::move_lines(LineIdx block_start, LineIdx block_end, int direct
     LineIdx affected_start = (direction == -1) ? block_start - 1 : block_start;
     LineIdx affected_end = (direction == -1) ? block_end : block_end + 1;
 
-    uint32_t start_byte = offset_manager.get_line_start_offset(affected_start);
-    uint32_t end_byte = offset_manager.get_line_start_offset(affected_end + 1);
-    uint32_t byte_len = end_byte - start_byte;
+    ByteOff start_byte = offset_manager.get_line_start_offset(affected_start);
+    ByteOff end_byte = offset_manager.get_line_start_offset(affected_end + 1);
+    ByteOff byte_len = end_byte - start_byte;
 
     TSPoint start_point = {static_cast<uint32_t>(affected_start), 0};
     TSPoint end_point = {static_cast<uint32_t>(affected_end + 1), 0};
 
-    if (direction == -1) {
-        std::string moving_line = std::move(lines[block_start - 1]);
-        for (int i = block_start - 1; i < block_end; ++i) {
-            lines[i] = std::move(lines[i + 1]);
-        }
-        lines[block_end] = std::move(moving_line);
-    } else {
-        std::string moving_line = std::move(lines[block_end + 1]);
-        for (int i = block_end + 1; i > block_start; --i) {
-            lines[i] = std::move(lines[i - 1]);
-        }
-        lines[block_start] = std::move(moving_line);
-    }
+    LineIdx from = (direction == -1) ? block_start - 1 : block_end + 1;
+    LineIdx to = (direction == -1) ? block_end : block_start;
+
+    std::string moving_line = std::move(lines[from]);
+    ByteOff moving_length = offset_manager.get_line_length(from);
+    lines.erase(from, from + 1);
+    lines.insert(to, std::move(moving_line));
+    offset_manager.remove_line(from);
+    offset_manager.insert_line(to, moving_length);
 
     modified = true;
-    rebuild_line_offsets();
+    version++;
     notify_tree_edit(start_byte, byte_len, byte_len, start_point, end_point, end_point);
 }
 
@@ -259,7 +600,54 @@ void TextDocument::set_tree_edit_callback(TreeEditCallback callback) {
 
 void TextDocument::notify_tree_edit(ByteOff start_byte, ByteOff bytes_removed, ByteOff bytes_added,
                                      TSPoint start_point, TSPoint old_end_point, TSPoint new_end_point) {
+    if (batch.depth > 0) {
+        // Grow the pending span: old_end stays in pre-batch coordinates, new_end in current ones.
+        ByteOff old_end = start_byte + bytes_removed;
+        ByteOff new_end = start_byte + bytes_added;
+        if (!batch.any) {
+            batch.any = true;
+            batch.start = start_byte;
+            batch.old_end = old_end;
+            batch.new_end = new_end;
+            return;
+        }
+        ByteOff covered = std::max(batch.new_end, old_end);
+        batch.old_end += covered - batch.new_end;
+        batch.new_end = covered - old_end + new_end;
+        batch.start = std::min(batch.start, start_byte);
+        return;
+    }
+
     if (tree_edit_callback) {
         tree_edit_callback(start_byte, bytes_removed, bytes_added, start_point, old_end_point, new_end_point);
     }
 }
+
+void TextDocument::begin_edit_batch() {
+    if (batch.depth++ == 0) {
+        batch.any = false;
+        batch.lines_before = lines.size();
+    }
+}
+
+void TextDocument::end_edit_batch() {
+    if (batch.depth == 0 || --batch.depth > 0 || !batch.any) return;
+    batch.any = false;
+
+    // Widen to whole lines so every point of the combined edit sits at column 0.
+    LineIdx start_line = offset_manager.find_line_by_offset(batch.start);
+    LineIdx end_line = offset_manager.find_line_by_offset(batch.new_end);
+    if (offset_manager.get_line_start_offset(end_line) < batch.new_end) {
+        end_line++;
+    }
+
+    ByteOff start = offset_manager.get_line_start_offset(start_line);
+    ByteOff new_end = offset_manager.get_line_start_offset(end_line);
+    ByteOff old_end = batch.old_end + (new_end - batch.new_end);
+    auto old_end_line = static_cast<LineIdx>(end_line - static_cast<LineIdx>(lines.size()) + static_cast<LineIdx>(batch.lines_before));
+
+    notify_tree_edit(start, old_end - start, new_end - start,
+                     {static_cast<uint32_t>(start_line), 0},
+                     {static_cast<uint32_t>(old_end_line), 0},
+                     {static_cast<uint32_t>(end_line), 0});
+}
@@ -2,29 +2,67 @@
 
 #include "Types.h"
 #include "LineOffsetTree.h"
+#include "LineStore.h"
+#include "AtomicSave.h"
+#include "TextFormat.h"
 #include <vector>
 #include <string>
 #include <expected>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <cstdint>
 #include <tree_sitter/api.h>
 
+// Immutable copy of a document at one version. It shares chunks with the live
+// document, so taking one costs O(chunks), and worker threads may keep reading
+// it while the UI thread goes on editing.
+struct DocumentSnapshot {
+    LineStore lines;
+    LineOffsetTree offsets;
+    uint64_t version = 0;
+};
+
 class TextDocument {
 public:
-    std::vector<std::string> lines;
+    LineStore lines;
     LineOffsetTree offset_manager;
     std::string file_path;
     bool readonly = false;
     bool modified = false;
+    uint64_t version = 0;
+    TextFormat format;
+
+    // Files at least this large open with the first screen only; the rest is
+    // indexed on a background thread and picked up by poll_loading().
+    static constexpr size_t STREAMING_LOAD_MIN_BYTES = size_t{32} << 20;
 
     TextDocument();
+    ~TextDocument();
 
     std::expected<void, std::string> load(const std::filesystem::path& path);
-    std::expected<void, std::string> save();
-    std::expected<void, std::string> save_as(const std::filesystem::path& path);
+    std::expected<SaveStats, std::string> save();
+    std::expected<SaveStats, std::string> save_as(const std::filesystem::path& path);
+    std::expected<void, std::string> save_as_async(const std::filesystem::path& path);
+    std::optional<std::expected<SaveStats, std::string>> poll_save();
+    bool is_saving() const { return background_save != nullptr; }
     void load_text(const std::string& text);
     void clear();
 
+    std::shared_ptr<const DocumentSnapshot> snapshot() const;
+
+    // Whether the mapped file was truncated or rewritten in place since it was loaded.
+    bool file_changed_on_disk() const;
+    bool file_truncated_on_disk() const;
+    // Stops reading lines from the mapped file. Returns how many lines lay
+    // past its new end; those come back empty and mark the document modified.
+    size_t detach_from_file();
+
+    bool is_loading() const { return streaming != nullptr; }
+    float load_progress() const;
+    bool poll_loading();
+
     size_t line_count() const { return lines.size(); }
     bool empty() const { return lines.empty() || (lines.size() == 1 && lines[0].empty()); }
     const std::string& get_line(LineIdx idx) const { return lines[idx]; }
@@ -42,8 +80,36 @@ public:
                                                  TSPoint start_point, TSPoint old_end_point, TSPoint new_end_point)>;
     void set_tree_edit_callback(TreeEditCallback callback);
 
+    // Edits made between these calls reach the tree edit callback as a single
+    // edit covering every line they touched. Batches may nest.
+    void begin_edit_batch();
+    void end_edit_batch();
+
 private:
+    struct StreamingLoad;
+    struct BackgroundSave;
+
+    struct EditBatch {
+        int depth = 0;
+        bool any = false;
+        ByteOff start = 0;
+        ByteOff old_end = 0;
+        ByteOff new_end = 0;
+        size_t lines_before = 0;
+    };
+
     TreeEditCallback tree_edit_callback;
+    EditBatch batch;
+    std::shared_ptr<StreamingLoad> streaming;
+    std::unique_ptr<BackgroundSave> background_save;
+    uint64_t saved_version = 0;
+
+    void cancel_loading();
+    void assign_text(std::string_view text, bool strip_cr);
+    std::expected<void, std::string> check_can_save() const;
+    void detach_before_save(const std::filesystem::path& path);
+    void wait_for_save();
+    void reset_version();
 
     void notify_tree_edit(ByteOff start_byte, ByteOff bytes_removed, ByteOff bytes_added,
                           TSPoint start_point, TSPoint old_end_point, TSPoint new_end_point);
@@ -0,0 +1,231 @@
+#include "TextFormat.h"
+#include "NewlineScan.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace {
+
+constexpr size_t UTF16_SNIFF_BYTES = 4096;
+
+// Guesses BOM-less UTF-16 from where the NUL bytes of ASCII text fall.
+TextEncoding sniff_utf16(const unsigned char* data, size_t size) {
+    size_t n = std::min(size, UTF16_SNIFF_BYTES) & ~size_t{1};
+    if (n == 0) return TextEncoding::Binary;
+
+    size_t even_nul = 0;
+    size_t odd_nul = 0;
+    for (size_t i = 0; i < n; i += 2) {
+        even_nul += data[i] == 0;
+        odd_nul += data[i + 1] == 0;
+    }
+
+    size_t units = n / 2;
+    if (odd_nul * 10 >= units * 4 && even_nul * 20 < units) return TextEncoding::Utf16LE;
+    if (even_nul * 10 >= units * 4 && odd_nul * 20 < units) return TextEncoding::Utf16BE;
+    return TextEncoding::Binary;
+}
+
+class Utf8Validator {
+public:
+    void feed(const unsigned char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            unsigned char c = data[i];
+            if (pending > 0) {
+                if ((c & 0xC0) == 0x80) {
+                    pending--;
+                    continue;
+                }
+                invalid = true;
+                pending = 0;
+            }
+            if (c < 0x80) continue;
+            if (c >= 0xC2 && c <= 0xDF) pending = 1;
+            else if ((c & 0xF0) == 0xE0) pending = 2;
+            else if (c >= 0xF0 && c <= 0xF4) pending = 3;
+            else invalid = true;
+        }
+    }
+
+    bool in_sequence() const { return pending > 0; }
+
+    int pending = 0;
+    bool invalid = false;
+};
+
+void put_unit(std::string& out, uint16_t unit, bool big_endian) {
+    char hi = static_cast<char>(unit >> 8);
+    char lo = static_cast<char>(unit & 0xFF);
+    if (big_endian) {
+        out += hi;
+        out += lo;
+    } else {
+        out += lo;
+        out += hi;
+    }
+}
+
+void put_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+}
+
+std::string TextFormat::describe() const {
+    if (encoding == TextEncoding::Binary) return "Binary";
+
+    std::string name;
+    switch (encoding) {
+        case TextEncoding::Utf8:    name = "UTF-8"; break;
+        case TextEncoding::Utf16LE: name = "UTF-16 LE"; break;
+        case TextEncoding::Utf16BE: name = "UTF-16 BE"; break;
+        case TextEncoding::Binary:  break;
+    }
+    if (bom && encoding == TextEncoding::Utf8) name += " BOM";
+    if (invalid_utf8) name += " (invalid)";
+    if (lossy) name += " (lossy, read-only)";
+    name += line_ending == LineEnding::CRLF ? "  CRLF" : "  LF";
+    return name;
+}
+
+TextFormat detect_text_format(const char* data, size_t size, bool partial) {
+    TextFormat format;
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+
+    if (size >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF) {
+        format.bom = true;
+        bytes += 3;
+        size -= 3;
+    } else if (size >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE) {
+        format.encoding = TextEncoding::Utf16LE;
+        format.bom = true;
+        return format;
+    } else if (size >= 2 && bytes[0] == 0xFE && bytes[1] == 0xFF) {
+        format.encoding = TextEncoding::Utf16BE;
+        format.bom = true;
+        return format;
+    }
+
+    ByteClassFn classify = byte_class_kernel();
+    Utf8Validator utf8;
+    size_t newlines = 0;
+    size_t crlf = 0;
+    bool cr_carry = false;
+    bool has_nul = false;
+
+    auto account = [&](const ByteClassMasks& m, const unsigned char* block, size_t len) {
+        newlines += static_cast<size_t>(std::popcount(m.newline));
+        crlf += static_cast<size_t>(std::popcount(m.newline & ((m.carriage_return << 1) | (cr_carry ? 1 : 0))));
+        cr_carry = (m.carriage_return >> (len - 1)) & 1;
+        has_nul |= m.nul != 0;
+        if (m.high != 0 || utf8.in_sequence()) {
+            utf8.feed(block, len);
+        }
+    };
+
+    size_t i = 0;
+    for (; i + 64 <= size && !has_nul; i += 64) {
+        account(classify(reinterpret_cast<const char*>(bytes + i)), bytes + i, 64);
+    }
+    if (i < size && !has_nul) {
+        ByteClassMasks tail;
+        for (size_t k = 0; i + k < size; ++k) {
+            unsigned char c = bytes[i + k];
+            uint64_t bit = uint64_t{1} << k;
+            if (c == '\n') tail.newline |= bit;
+            if (c == '\r') tail.carriage_return |= bit;
+            if (c == 0) tail.nul |= bit;
+            if (c >= 0x80) tail.high |= bit;
+        }
+        account(tail, bytes + i, size - i);
+    }
+
+    if (has_nul) {
+        format.encoding = sniff_utf16(bytes, size);
+        format.bom = false;
+        return format;
+    }
+
+    format.invalid_utf8 = utf8.invalid || (utf8.in_sequence() && !partial);
+    // Only when every line ends in CRLF; otherwise the '\r's stay in the text so
+    // a file with mixed endings saves back unchanged.
+    if (crlf > 0 && crlf == newlines) {
+        format.line_ending = LineEnding::CRLF;
+    }
+    return format;
+}
+
+std::string decode_utf16(const char* data, size_t size, bool big_endian, bool& lossy) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    size_t units = size / 2;
+    lossy = size % 2 != 0;
+    std::string out;
+    out.reserve(units);
+
+    auto unit_at = [&](size_t i) -> uint32_t {
+        return big_endian ? (bytes[2 * i] << 8) | bytes[2 * i + 1] : bytes[2 * i] | (bytes[2 * i + 1] << 8);
+    };
+
+    for (size_t i = 0; i < units; ++i) {
+        uint32_t unit = unit_at(i);
+        if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < units) {
+            uint32_t low = unit_at(i + 1);
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                put_utf8(out, 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+                i++;
+                continue;
+            }
+        }
+        if (unit >= 0xD800 && unit <= 0xDFFF) {
+            lossy = true;
+            unit = 0xFFFD;
+        }
+        put_utf8(out, unit);
+    }
+    return out;
+}
+
+void append_utf16(std::string& out, std::string_view utf8, bool big_endian) {
+    const auto* s = reinterpret_cast<const unsigned char*>(utf8.data());
+    size_t n = utf8.size();
+    size_t i = 0;
+    while (i < n) {
+        uint32_t cp = s[i];
+        size_t len = 1;
+        if (cp >= 0xF0 && i + 3 < n) {
+            cp = ((cp & 0x07) << 18) | ((s[i + 1] & 0x3F) << 12) | ((s[i + 2] & 0x3F) << 6) | (s[i + 3] & 0x3F);
+            len = 4;
+        } else if (cp >= 0xE0 && i + 2 < n) {
+            cp = ((cp & 0x0F) << 12) | ((s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F);
+            len = 3;
+        } else if (cp >= 0xC0 && i + 1 < n) {
+            cp = ((cp & 0x1F) << 6) | (s[i + 1] & 0x3F);
+            len = 2;
+        } else if (cp >= 0x80) {
+            cp = 0xFFFD;
+        }
+        i += len;
+
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            put_unit(out, static_cast<uint16_t>(0xD800 + (cp >> 10)), big_endian);
+            put_unit(out, static_cast<uint16_t>(0xDC00 + (cp & 0x3FF)), big_endian);
+        } else {
+            put_unit(out, static_cast<uint16_t>(cp), big_endian);
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+enum class TextEncoding {
+    Utf8,
+    Utf16LE,
+    Utf16BE,
+    Binary
+};
+
+enum class LineEnding {
+    LF,
+    CRLF
+};
+
+// How a file was stored on disk, so saving can write it back the same way.
+struct TextFormat {
+    TextEncoding encoding = TextEncoding::Utf8;
+    LineEnding line_ending = LineEnding::LF;
+    bool bom = false;
+    bool invalid_utf8 = false;
+    // Decoding replaced lone surrogates or dropped an odd trailing byte, or a
+    // streamed file sniffed as CRLF turned out to have bare LF lines, so the
+    // text cannot be written back as it was read.
+    bool lossy = false;
+
+    bool is_utf16() const { return encoding == TextEncoding::Utf16LE || encoding == TextEncoding::Utf16BE; }
+    size_t bom_size() const { return !bom ? 0 : is_utf16() ? 2 : 3; }
+    std::string_view line_separator() const { return line_ending == LineEnding::CRLF ? "\r\n" : "\n"; }
+    std::string describe() const;
+};
+
+// One pass over `data`: BOM, UTF-16 and NUL sniffing, CRLF versus LF and
+// UTF-8 validity. With `partial` set, a sequence cut off at the end of the
+// sample is not reported as invalid.
+TextFormat detect_text_format(const char* data, size_t size, bool partial = false);
+
+// Lone surrogates become U+FFFD and an odd trailing byte is dropped; `lossy` reports either.
+std::string decode_utf16(const char* data, size_t size, bool big_endian, bool& lossy);
+void append_utf16(std::string& out, std::string_view utf8, bool big_endian);
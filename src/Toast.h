@@ -23,6 +23,7 @@ struct Toast {
     Uint32 created_at;
     Uint32 delay_ms;
     int id;
+    float completion = -1.0f;
 
     bool is_expired(Uint32 now) const {
         return (now - created_at) >= delay_ms;
@@ -39,7 +40,7 @@ public:
     void set_layout(const Layout* l) { layout_ = l; }
     void set_font(TTF_Font* f) { font_ = f; }
 
-    void show(const std::string& title, const std::string& message, ToastType type, Uint32 delay_ms = 3000) {
+    int show(const std::string& title, const std::string& message, ToastType type, Uint32 delay_ms = 3000) {
         toasts_.push_back({
             .title = title,
             .message = message,
@@ -48,6 +49,29 @@ public:
             .delay_ms = delay_ms,
             .id = next_id_++
         });
+        return toasts_.back().id;
+    }
+
+    // A progress toast stays up as long as update_progress() keeps refreshing it.
+    int show_progress(const std::string& title, const std::string& message, Uint32 delay_ms = 2000) {
+        int id = show(title, message, ToastType::Info, delay_ms);
+        toasts_.back().completion = 0.0f;
+        return id;
+    }
+
+    void update_progress(int id, float completion, const std::string& message) {
+        for (auto& toast : toasts_) {
+            if (toast.id == id) {
+                toast.completion = std::clamp(completion, 0.0f, 1.0f);
+                toast.message = message;
+                toast.created_at = SDL_GetTicks();
+                return;
+            }
+        }
+    }
+
+    void dismiss(int id) {
+        std::erase_if(toasts_, [id](const Toast& t) { return t.id == id; });
     }
 
     void show_info(const std::string& title, const std::string& message, Uint32 delay_ms = 3000) {
@@ -103,7 +127,7 @@ public:
         return false;
     }
 
-    void render(SDL_Renderer* renderer, TextureCache& texture_cache,
+    void render(RenderQueue& queue, TextureCache& texture_cache,
                 int window_w, int window_h, int line_height) {
         if (toasts_.empty() || !layout_) return;
 
@@ -117,7 +141,7 @@ public:
             int toast_height = calculate_toast_height(toast);
             toast_y -= toast_height + TOAST_SPACING;
 
-            render_toast(renderer, texture_cache, toast,
+            render_toast(queue, texture_cache, toast,
                         window_w - toast_width - TOAST_MARGIN, toast_y,
                         toast_width, toast_height, now);
         }
@@ -125,6 +149,23 @@ public:
 
     bool empty() const { return toasts_.empty(); }
 
+    // Area covered by the toasts, empty when there are none.
+    SDL_Rect bounds(int window_w, int window_h) const {
+        SDL_Rect area = {0, 0, 0, 0};
+        if (toasts_.empty() || !layout_) return area;
+
+        int toast_y = window_h - layout_->status_bar_height - TOAST_MARGIN;
+        for (auto it = toasts_.rbegin(); it != toasts_.rend(); ++it) {
+            int toast_width = calculate_toast_width(*it);
+            int toast_height = calculate_toast_height(*it);
+            toast_y -= toast_height + TOAST_SPACING;
+
+            SDL_Rect rect = {window_w - toast_width - TOAST_MARGIN, toast_y, toast_width, toast_height};
+            SDL_UnionRect(&area, &rect, &area);
+        }
+        return area;
+    }
+
 private:
     static constexpr int TOAST_MIN_WIDTH = 280;
     static constexpr int TOAST_MAX_WIDTH = 500;
@@ -201,20 +242,20 @@ private:
         return "";
     }
 
-    void render_toast(SDL_Renderer* renderer, TextureCache& texture_cache,
+    void render_toast(RenderQueue& queue, TextureCache& texture_cache,
                       const Toast& toast, int x, int y, int w, int h, Uint32 now) {
-        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-        SDL_SetRenderDrawColor(renderer, Colors::TOAST_BG.r, Colors::TOAST_BG.g, Colors::TOAST_BG.b, Colors::TOAST_BG.a);
+        queue.set_blend_mode(SDL_BLENDMODE_BLEND);
+        queue.set_color(Colors::TOAST_BG.r, Colors::TOAST_BG.g, Colors::TOAST_BG.b, Colors::TOAST_BG.a);
         SDL_Rect bg = {x, y, w, h};
-        SDL_RenderFillRect(renderer, &bg);
+        queue.fill_rect(bg);
 
         SDL_Color indicator_color = get_indicator_color(toast.type);
-        SDL_SetRenderDrawColor(renderer, indicator_color.r, indicator_color.g, indicator_color.b, 255);
+        queue.set_color(indicator_color.r, indicator_color.g, indicator_color.b, 255);
         SDL_Rect indicator = {x, y, TOAST_INDICATOR_WIDTH, h - TOAST_PROGRESS_HEIGHT};
-        SDL_RenderFillRect(renderer, &indicator);
+        queue.fill_rect(indicator);
 
-        SDL_SetRenderDrawColor(renderer, Colors::TOAST_BORDER.r, Colors::TOAST_BORDER.g, Colors::TOAST_BORDER.b, 255);
-        SDL_RenderDrawRect(renderer, &bg);
+        queue.set_color(Colors::TOAST_BORDER.r, Colors::TOAST_BORDER.g, Colors::TOAST_BORDER.b, 255);
+        queue.draw_rect(bg);
 
         int content_height = h - TOAST_PADDING * 2 - TOAST_PROGRESS_HEIGHT;
         int text_block_height = 0;
@@ -241,15 +282,15 @@ private:
             texture_cache.render_cached_text(toast.message, Colors::TOAST_TEXT_DIM, text_x, content_y);
         }
 
-        float progress = 1.0f - toast.get_progress(now);
+        float progress = toast.completion >= 0.0f ? toast.completion : 1.0f - toast.get_progress(now);
         int progress_width = static_cast<int>(static_cast<float>(w) * progress);
 
-        SDL_SetRenderDrawColor(renderer, Colors::TOAST_PROGRESS_BG.r, Colors::TOAST_PROGRESS_BG.g, Colors::TOAST_PROGRESS_BG.b, 255);
+        queue.set_color(Colors::TOAST_PROGRESS_BG.r, Colors::TOAST_PROGRESS_BG.g, Colors::TOAST_PROGRESS_BG.b, 255);
         SDL_Rect progress_bg = {x, y + h - TOAST_PROGRESS_HEIGHT, w, TOAST_PROGRESS_HEIGHT};
-        SDL_RenderFillRect(renderer, &progress_bg);
+        queue.fill_rect(progress_bg);
 
-        SDL_SetRenderDrawColor(renderer, indicator_color.r, indicator_color.g, indicator_color.b, 180);
+        queue.set_color(indicator_color.r, indicator_color.g, indicator_color.b, 180);
         SDL_Rect progress_bar = {x, y + h - TOAST_PROGRESS_HEIGHT, progress_width, TOAST_PROGRESS_HEIGHT};
-        SDL_RenderFillRect(renderer, &progress_bar);
+        queue.fill_rect(progress_bar);
     }
 };
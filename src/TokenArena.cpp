@@ -0,0 +1,139 @@
+#include "TokenArena.h"
+#include <algorithm>
+
+template <typename Source>
+void TokenArena::remap_rows(size_t count, Source source) {
+    if (spare_rows.capacity() < count) growths++;
+    spare_rows.assign(count, Row{});
+
+    for (size_t i = 0; i < count; ++i) {
+        int64_t from = source(static_cast<int64_t>(i));
+        if (from < 0 || from >= static_cast<int64_t>(rows.size())) continue;
+        Row& row = rows[static_cast<size_t>(from)];
+        if (!row.valid) continue;
+        spare_rows[i] = row;
+        row.valid = false;
+    }
+    for (Row& row : rows) {
+        drop_row(row);
+    }
+    rows.swap(spare_rows);
+}
+
+void TokenArena::set_window(LineIdx first_line, size_t count) {
+    if (first_line == first && count == rows.size()) return;
+
+    int64_t delta = static_cast<int64_t>(first_line) - static_cast<int64_t>(first);
+    remap_rows(count, [delta](int64_t i) { return i + delta; });
+    first = first_line;
+}
+
+bool TokenArena::has_line(LineIdx line) const {
+    if (line < first || line >= end_line()) return false;
+    return rows[static_cast<size_t>(line - first)].valid;
+}
+
+std::span<const Token> TokenArena::line_tokens(LineIdx line) const {
+    if (!has_line(line)) return {};
+    const Row& row = rows[static_cast<size_t>(line - first)];
+    return {tokens.data() + row.offset, row.count};
+}
+
+uint64_t TokenArena::line_key(LineIdx line) const {
+    if (!has_line(line)) return 0;
+    return rows[static_cast<size_t>(line - first)].key;
+}
+
+void TokenArena::set_line_key(LineIdx line, uint64_t key) const {
+    if (!has_line(line)) return;
+    rows[static_cast<size_t>(line - first)].key = key;
+}
+
+void TokenArena::assign_line(LineIdx line, std::span<const Token> line_tokens) {
+    if (line < first || line >= end_line()) return;
+
+    Row& row = rows[static_cast<size_t>(line - first)];
+    drop_row(row);
+    if (dead > tokens.size() / 2) {
+        compact();
+    }
+
+    if (tokens.size() + line_tokens.size() > tokens.capacity()) growths++;
+    row.offset = static_cast<uint32_t>(tokens.size());
+    row.count = static_cast<uint32_t>(line_tokens.size());
+    row.valid = true;
+    tokens.insert(tokens.end(), line_tokens.begin(), line_tokens.end());
+}
+
+void TokenArena::mark_provisional(LineIdx begin, LineIdx end) {
+    begin = std::max(begin, first);
+    end = std::min(end, end_line());
+    for (LineIdx line = begin; line < end; ++line) {
+        Row& row = rows[static_cast<size_t>(line - first)];
+        row.provisional = row.valid;
+    }
+}
+
+void TokenArena::shift_for_edit(size_t start_row, size_t old_end_row, size_t new_end_row) {
+    auto start = static_cast<int64_t>(start_row);
+    if (rows.empty() || start >= static_cast<int64_t>(end_line())) return;
+
+    if (old_end_row == new_end_row) {
+        invalidate(start_row, new_end_row);
+        return;
+    }
+
+    auto base = static_cast<int64_t>(first);
+    auto old_end = static_cast<int64_t>(old_end_row);
+    auto new_end = static_cast<int64_t>(new_end_row);
+    remap_rows(rows.size(), [=](int64_t i) -> int64_t {
+        int64_t line = base + i;
+        if (line < start) return i;
+        if (line <= new_end) return -1;
+        return line - new_end + old_end - base;
+    });
+}
+
+void TokenArena::invalidate(size_t first_row, size_t last_row) {
+    if (rows.empty()) return;
+    auto begin = std::max(static_cast<int64_t>(first_row), static_cast<int64_t>(first));
+    auto end = std::min(static_cast<int64_t>(last_row) + 1, static_cast<int64_t>(end_line()));
+    for (int64_t line = begin; line < end; ++line) {
+        drop_row(rows[static_cast<size_t>(line - first)]);
+    }
+}
+
+void TokenArena::drop_provisional() {
+    for (Row& row : rows) {
+        if (row.provisional) drop_row(row);
+    }
+}
+
+void TokenArena::clear() {
+    first = 0;
+    rows.clear();
+    tokens.clear();
+    dead = 0;
+}
+
+void TokenArena::drop_row(Row& row) {
+    if (row.valid) {
+        dead += row.count;
+    }
+    row = Row{};
+}
+
+void TokenArena::compact() {
+    size_t live = tokens.size() - dead;
+    if (spare_tokens.capacity() < live) growths++;
+    spare_tokens.clear();
+
+    for (Row& row : rows) {
+        if (!row.valid) continue;
+        auto begin = tokens.begin() + row.offset;
+        row.offset = static_cast<uint32_t>(spare_tokens.size());
+        spare_tokens.insert(spare_tokens.end(), begin, begin + row.count);
+    }
+    tokens.swap(spare_tokens);
+    dead = 0;
+}
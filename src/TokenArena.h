@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Types.h"
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Syntax tokens for a window of consecutive lines, packed into one array that
+// is reused from frame to frame. Rewriting a line appends its tokens and leaves
+// the old ones dead until they make up half the array, when the live rows are
+// compacted into a spare buffer. Once the buffers have grown to the working
+// size, refilling rows allocates nothing.
+class TokenArena {
+public:
+    // Moves the window to [first_line, first_line + count); lines that stay
+    // inside keep their tokens.
+    void set_window(LineIdx first_line, size_t count);
+
+    LineIdx first_line() const { return first; }
+    LineIdx end_line() const { return first + static_cast<LineIdx>(rows.size()); }
+
+    bool has_line(LineIdx line) const;
+    std::span<const Token> line_tokens(LineIdx line) const;
+
+    // Ignored for lines outside the window.
+    void assign_line(LineIdx line, std::span<const Token> line_tokens);
+    // A key kept with the line's tokens and dropped along with them, so a
+    // value derived from the line is computed again only after an edit or
+    // reparse touches it. 0 until set; setting it is ignored for missing lines.
+    uint64_t line_key(LineIdx line) const;
+    void set_line_key(LineIdx line, uint64_t key) const;
+    void mark_provisional(LineIdx begin, LineIdx end);
+
+    // An edit replaced rows [start_row, old_end_row] with [start_row, new_end_row].
+    void shift_for_edit(size_t start_row, size_t old_end_row, size_t new_end_row);
+    void invalidate(size_t first_row, size_t last_row);
+    void drop_provisional();
+    void clear();
+
+    // Times a buffer had to grow; stays flat while editing and scrolling in steady state.
+    size_t growth_count() const { return growths; }
+
+private:
+    struct Row {
+        uint32_t offset = 0;
+        uint32_t count = 0;
+        mutable uint64_t key = 0;
+        bool valid = false;
+        bool provisional = false;
+    };
+
+    LineIdx first = 0;
+    std::vector<Row> rows;
+    std::vector<Row> spare_rows;
+    std::vector<Token> tokens;
+    std::vector<Token> spare_tokens;
+    size_t dead = 0;
+    size_t growths = 0;
+
+    // Rebuilds rows so that new row i holds what old row source(i) held, or nothing.
+    template <typename Source>
+    void remap_rows(size_t count, Source source);
+    void drop_row(Row& row);
+    void compact();
+};
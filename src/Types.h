@@ -5,7 +5,7 @@
 
 using LineIdx = int32_t;
 using ColIdx = int32_t;
-using ByteOff = uint32_t;
+using ByteOff = uint64_t;
 
 struct TextPos {
     LineIdx line = 0;
@@ -0,0 +1,288 @@
+#include "UndoJournal.h"
+#include "Utils.h"
+#include <cstring>
+#include <format>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr char JOURNAL_MAGIC[4] = {'D', 'E', 'U', 'J'};
+constexpr uint32_t JOURNAL_VERSION = 1;
+
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+uint64_t fnv1a(std::string_view bytes, uint64_t hash = FNV_OFFSET) {
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Journals hold the text of every edit, deleted text included, so only the owner may read them.
+FILE* open_private(const std::filesystem::path& path, int flags, const char* mode) {
+    int fd = ::open(path.c_str(), flags | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return nullptr;
+    // O_CREAT leaves the mode of an existing file alone.
+    fchmod(fd, 0600);
+    FILE* file = fdopen(fd, mode);
+    if (!file) ::close(fd);
+    return file;
+}
+
+template <typename T>
+void put(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+void put_text(std::string& out, const std::string& text) {
+    put<uint32_t>(out, static_cast<uint32_t>(text.size()));
+    out += text;
+}
+
+void put_action(std::string& out, const EditAction& action) {
+    put<uint8_t>(out, static_cast<uint8_t>(action.index()));
+    put<uint64_t>(out, get_action_group_id(action));
+
+    if (const auto* op = std::get_if<InsertOp>(&action)) {
+        put<int32_t>(out, op->line);
+        put<int32_t>(out, op->col);
+        put<int32_t>(out, op->end_line);
+        put<int32_t>(out, op->end_col);
+        put_text(out, op->text);
+    } else if (const auto* op = std::get_if<DeleteOp>(&action)) {
+        put<int32_t>(out, op->line);
+        put<int32_t>(out, op->col);
+        put<int32_t>(out, op->end_line);
+        put<int32_t>(out, op->end_col);
+        put_text(out, op->deleted_text);
+    } else if (const auto* op = std::get_if<MoveLineOp>(&action)) {
+        put<int32_t>(out, op->block_start);
+        put<int32_t>(out, op->block_end);
+        put<int32_t>(out, op->direction);
+    }
+}
+
+// Reads values off the front of a byte range; any short read leaves ok false.
+struct Reader {
+    const char* ptr;
+    const char* end;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (static_cast<size_t>(end - ptr) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return value;
+    }
+
+    std::string get_text() {
+        uint32_t len = get<uint32_t>();
+        if (!ok || static_cast<size_t>(end - ptr) < len) {
+            ok = false;
+            return {};
+        }
+        std::string text(ptr, len);
+        ptr += len;
+        return text;
+    }
+
+    EditAction get_action() {
+        uint8_t type = get<uint8_t>();
+        uint64_t group = get<uint64_t>();
+        switch (type) {
+            case 0: {
+                InsertOp op{};
+                op.line = get<int32_t>();
+                op.col = get<int32_t>();
+                op.end_line = get<int32_t>();
+                op.end_col = get<int32_t>();
+                op.text = get_text();
+                op.group_id = group;
+                return op;
+            }
+            case 1: {
+                DeleteOp op{};
+                op.line = get<int32_t>();
+                op.col = get<int32_t>();
+                op.end_line = get<int32_t>();
+                op.end_col = get<int32_t>();
+                op.deleted_text = get_text();
+                op.group_id = group;
+                return op;
+            }
+            case 2: {
+                MoveLineOp op{};
+                op.block_start = get<int32_t>();
+                op.block_end = get<int32_t>();
+                op.direction = get<int32_t>();
+                op.group_id = group;
+                return op;
+            }
+            default:
+                ok = false;
+                return {};
+        }
+    }
+};
+}
+
+std::filesystem::path UndoJournal::path_for(const std::string& file_path) {
+    if (file_path.empty()) return {};
+    std::string dir = get_cache_dir("undo");
+    if (dir.empty()) return {};
+
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(file_path, ec);
+    std::string key = ec ? file_path : absolute.lexically_normal().string();
+    return std::filesystem::path(dir) / std::format("{:016x}.undo", fnv1a(key));
+}
+
+uint64_t UndoJournal::content_hash(const LineStore& lines) {
+    uint64_t hash = FNV_OFFSET;
+    bool first = true;
+    lines.for_each_view([&](std::string_view line) {
+        if (!first) hash = fnv1a("\n", hash);
+        hash = fnv1a(line, hash);
+        first = false;
+    });
+    return hash;
+}
+
+std::future<uint64_t> UndoJournal::content_hash_async(LineStore lines) {
+    std::promise<uint64_t> promise;
+    std::future<uint64_t> hash = promise.get_future();
+    std::thread([lines = std::move(lines), promise = std::move(promise)]() mutable {
+        promise.set_value(content_hash(lines));
+    }).detach();
+    return hash;
+}
+
+std::vector<UndoJournal::Record> UndoJournal::read(const std::filesystem::path& path) {
+    std::vector<Record> records;
+    FilePtr in(fopen(path.string().c_str(), "rb"));
+    if (!in) return records;
+
+    std::string data;
+    char chunk[1 << 16];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in.get())) > 0) {
+        data.append(chunk, n);
+    }
+
+    Reader reader{data.data(), data.data() + data.size()};
+    char magic[4];
+    for (char& c : magic) c = reader.get<char>();
+    uint32_t version = reader.get<uint32_t>();
+    if (!reader.ok || std::memcmp(magic, JOURNAL_MAGIC, 4) != 0 || version != JOURNAL_VERSION) {
+        return records;
+    }
+
+    // A record cut short by a crash ends the journal; everything before it is kept.
+    while (reader.ptr < reader.end) {
+        Record record{};
+        record.kind = static_cast<RecordKind>(reader.get<uint8_t>());
+        switch (record.kind) {
+            case RecordKind::Push:
+                record.extend_run = reader.get<uint8_t>() != 0;
+                record.action = reader.get_action();
+                break;
+            case RecordKind::Restore:
+            case RecordKind::RestoreRedo:
+                record.action = reader.get_action();
+                break;
+            case RecordKind::Checkpoint:
+                record.hash = reader.get<uint64_t>();
+                break;
+            case RecordKind::Undo:
+            case RecordKind::Redo:
+                break;
+            default:
+                reader.ok = false;
+                break;
+        }
+        if (!reader.ok) break;
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+bool UndoJournal::rewrite(const std::filesystem::path& path, const std::deque<EditAction>& undo,
+                          const std::deque<EditAction>& redo, uint64_t hash) {
+    file.reset();
+    file_path = path;
+    buffer.clear();
+
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    FilePtr out(open_private(temp, O_WRONLY | O_TRUNC, "wb"));
+    if (!out) return false;
+
+    buffer.append(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    put<uint32_t>(buffer, JOURNAL_VERSION);
+    for (const auto& action : undo) {
+        put<uint8_t>(buffer, static_cast<uint8_t>(RecordKind::Restore));
+        put_action(buffer, action);
+    }
+    for (const auto& action : redo) {
+        put<uint8_t>(buffer, static_cast<uint8_t>(RecordKind::RestoreRedo));
+        put_action(buffer, action);
+    }
+    put<uint8_t>(buffer, static_cast<uint8_t>(RecordKind::Checkpoint));
+    put<uint64_t>(buffer, hash);
+
+    bool written = fwrite(buffer.data(), 1, buffer.size(), out.get()) == buffer.size();
+    written = fclose(out.release()) == 0 && written;
+    written_bytes = buffer.size();
+    buffer.clear();
+
+    std::error_code ec;
+    if (written) {
+        std::filesystem::rename(temp, path, ec);
+    }
+    if (!written || ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+
+    file.reset(open_private(path, O_WRONLY | O_APPEND, "ab"));
+    return file != nullptr;
+}
+
+void UndoJournal::append_push(const EditAction& action, bool extend_run) {
+    put<uint8_t>(buffer, static_cast<uint8_t>(RecordKind::Push));
+    put<uint8_t>(buffer, extend_run ? 1 : 0);
+    put_action(buffer, action);
+    if (buffer.size() >= WRITE_BATCH_BYTES) write_buffer();
+}
+
+void UndoJournal::append_marker(RecordKind kind) {
+    put<uint8_t>(buffer, static_cast<uint8_t>(kind));
+    if (buffer.size() >= WRITE_BATCH_BYTES) write_buffer();
+}
+
+void UndoJournal::append_checkpoint(uint64_t hash) {
+    put<uint8_t>(buffer, static_cast<uint8_t>(RecordKind::Checkpoint));
+    put<uint64_t>(buffer, hash);
+    write_buffer();
+    if (file) fflush(file.get());
+}
+
+void UndoJournal::write_buffer() {
+    if (file && !buffer.empty()) {
+        fwrite(buffer.data(), 1, buffer.size(), file.get());
+    }
+    written_bytes += buffer.size();
+    buffer.clear();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CommandManager.h"
+#include "HandleTypes.h"
+#include "LineStore.h"
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Append-only log of the operations applied to a CommandManager. Replaying
+// the records rebuilds its undo and redo stacks; checkpoints carry the hash
+// of the document content at points where it matched the file on disk, so a
+// reopened file only picks up history that leads to what is on disk.
+//
+// Records after the last checkpoint are only useful once another checkpoint
+// follows them, so appends are buffered in memory and reach the file in
+// batches, with a flush only at each checkpoint.
+class UndoJournal {
+public:
+    static constexpr size_t WRITE_BATCH_BYTES = size_t{64} << 10;
+    enum class RecordKind : uint8_t {
+        Push = 1,
+        Undo,
+        Redo,
+        Restore,
+        RestoreRedo,
+        Checkpoint
+    };
+
+    struct Record {
+        RecordKind kind;
+        bool extend_run = false;
+        uint64_t hash = 0;
+        EditAction action;
+    };
+
+    static std::filesystem::path path_for(const std::string& file_path);
+    static uint64_t content_hash(const LineStore& lines);
+    // Hashes a snapshot of lines on a worker thread.
+    static std::future<uint64_t> content_hash_async(LineStore lines);
+    static std::vector<Record> read(const std::filesystem::path& path);
+
+    // Replaces the journal at path with the given stacks and a checkpoint,
+    // then keeps it open for appending.
+    bool rewrite(const std::filesystem::path& path, const std::deque<EditAction>& undo,
+                 const std::deque<EditAction>& redo, uint64_t hash);
+
+    void append_push(const EditAction& action, bool extend_run);
+    void append_marker(RecordKind kind);
+    void append_checkpoint(uint64_t hash);
+
+    const std::filesystem::path& path() const { return file_path; }
+    // Bytes in the journal, counting records not yet written.
+    size_t size() const { return written_bytes + buffer.size(); }
+
+private:
+    FilePtr file;
+    std::filesystem::path file_path;
+    std::string buffer;
+    size_t written_bytes = 0;
+
+    void write_buffer();
+};
@@ -4,6 +4,7 @@
 #include <cctype>
 #include <algorithm>
 #include <sys/stat.h>
+#include <cerrno>
 #include <filesystem>
 #include <SDL2/SDL.h>
 #include "Types.h"
@@ -152,7 +153,7 @@ int utf8_char_len(unsigned char c) {
     return 1;
 }
 
-ColIdx utf8_prev_char_start(const std::string& str, ColIdx pos) {
+ColIdx utf8_prev_char_start(std::string_view str, ColIdx pos) {
     if (pos <= 0) return 0;
     pos--;
     while (pos > 0 && (str[pos] & 0xC0) == 0x80) {
@@ -161,13 +162,13 @@ ColIdx utf8_prev_char_start(const std::string& str, ColIdx pos) {
     return pos;
 }
 
-ColIdx utf8_next_char_pos(const std::string& str, ColIdx pos) {
+ColIdx utf8_next_char_pos(std::string_view str, ColIdx pos) {
     if (pos >= static_cast<ColIdx>(str.size())) return static_cast<ColIdx>(str.size());
     int len = utf8_char_len(static_cast<unsigned char>(str[pos]));
     return std::min(pos + len, static_cast<ColIdx>(str.size()));
 }
 
-ColIdx utf8_clamp_to_char_boundary(const std::string& str, ColIdx pos) {
+ColIdx utf8_clamp_to_char_boundary(std::string_view str, ColIdx pos) {
     int len = static_cast<int>(str.size());
     if (pos >= len) return len;
     while (pos > 0 && (str[pos] & 0xC0) == 0x80) {
@@ -176,7 +177,7 @@ ColIdx utf8_clamp_to_char_boundary(const std::string& str, ColIdx pos) {
     return pos;
 }
 
-uint32_t utf8_decode_at(const std::string& str, ColIdx pos) {
+uint32_t utf8_decode_at(std::string_view str, ColIdx pos) {
     if (pos < 0 || pos >= static_cast<ColIdx>(str.size())) return 0;
     unsigned char c = static_cast<unsigned char>(str[pos]);
 
@@ -299,6 +300,54 @@ std::string get_config_path(const std::string& filename) {
     return config_dir + "/" + filename;
 }
 
+std::string get_cache_dir(const std::string& subdir) {
+    std::string cache_dir;
+
+#ifdef __APPLE__
+    const char* home = getenv("HOME");
+    if (home) {
+        cache_dir = std::string(home) + "/Library/Caches/DeadEditor";
+    }
+#elif defined(__linux__)
+    const char* xdg_cache = getenv("XDG_CACHE_HOME");
+    if (xdg_cache && xdg_cache[0]) {
+        cache_dir = std::string(xdg_cache) + "/DeadEditor";
+    } else {
+        const char* home = getenv("HOME");
+        if (home) {
+            cache_dir = std::string(home) + "/.cache/DeadEditor";
+        }
+    }
+#else
+    const char* local_appdata = getenv("LOCALAPPDATA");
+    if (local_appdata) {
+        cache_dir = std::string(local_appdata) + "/DeadEditor";
+    }
+#endif
+
+    if (cache_dir.empty()) {
+        return {};
+    }
+
+#ifdef _WIN32
+    cache_dir += "/" + subdir;
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+    return ec ? std::string{} : cache_dir;
+#else
+    // Caches can hold document contents, so both levels are private to the
+    // owner, including ones an older version created with default permissions.
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cache_dir).parent_path(), ec);
+    std::string subdir_path = cache_dir + "/" + subdir;
+    for (const std::string& dir : {cache_dir, subdir_path}) {
+        if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) return {};
+        if (chmod(dir.c_str(), 0700) != 0) return {};
+    }
+    return subdir_path;
+#endif
+}
+
 void open_containing_folder(const std::string& path) {
     std::filesystem::path fs_path(path);
     std::string folder = fs_path.parent_path().string();
@@ -316,7 +365,7 @@ void open_containing_folder(const std::string& path) {
     system(cmd.c_str());
 }
 
-std::string expand_tabs(const std::string& text, int tab_width) {
+std::string expand_tabs(std::string_view text, int tab_width) {
     std::string result;
     result.reserve(text.size());
     int column = 0;
@@ -333,7 +382,7 @@ std::string expand_tabs(const std::string& text, int tab_width) {
     return result;
 }
 
-int expanded_column(const std::string& text, int byte_pos, int tab_width) {
+int expanded_column(std::string_view text, int byte_pos, int tab_width) {
     int column = 0;
     int len = std::min(byte_pos, static_cast<int>(text.size()));
     for (int i = 0; i < len; i++) {
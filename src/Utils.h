@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <sys/stat.h>
 #include <cstdint>
+#include <string_view>
 #include <SDL2/SDL.h>
 #include "Types.h"
 
@@ -21,14 +22,15 @@ std::string show_open_folder_dialog();
 FileLocation parse_file_argument(const char* arg);
 void parse_goto_input(const std::string& input, LineIdx& line, ColIdx& col);
 int utf8_char_len(unsigned char c);
-ColIdx utf8_prev_char_start(const std::string& str, ColIdx pos);
-ColIdx utf8_next_char_pos(const std::string& str, ColIdx pos);
-ColIdx utf8_clamp_to_char_boundary(const std::string& str, ColIdx pos);
-uint32_t utf8_decode_at(const std::string& str, ColIdx pos);
+ColIdx utf8_prev_char_start(std::string_view str, ColIdx pos);
+ColIdx utf8_next_char_pos(std::string_view str, ColIdx pos);
+ColIdx utf8_clamp_to_char_boundary(std::string_view str, ColIdx pos);
+uint32_t utf8_decode_at(std::string_view str, ColIdx pos);
 bool is_word_codepoint(uint32_t cp);
-std::string expand_tabs(const std::string& text, int tab_width = 4);
-int expanded_column(const std::string& text, int byte_pos, int tab_width = 4);
+std::string expand_tabs(std::string_view text, int tab_width = 4);
+int expanded_column(std::string_view text, int byte_pos, int tab_width = 4);
 bool is_directory(const char* path);
 std::string get_resource_path(const std::string& filename);
 std::string get_config_path(const std::string& filename);
+std::string get_cache_dir(const std::string& subdir);
 void open_containing_folder(const std::string& path);
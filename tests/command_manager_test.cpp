@@ -0,0 +1,177 @@
+// Pushes typing runs through CommandManager and checks which actions are
+// folded into one record, and that undo and redo of the merged records
+// restore the text. A run must never absorb an action from another group.
+
+#include "CommandManager.h"
+#include "EditorController.h"
+#include "TextDocument.h"
+#include <cstdio>
+#include <string>
+
+namespace {
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+struct Session {
+    TextDocument doc;
+    EditorController ctrl;
+    uint64_t next_group = 1;
+
+    CommandManager& history() { return ctrl.command_manager; }
+
+    std::string text() const {
+        std::string out;
+        for (size_t i = 0; i < doc.lines.size(); ++i) {
+            if (i > 0) out += '\n';
+            out += doc.lines.view(i);
+        }
+        return out;
+    }
+
+    // Inserts at the cursor; a keystroke gets a group of its own and extends the run.
+    void insert(const std::string& text, uint64_t group, bool keystroke) {
+        InsertOp op{ctrl.cursor_line, ctrl.cursor_col, text, 0, 0, group};
+        apply_action(op, doc, ctrl);
+        history().push(std::move(op), keystroke);
+    }
+
+    void type(const std::string& text) {
+        for (char ch : text) insert(std::string(1, ch), next_group++, true);
+    }
+
+    void backspace(int count) {
+        for (int i = 0; i < count; ++i) {
+            DeleteOp op{ctrl.cursor_line, ctrl.cursor_col - 1, "", ctrl.cursor_line, ctrl.cursor_col, next_group++};
+            apply_action(op, doc, ctrl);
+            history().push(std::move(op), true);
+        }
+    }
+
+    // Mirrors EditorController::undo and redo, which also need a view.
+    void undo() {
+        auto& from = history().get_undo_stack();
+        auto& to = history().get_redo_stack();
+        if (from.empty()) return;
+        uint64_t group = get_action_group_id(from.back());
+        while (!from.empty() && get_action_group_id(from.back()) == group) {
+            std::visit([this](auto& op) { revert_action(op, doc, ctrl); }, from.back());
+            to.push_back(std::move(from.back()));
+            from.pop_back();
+        }
+        history().note_undo();
+    }
+
+    void redo() {
+        auto& from = history().get_redo_stack();
+        auto& to = history().get_undo_stack();
+        if (from.empty()) return;
+        uint64_t group = get_action_group_id(from.back());
+        while (!from.empty() && get_action_group_id(from.back()) == group) {
+            std::visit([this](auto& op) { apply_action(op, doc, ctrl); }, from.back());
+            to.push_back(std::move(from.back()));
+            from.pop_back();
+        }
+        history().note_redo();
+    }
+
+    size_t records() { return history().get_undo_stack().size(); }
+};
+
+void test_typing_run() {
+    Session s;
+    s.type("hello");
+    check(s.records() == 1, "typing run: one record");
+    check(s.text() == "hello", "typing run: text");
+    s.undo();
+    check(s.text() == "", "typing run: undo removes the run");
+    s.redo();
+    check(s.text() == "hello", "typing run: redo restores the run");
+    check(s.records() == 1, "typing run: redo keeps one record");
+}
+
+void test_word_boundary() {
+    Session s;
+    s.type("ab cd");
+    check(s.records() == 2, "word boundary: run split after the space");
+    s.undo();
+    check(s.text() == "ab ", "word boundary: undo removes the last word");
+    s.undo();
+    check(s.text() == "", "word boundary: undo removes the first word");
+}
+
+void test_backspace_run() {
+    Session s;
+    s.type("hello");
+    s.backspace(3);
+    check(s.records() == 2, "backspace run: one delete record");
+    check(s.text() == "he", "backspace run: text");
+    s.undo();
+    check(s.text() == "hello", "backspace run: undo restores the deleted run");
+    s.redo();
+    check(s.text() == "he", "backspace run: redo deletes it again");
+}
+
+void test_same_group_merges() {
+    Session s;
+    s.insert("ab", 7, false);
+    s.insert("cd", 7, false);
+    check(s.records() == 1, "same group: adjacent inserts merge");
+    s.undo();
+    check(s.text() == "", "same group: undo removes both");
+}
+
+void test_run_after_group() {
+    Session s;
+    s.insert("abc", s.next_group++, false);
+    s.type("d");
+    check(s.records() == 2, "run after group: keystroke not merged into the group");
+    s.undo();
+    check(s.text() == "abc", "run after group: undo removes only the keystroke");
+    s.undo();
+    check(s.text() == "", "run after group: undo removes the group");
+}
+
+void test_group_after_run() {
+    Session s;
+    s.type("xy");
+    s.insert("z", s.next_group++, false);
+    check(s.records() == 2, "group after run: action not merged into the run");
+    s.undo();
+    check(s.text() == "xy", "group after run: undo removes only the group");
+    s.undo();
+    check(s.text() == "", "group after run: undo removes the run");
+}
+
+void test_run_after_undo() {
+    Session s;
+    s.type("ab");
+    s.insert("x", s.next_group++, false);
+    s.type("cd");
+    s.undo();
+    s.type("e");
+    check(s.records() == 3, "run after undo: keystroke starts a new record");
+    s.undo();
+    check(s.text() == "abx", "run after undo: undo removes only the new keystroke");
+    s.undo();
+    check(s.text() == "ab", "run after undo: undo removes the group");
+}
+}
+
+int main() {
+    test_typing_run();
+    test_word_boundary();
+    test_backspace_run();
+    test_same_group_merges();
+    test_run_after_group();
+    test_group_after_run();
+    test_run_after_undo();
+
+    if (failures == 0) std::printf("command_manager_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Shifts cached highlight blocks through inserts and deletes above, inside,
+// across and below them, and checks that every row left in the cache holds
+// the tokens of the line that now sits there.
+
+#include "HighlightCache.h"
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+
+namespace {
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+constexpr LineIdx LINE_COUNT = HighlightCache::BLOCK_LINES * 4;
+
+// Each line's single token records the line it was queried for.
+Token line_token(LineIdx line) {
+    return {TokenType::Default, static_cast<ColIdx>(line), static_cast<ColIdx>(line + 1)};
+}
+
+void fill(HighlightCache& cache, std::initializer_list<LineIdx> blocks) {
+    for (LineIdx index : blocks) {
+        TokenArena& tokens = cache.block(index, LINE_COUNT);
+        for (LineIdx line = tokens.first_line(); line < tokens.end_line(); ++line) {
+            Token token = line_token(line);
+            tokens.assign_line(line, {&token, 1});
+        }
+    }
+}
+
+bool cached(std::initializer_list<LineIdx> blocks, LineIdx line) {
+    if (line < 0 || line >= LINE_COUNT) return false;
+    for (LineIdx index : blocks) {
+        if (line / HighlightCache::BLOCK_LINES == index) return true;
+    }
+    return false;
+}
+
+// Replaces rows [start, old_end] with [start, new_end] in a cache holding
+// blocks, then compares every row with the line it came from. Rows the edit
+// rewrote must be gone; shifted rows must survive whenever both the block
+// they left and the block they moved to are cached.
+void run_case(const char* name, std::initializer_list<LineIdx> blocks,
+              LineIdx start, LineIdx old_end, LineIdx new_end) {
+    HighlightCache cache;
+    fill(cache, blocks);
+    cache.shift_for_edit(static_cast<size_t>(start), static_cast<size_t>(old_end), static_cast<size_t>(new_end));
+
+    int wrong = 0;
+    int missing = 0;
+    int stale = 0;
+    for (LineIdx index : blocks) {
+        TokenArena* tokens = cache.peek(index);
+        if (!tokens) {
+            missing += HighlightCache::BLOCK_LINES;
+            continue;
+        }
+        for (LineIdx line = tokens->first_line(); line < tokens->end_line(); ++line) {
+            bool edited = line >= start && line <= new_end;
+            LineIdx source = line < start ? line : line - new_end + old_end;
+            bool expected = !edited && cached(blocks, source);
+            bool present = tokens->has_line(line);
+            if (present && edited) {
+                stale++;
+            } else if (present) {
+                auto found = tokens->line_tokens(line);
+                if (found.size() != 1 || !(found[0] == line_token(source))) wrong++;
+            } else if (expected) {
+                missing++;
+            }
+        }
+    }
+    check(cache.size() == blocks.size(), std::string(name) + ": blocks kept");
+    check(wrong == 0, std::string(name) + ": rows hold the tokens of their line (" + std::to_string(wrong) + " wrong)");
+    check(stale == 0, std::string(name) + ": edited rows dropped (" + std::to_string(stale) + " kept)");
+    check(missing == 0, std::string(name) + ": shifted rows kept (" + std::to_string(missing) + " missing)");
+}
+}
+
+int main() {
+    constexpr LineIdx B = HighlightCache::BLOCK_LINES;
+
+    // Edits in a line, with no rows added or removed.
+    run_case("edit inside", {0, 1, 3}, B + 10, B + 10, B + 10);
+    run_case("edit across blocks", {0, 1, 3}, B - 2, B + 3, B + 3);
+
+    // Inserts shift everything below them down, across block boundaries.
+    run_case("insert above", {1, 2, 3}, 10, 10, 15);
+    run_case("insert inside", {0, 1, 2, 3}, B + 10, B + 10, B + 13);
+    run_case("insert at block end", {0, 1, 2}, B - 1, B - 1, B + 1);
+    run_case("insert next to uncached block", {0, 1, 3}, B + 100, B + 100, B + 400);
+    run_case("insert below", {0, 1}, 3 * B + 5, 3 * B + 5, 3 * B + 9);
+    run_case("insert more than a block", {0, 1, 2, 3}, 5, 5, 5 + B + 30);
+
+    // Deletes shift everything below them up, across block boundaries.
+    run_case("delete above", {1, 2, 3}, 10, 15, 10);
+    run_case("delete inside", {0, 1, 2, 3}, B + 10, B + 13, B + 10);
+    run_case("delete across blocks", {0, 1, 2, 3}, B - 3, B + 4, B - 3);
+    run_case("delete next to uncached block", {0, 1, 3}, B + 100, B + 400, B + 100);
+    run_case("delete below", {0, 1}, 3 * B + 5, 3 * B + 9, 3 * B + 5);
+    run_case("delete more than a block", {0, 1, 2, 3}, 5, 5 + B + 30, 5);
+
+    // A replacement with a different line count.
+    run_case("replace and grow", {0, 1, 2, 3}, B - 5, B + 5, B + 20);
+    run_case("replace and shrink", {0, 1, 2, 3}, B - 5, B + 20, B + 5);
+
+    if (failures == 0) std::printf("highlight_cache_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+// Opens a sparse file past 4 GiB whose middle is a single line longer than
+// 4 GiB, and checks line indexing, byte offsets, an edit beyond 2^32 and
+// saving that edit back to disk. Also round-trips files that mix CRLF and LF
+// endings, loaded whole and streamed.
+
+#include "TextDocument.h"
+#include <fcntl.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+constexpr ByteOff FILE_SIZE = ByteOff{5} << 30;
+constexpr size_t HEAD_LINES = 65536;
+constexpr size_t TAIL_LINES = 100;
+
+std::string numbered_line(const char* prefix, size_t i) {
+    // Fixed width, so every line is 32 bytes with its newline.
+    char line[64];
+    std::snprintf(line, sizeof(line), "%s %026zu\n", prefix, i);
+    return line;
+}
+
+void write_file(const std::filesystem::path& path, const std::string& bytes) {
+    std::ofstream(path, std::ios::binary) << bytes;
+}
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void load_fully(TextDocument& doc, const std::filesystem::path& path) {
+    check(doc.load(path).has_value(), "load " + path.filename().string());
+    while (doc.is_loading()) {
+        doc.poll_loading();
+    }
+}
+
+// Saves `doc` next to `path` and checks the copy is byte for byte the original.
+void check_round_trip(TextDocument& doc, const std::filesystem::path& path) {
+    std::filesystem::path copy = path;
+    copy += ".saved";
+    auto saved = doc.save_as(copy);
+    check(saved.has_value(), "save " + path.filename().string());
+    check(read_file(copy) == read_file(path), path.filename().string() + " saves back unchanged");
+}
+
+void test_mixed_line_endings(const std::filesystem::path& dir) {
+    // Endings are kept per line: only a file that is CRLF throughout drops its '\r's.
+    std::filesystem::path mixed = dir / "mixed.txt";
+    write_file(mixed, "one\r\ntwo\nthree\r\n\rfour\r");
+    {
+        TextDocument doc;
+        load_fully(doc, mixed);
+        check(doc.format.line_ending == LineEnding::LF && !doc.readonly, "mixed endings load as editable LF");
+        check(doc.line_count() == 4 && doc.get_line(0) == "one\r" && doc.get_line(1) == "two" &&
+              doc.get_line(3) == "\rfour\r",
+              "mixed endings keep their carriage returns");
+        check_round_trip(doc, mixed);
+    }
+
+    std::filesystem::path crlf = dir / "crlf.txt";
+    write_file(crlf, "one\r\ntwo\r\nthree\r");
+    {
+        TextDocument doc;
+        load_fully(doc, crlf);
+        check(doc.format.line_ending == LineEnding::CRLF, "CRLF file");
+        check(doc.get_line(0) == "one" && doc.get_line(2) == "three\r", "a '\\r' without '\\n' at EOF is kept");
+        check_round_trip(doc, crlf);
+    }
+
+    // Streamed files are sniffed on their first screen, so a bare LF further on
+    // is only found once the background scan reaches it.
+    std::string lines;
+    for (size_t i = 0; lines.size() < TextDocument::STREAMING_LOAD_MIN_BYTES; ++i) {
+        std::string line = numbered_line("line", i);
+        line.insert(line.size() - 1, "\r");
+        lines += line;
+    }
+    std::filesystem::path streamed = dir / "streamed_crlf.txt";
+    write_file(streamed, lines + "end\r");
+    {
+        TextDocument doc;
+        load_fully(doc, streamed);
+        check(doc.format.line_ending == LineEnding::CRLF && !doc.format.lossy && !doc.readonly,
+              "streamed CRLF file stays editable");
+        check(doc.get_line(static_cast<LineIdx>(doc.line_count() - 1)) == "end\r", "streamed file keeps a '\\r' at EOF");
+        check_round_trip(doc, streamed);
+    }
+
+    std::filesystem::path streamed_mixed = dir / "streamed_mixed.txt";
+    write_file(streamed_mixed, lines + "bare\nend\r\n");
+    {
+        TextDocument doc;
+        load_fully(doc, streamed_mixed);
+        check(doc.format.lossy && doc.readonly, "streamed file with a late bare LF opens read-only");
+        auto copy = streamed_mixed;
+        copy += ".saved";
+        check(!doc.save_as(copy).has_value(), "saving a streamed mixed file is refused");
+    }
+}
+}
+
+int main() {
+    char dir_template[] = "/tmp/dead_editor_large_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::filesystem::path dir = dir_template;
+    std::filesystem::path path = dir / "sparse.txt";
+
+    test_mixed_line_endings(dir);
+
+    // Text at both ends, so the format sniffer sees text, and a hole between
+    // them that reads as one line of NUL bytes longer than 4 GiB.
+    std::string head;
+    for (size_t i = 0; i < HEAD_LINES; ++i) head += numbered_line("head", i);
+    std::string tail = "\n";
+    for (size_t i = 0; i < TAIL_LINES; ++i) tail += numbered_line("tail", i);
+    ByteOff tail_offset = FILE_SIZE - tail.size();
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    bool written = fd >= 0 &&
+                   pwrite(fd, head.data(), head.size(), 0) == static_cast<ssize_t>(head.size()) &&
+                   ftruncate(fd, static_cast<off_t>(FILE_SIZE)) == 0 &&
+                   pwrite(fd, tail.data(), tail.size(), static_cast<off_t>(tail_offset)) ==
+                       static_cast<ssize_t>(tail.size());
+    if (fd >= 0) close(fd);
+    if (!written) {
+        std::perror("creating sparse file");
+        std::filesystem::remove_all(dir);
+        return 1;
+    }
+
+    {
+        TextDocument doc;
+        auto loaded = doc.load(path);
+        check(loaded.has_value(), "load");
+        while (doc.is_loading()) {
+            doc.poll_loading();
+        }
+
+        LineIdx giant = static_cast<LineIdx>(HEAD_LINES);
+        LineIdx first_tail = giant + 1;
+        // The final newline ends the last tail line and leaves an empty line
+        // after it; offsets count a newline after every line, that one included.
+        check(doc.line_count() == HEAD_LINES + 1 + TAIL_LINES + 1,
+              "line count " + std::to_string(doc.line_count()));
+        check(doc.offset_manager.total_bytes() == FILE_SIZE + 1,
+              "total bytes " + std::to_string(doc.offset_manager.total_bytes()));
+
+        ByteOff giant_length = tail_offset - head.size();
+        check(giant_length > UINT32_MAX, "giant line spans more than 4 GiB");
+        check(doc.lines.view(static_cast<size_t>(giant)).size() == giant_length,
+              "giant line length " + std::to_string(doc.lines.view(static_cast<size_t>(giant)).size()));
+        std::string first_tail_text = numbered_line("tail", 0);
+        first_tail_text.pop_back();
+        check(doc.lines.view(static_cast<size_t>(first_tail)) == first_tail_text,
+              "first line after the giant line");
+
+        ByteOff tail_start = tail_offset + 1;
+        check(doc.get_byte_offset({first_tail, 5}) == tail_start + 5,
+              "byte offset past 2^32: " + std::to_string(doc.get_byte_offset({first_tail, 5})));
+        check(doc.get_byte_offset({first_tail + 1, 0}) == tail_start + 32, "byte offset of the next tail line");
+
+        // Editing past 2^32 moves later offsets and undoes cleanly.
+        TextPos end;
+        doc.insert_at({first_tail, 5}, "edited ", end);
+        check(doc.get_line(first_tail) == "tail edited " + first_tail_text.substr(5), "inserted text");
+        check(doc.get_byte_offset({first_tail + 1, 0}) == tail_start + 32 + 7, "offset after insert");
+        check(doc.offset_manager.total_bytes() == FILE_SIZE + 1 + 7, "total bytes after insert");
+
+        std::string deleted;
+        doc.delete_range({first_tail, 5}, end, deleted);
+        check(deleted == "edited ", "deleted text");
+        check(doc.get_line(first_tail) == first_tail_text, "line after delete");
+        check(doc.get_byte_offset({first_tail + 1, 0}) == tail_start + 32, "offset after delete");
+        check(doc.lines.view(static_cast<size_t>(giant)).size() == giant_length, "giant line untouched by edits");
+
+        // Saving writes the hole out in full, so it needs that much free space.
+        struct statvfs fs;
+        if (statvfs(dir.c_str(), &fs) != 0 || static_cast<ByteOff>(fs.f_bavail) * fs.f_frsize < FILE_SIZE * 2) {
+            std::puts("large_file_test: not enough free space, save round trip skipped");
+        } else {
+            doc.insert_at({first_tail, 5}, "edited ", end);
+            auto saved = doc.save();
+            check(saved.has_value(), "save");
+            check(std::filesystem::file_size(path) == FILE_SIZE + 7,
+                  "saved size " + std::to_string(std::filesystem::file_size(path)));
+
+            TextDocument reloaded;
+            check(reloaded.load(path).has_value(), "reload");
+            while (reloaded.is_loading()) {
+                reloaded.poll_loading();
+            }
+            check(reloaded.line_count() == doc.line_count(), "line count after save");
+            check(reloaded.get_line(first_tail) == "tail edited " + first_tail_text.substr(5), "saved edit");
+            check(reloaded.get_byte_offset({first_tail + 1, 0}) == tail_start + 32 + 7, "offset after save");
+            check(reloaded.lines.view(static_cast<size_t>(giant)).size() == giant_length, "giant line after save");
+        }
+    }
+
+    std::filesystem::remove_all(dir);
+    if (failures == 0) std::puts("large_file_test: ok");
+    return failures == 0 ? 0 : 1;
+}
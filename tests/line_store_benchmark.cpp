@@ -0,0 +1,81 @@
+// Times LineStore against the vector of strings it replaced: building a large
+// document, editing lines in its middle, reading lines at random and taking
+// snapshots for the background parser.
+
+#include "LineStore.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr size_t LINES = 2'000'000;
+constexpr size_t EDITS = 2'000;
+constexpr size_t READS = 2'000'000;
+constexpr size_t SNAPSHOTS = 10;
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string make_line(size_t i) {
+    return "    value_" + std::to_string(i) + " = compute(value_" + std::to_string(i / 2) + ");";
+}
+
+template <typename Lines>
+void run(const char* name) {
+    Lines lines;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < LINES; ++i) lines.push_back(make_line(i));
+    double build = elapsed_ms(start);
+
+    // The same positions for both layouts.
+    std::mt19937_64 rng(42);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < EDITS; ++i) {
+        size_t at = rng() % lines.size();
+        if (i % 2 == 0) {
+            lines.insert(lines.begin() + static_cast<ptrdiff_t>(at), make_line(i));
+        } else {
+            lines.erase(lines.begin() + static_cast<ptrdiff_t>(at), lines.begin() + static_cast<ptrdiff_t>(at) + 1);
+        }
+    }
+    double edit = elapsed_ms(start);
+
+    size_t bytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < READS; ++i) bytes += lines[rng() % lines.size()].size();
+    double read = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < SNAPSHOTS; ++i) {
+        Lines copy = lines;
+        bytes += copy.size();
+        lines[rng() % lines.size()] += ";";
+    }
+    double snapshot = elapsed_ms(start);
+
+    std::printf("%-12s build %8.1f ms  edit %8.1f ms  read %8.1f ms  snapshot %8.1f ms  (%zu)\n",
+                name, build, edit, read, snapshot, bytes);
+}
+
+// Gives LineStore the iterator-based insert and erase of std::vector, so both
+// layouts run the same loop.
+struct ChunkedLines : LineStore {
+    struct Position {
+        size_t index;
+        Position operator+(ptrdiff_t n) const { return {index + static_cast<size_t>(n)}; }
+    };
+
+    Position begin() const { return {0}; }
+    void insert(Position at, std::string line) { LineStore::insert(at.index, std::move(line)); }
+    void erase(Position first, Position last) { LineStore::erase(first.index, last.index); }
+};
+}
+
+int main() {
+    run<std::vector<std::string>>("vector");
+    run<ChunkedLines>("LineStore");
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Edits a LineStore next to a plain vector of lines and checks that both
+// hold the same lines: inserts and erases at and across chunk boundaries,
+// chunk splits and merges, lookups through the chunk index after each edit,
+// and snapshots that must not see edits made after them.
+
+#include "LineStore.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+constexpr size_t T = LineStore::CHUNK_TARGET;
+
+// Compares every line, through view(), the const operator[] and iteration.
+bool same(const LineStore& store, const std::vector<std::string>& model) {
+    if (store.size() != model.size()) return false;
+    for (size_t i = 0; i < model.size(); ++i) {
+        if (store.view(i) != model[i] || store[i] != model[i]) return false;
+    }
+    size_t i = 0;
+    for (const std::string& line : store) {
+        if (i >= model.size() || line != model[i++]) return false;
+    }
+    return i == model.size();
+}
+
+struct Fixture {
+    LineStore store;
+    std::vector<std::string> model;
+    size_t next = 0;
+
+    explicit Fixture(size_t lines) {
+        for (size_t i = 0; i < lines; ++i) push();
+    }
+
+    std::string make() { return "line " + std::to_string(next++); }
+
+    void push() {
+        std::string line = make();
+        store.push_back(line);
+        model.push_back(line);
+    }
+
+    void insert(size_t idx) {
+        std::string line = make();
+        store.insert(idx, line);
+        model.insert(model.begin() + static_cast<ptrdiff_t>(idx), line);
+    }
+
+    void insert_many(size_t idx, size_t count) {
+        std::vector<std::string> lines;
+        for (size_t i = 0; i < count; ++i) lines.push_back(make());
+        model.insert(model.begin() + static_cast<ptrdiff_t>(idx), lines.begin(), lines.end());
+        store.insert(idx, std::move(lines));
+    }
+
+    void erase(size_t first, size_t last) {
+        store.erase(first, last);
+        model.erase(model.begin() + static_cast<ptrdiff_t>(first), model.begin() + static_cast<ptrdiff_t>(last));
+    }
+
+    void edit(size_t idx) {
+        store[idx] += "!";
+        model[idx] += "!";
+    }
+};
+
+void test_chunk_boundaries() {
+    Fixture f(4 * T);
+    check(f.store.chunk_count() == 4, "push_back fills chunks to the target size");
+
+    f.insert(T);
+    check(same(f.store, f.model), "insert at the start of a chunk");
+    f.insert(2 * T + 1);
+    check(same(f.store, f.model), "insert at the end of a chunk");
+    f.insert(0);
+    f.insert(f.store.size() - 1);
+    check(same(f.store, f.model), "insert at the first and last line");
+
+    f.erase(T - 3, T + 3);
+    check(same(f.store, f.model), "erase across one chunk boundary");
+    f.erase(T / 2, 3 * T);
+    check(same(f.store, f.model), "erase across whole chunks");
+    f.erase(0, f.store.size());
+    check(f.store.empty() && f.store.chunk_count() == 0, "erase everything");
+
+    f.push();
+    check(same(f.store, f.model), "push_back after erasing everything");
+}
+
+void test_split_and_merge() {
+    Fixture f(3 * T);
+    size_t chunks = f.store.chunk_count();
+    for (size_t i = 0; i <= LineStore::CHUNK_MAX - T; ++i) f.insert(T + 10);
+    check(f.store.chunk_count() == chunks + 1, "a chunk past CHUNK_MAX splits");
+    check(same(f.store, f.model), "lines after a split");
+
+    chunks = f.store.chunk_count();
+    f.erase(0, T - LineStore::CHUNK_MIN + 1);
+    check(f.store.chunk_count() == chunks - 1, "a chunk below CHUNK_MIN merges into its neighbour");
+    check(same(f.store, f.model), "lines after a merge");
+
+    size_t tail = f.store.size() - 1;
+    f.erase(tail - (T - LineStore::CHUNK_MIN), tail + 1);
+    check(same(f.store, f.model), "merging the last chunk into the one before");
+
+    f.insert_many(T + 5, 3 * T + 7);
+    check(same(f.store, f.model), "inserting more lines than a chunk holds");
+    f.insert_many(10, 20);
+    check(same(f.store, f.model), "inserting a few lines into a chunk");
+    f.insert_many(f.store.size(), 2 * T);
+    check(same(f.store, f.model), "inserting lines at the end");
+}
+
+void test_random_edits() {
+    Fixture f(5 * T);
+    std::mt19937 rng(1234);
+    bool ok = true;
+    for (int step = 0; step < 4000 && ok; ++step) {
+        size_t size = f.store.size();
+        switch (rng() % 5) {
+            case 0:
+                f.insert(size == 0 ? 0 : rng() % (size + 1));
+                break;
+            case 1:
+                f.insert_many(size == 0 ? 0 : rng() % (size + 1), 1 + rng() % (2 * T));
+                break;
+            case 2:
+                if (size > 0) {
+                    size_t first = rng() % size;
+                    f.erase(first, std::min(size, first + 1 + rng() % (2 * T)));
+                }
+                break;
+            case 3:
+                if (size > 0) {
+                    size_t first = rng() % size;
+                    f.erase(first, first + 1);
+                }
+                break;
+            default:
+                if (size > 0) f.edit(rng() % size);
+                break;
+        }
+        // Every lookup goes through the chunk index, so this checks it after each edit.
+        if (step % 50 == 0) ok = same(f.store, f.model);
+    }
+    check(ok && same(f.store, f.model), "random edits keep the lines and the chunk index in step");
+}
+
+void test_snapshots() {
+    Fixture f(3 * T);
+    std::vector<std::string> before = f.model;
+    LineStore snapshot = f.store.snapshot();
+
+    f.edit(5);
+    f.insert(T);
+    f.erase(2 * T, 2 * T + 10);
+    check(same(f.store, f.model), "store after edits");
+    check(same(snapshot, before), "snapshot keeps the lines it was taken with");
+
+    LineStore copy = snapshot.snapshot();
+    copy[0] = "changed";
+    check(snapshot[0] == before[0], "editing one snapshot leaves its source alone");
+    check(f.store[0] == f.model[0], "editing one snapshot leaves the store alone");
+}
+
+void test_mapped_chunks() {
+    std::string text = "alpha\nbeta\r\ngamma\n\ndelta";
+    std::vector<uint64_t> starts = {0, 6, 12, 18, 19, text.size() + 1};
+    LineStore store;
+    store.append_mapped(text.data(), std::move(starts), true);
+    std::vector<std::string> model = {"alpha", "beta", "gamma", "", "delta"};
+    check(same(store, model), "mapped lines read in place");
+
+    LineStore snapshot = store.snapshot();
+    store[1] = "edited";
+    store.insert(2, "inserted");
+    check(snapshot.view(1) == "beta" && snapshot.size() == 5, "snapshot still reads the mapping after an edit");
+    check(store[1] == "edited" && store.view(2) == "inserted" && store.size() == 6,
+          "edited copy of a mapped chunk");
+}
+}
+
+int main() {
+    test_chunk_boundaries();
+    test_split_and_merge();
+    test_random_edits();
+    test_snapshots();
+    test_mapped_chunks();
+
+    if (failures == 0) std::printf("line_store_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}
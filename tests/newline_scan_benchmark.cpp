@@ -0,0 +1,77 @@
+// Scans a 512 MiB buffer of text lines with every newline kernel the CPU
+// supports and with memchr, counting newlines and collecting line starts the
+// way a file load does.
+
+#include "NewlineScan.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr size_t BUFFER_BYTES = size_t{512} << 20;
+
+std::string make_text() {
+    std::string text;
+    text.reserve(BUFFER_BYTES);
+    size_t i = 0;
+    while (text.size() < BUFFER_BYTES) {
+        text += "    value_";
+        text += std::to_string(i);
+        text.append(i % 97, ' ');
+        text += "= compute();\n";
+        i++;
+    }
+    text.resize(BUFFER_BYTES);
+    return text;
+}
+
+double elapsed_s(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const char* name, const char* what, double seconds, size_t result) {
+    std::printf("%-8s %-10s %7.1f ms  %6.2f GiB/s  (%zu)\n", name, what, seconds * 1000,
+                static_cast<double>(BUFFER_BYTES) / seconds / (1 << 30), result);
+}
+}
+
+int main() {
+    std::string text = make_text();
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    auto start = std::chrono::steady_clock::now();
+    size_t count = 0;
+    for (const char* p = begin; (p = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p))));
+         ++p) {
+        count++;
+    }
+    report("memchr", "count", elapsed_s(start), count);
+
+    std::vector<uint64_t> starts;
+    starts.reserve(count + 2);
+    for (const NewlineKernel& kernel : supported_newline_kernels()) {
+        start = std::chrono::steady_clock::now();
+        size_t counted = count_newlines(begin, end, kernel.newline_mask);
+        report(kernel.name, "count", elapsed_s(start), counted);
+
+        starts.clear();
+        start = std::chrono::steady_clock::now();
+        for_each_newline(begin, end, [&](const char* newline) {
+            starts.push_back(static_cast<uint64_t>(newline - begin) + 1);
+        }, kernel.newline_mask);
+        report(kernel.name, "positions", elapsed_s(start), starts.size());
+
+        ByteClassMasks masks;
+        start = std::chrono::steady_clock::now();
+        for (const char* p = begin; end - p >= 64; p += 64) {
+            ByteClassMasks m = kernel.byte_classes(p);
+            masks.newline ^= m.newline;
+            masks.carriage_return |= m.carriage_return;
+        }
+        report(kernel.name, "classes", elapsed_s(start), static_cast<size_t>(masks.newline & 0xff));
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+// Runs every newline kernel this CPU supports against a byte-at-a-time
+// reference: newline counts and positions over unaligned starts and tails,
+// inputs shorter than one vector, and the byte class masks used to sniff
+// line endings, including a CRLF split across two 64-byte blocks.
+
+#include "NewlineScan.h"
+#include "TextFormat.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+// Mostly text, with enough newlines, carriage returns, NULs and high bytes
+// that every mask sees set bits in most blocks.
+std::string random_bytes(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::string out(size, ' ');
+    for (char& c : out) {
+        switch (rng() % 16) {
+            case 0: c = '\n'; break;
+            case 1: c = '\r'; break;
+            case 2: c = '\0'; break;
+            case 3: c = static_cast<char>(0x80 + rng() % 128); break;
+            default: c = static_cast<char>('a' + rng() % 26); break;
+        }
+    }
+    return out;
+}
+
+ByteClassMasks reference_classes(const char* block) {
+    ByteClassMasks masks;
+    for (int i = 0; i < 64; ++i) {
+        auto c = static_cast<unsigned char>(block[i]);
+        uint64_t bit = uint64_t{1} << i;
+        if (c == '\n') masks.newline |= bit;
+        if (c == '\r') masks.carriage_return |= bit;
+        if (c == 0) masks.nul |= bit;
+        if (c >= 0x80) masks.high |= bit;
+    }
+    return masks;
+}
+
+bool same_classes(const ByteClassMasks& a, const ByteClassMasks& b) {
+    return a.newline == b.newline && a.carriage_return == b.carriage_return && a.nul == b.nul && a.high == b.high;
+}
+
+void test_newlines(const NewlineKernel& kernel, const std::string& data) {
+    std::string name = kernel.name;
+    bool counts = true;
+    bool positions = true;
+    // Every start within a block and lengths from empty to several blocks, so
+    // unaligned loads and every tail length are covered.
+    for (size_t start = 0; start < 64; ++start) {
+        for (size_t len = 0; len <= 300 && start + len <= data.size(); len += (len < 70 ? 1 : 37)) {
+            const char* begin = data.data() + start;
+            const char* end = begin + len;
+            std::vector<const char*> expected;
+            for (const char* p = begin; p < end; ++p) {
+                if (*p == '\n') expected.push_back(p);
+            }
+            std::vector<const char*> found;
+            for_each_newline(begin, end, [&](const char* p) { found.push_back(p); }, kernel.newline_mask);
+            counts &= count_newlines(begin, end, kernel.newline_mask) == expected.size();
+            positions &= found == expected;
+        }
+    }
+    check(counts, name + ": newline counts");
+    check(positions, name + ": newline positions");
+
+    const char* begin = data.data() + 3;
+    const char* end = data.data() + data.size() - 5;
+    size_t expected = 0;
+    for (const char* p = begin; p < end; ++p) expected += *p == '\n';
+    check(count_newlines(begin, end, kernel.newline_mask) == expected, name + ": newline count over the whole buffer");
+}
+
+void test_byte_classes(const NewlineKernel& kernel, const std::string& data) {
+    bool ok = true;
+    for (size_t offset = 0; offset + 64 <= data.size(); offset += 7) {
+        const char* block = data.data() + offset;
+        ok &= same_classes(kernel.byte_classes(block), reference_classes(block));
+    }
+    check(ok, std::string(kernel.name) + ": byte class masks");
+}
+
+void test_crlf_across_blocks(const NewlineKernel& kernel) {
+    std::string data(128, 'x');
+    data[63] = '\r';
+    data[64] = '\n';
+    ByteClassMasks first = kernel.byte_classes(data.data());
+    ByteClassMasks second = kernel.byte_classes(data.data() + 64);
+    check(first.carriage_return == uint64_t{1} << 63 && first.newline == 0 &&
+          second.newline == 1 && second.carriage_return == 0,
+          std::string(kernel.name) + ": '\\r' at the end of a block and '\\n' at the start of the next");
+}
+
+void test_format_sniffing() {
+    std::string lines;
+    while (lines.size() < 1000) lines += std::string(62, 'x') + "\r\n";
+    check(detect_text_format(lines.data(), lines.size()).line_ending == LineEnding::CRLF,
+          "CRLF lines whose '\\r' ends a 64-byte block");
+    check(detect_text_format("a\r\n", 3).line_ending == LineEnding::CRLF, "CRLF in an input shorter than a block");
+    check(detect_text_format("a\nb\n", 4).line_ending == LineEnding::LF, "LF in an input shorter than a block");
+}
+}
+
+int main() {
+    std::string data = random_bytes(4096, 7);
+    auto kernels = supported_newline_kernels();
+    check(!kernels.empty() && std::string(kernels.back().name) == "scalar", "the scalar kernel is always available");
+    check(kernels.front().newline_mask == newline_mask_kernel(), "the widest kernel is in use");
+
+    for (const NewlineKernel& kernel : kernels) {
+        std::printf("newline_scan_test: checking %s\n", kernel.name);
+        test_newlines(kernel, data);
+        test_byte_classes(kernel, data);
+        test_crlf_across_blocks(kernel);
+    }
+    test_format_sniffing();
+
+    if (failures == 0) std::printf("newline_scan_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}
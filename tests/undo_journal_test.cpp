@@ -0,0 +1,145 @@
+// Journals 100k edits, undos and redos, then replays the journal into a fresh
+// CommandManager. Replay must finish within a second, and undoing and redoing
+// the replayed history must go back to an empty document and forward to the
+// edited text again.
+
+#include "CommandManager.h"
+#include "EditorController.h"
+#include "TextDocument.h"
+#include "UndoJournal.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+
+namespace {
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+constexpr size_t OPERATIONS = 100'000;
+constexpr double MAX_REPLAY_SECONDS = 1.0;
+
+std::future<uint64_t> ready_hash(const TextDocument& doc) {
+    std::promise<uint64_t> hash;
+    hash.set_value(UndoJournal::content_hash(doc.lines));
+    return hash.get_future();
+}
+
+std::string text_of(const TextDocument& doc) {
+    std::string out;
+    for (size_t i = 0; i < doc.lines.size(); ++i) {
+        if (i > 0) out += '\n';
+        out += doc.lines.view(i);
+    }
+    return out;
+}
+
+// Mirrors EditorController::undo and redo, which also need a view.
+bool step(TextDocument& doc, EditorController& ctrl, bool undo) {
+    CommandManager& history = ctrl.command_manager;
+    history.ensure_restored();
+    auto& from = undo ? history.get_undo_stack() : history.get_redo_stack();
+    auto& to = undo ? history.get_redo_stack() : history.get_undo_stack();
+    if (from.empty()) return false;
+    uint64_t group = get_action_group_id(from.back());
+    while (!from.empty() && get_action_group_id(from.back()) == group) {
+        if (undo) {
+            std::visit([&](auto& op) { revert_action(op, doc, ctrl); }, from.back());
+        } else {
+            std::visit([&](auto& op) { apply_action(op, doc, ctrl); }, from.back());
+        }
+        to.push_back(std::move(from.back()));
+        from.pop_back();
+    }
+    if (undo) {
+        history.note_undo();
+    } else {
+        history.note_redo();
+    }
+    return true;
+}
+
+// Types, breaks lines, backspaces, moves the cursor and steps through history
+// at random, so the journal holds merged runs, grouped edits and markers.
+void edit(TextDocument& doc, EditorController& ctrl) {
+    std::mt19937 rng(99);
+    uint64_t group = 1;
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+        unsigned roll = rng() % 100;
+        if (roll < 60) {
+            char ch = rng() % 6 == 0 ? ' ' : static_cast<char>('a' + rng() % 26);
+            InsertOp op{ctrl.cursor_line, ctrl.cursor_col, std::string(1, ch), 0, 0, group++};
+            apply_action(op, doc, ctrl);
+            ctrl.command_manager.push(std::move(op), true);
+        } else if (roll < 68) {
+            InsertOp op{ctrl.cursor_line, ctrl.cursor_col, "\n", 0, 0, group++};
+            apply_action(op, doc, ctrl);
+            ctrl.command_manager.push(std::move(op));
+        } else if (roll < 82 && ctrl.cursor_col > 0) {
+            DeleteOp op{ctrl.cursor_line, ctrl.cursor_col - 1, "", ctrl.cursor_line, ctrl.cursor_col, group++};
+            apply_action(op, doc, ctrl);
+            ctrl.command_manager.push(std::move(op), true);
+        } else if (roll < 92) {
+            ctrl.cursor_line = static_cast<LineIdx>(rng() % doc.lines.size());
+            auto len = static_cast<uint32_t>(doc.lines.view(static_cast<size_t>(ctrl.cursor_line)).size());
+            ctrl.cursor_col = static_cast<ColIdx>(rng() % (len + 1));
+        } else {
+            step(doc, ctrl, roll < 97);
+        }
+    }
+}
+}
+
+int main() {
+    char dir_template[] = "/tmp/dead_editor_journal_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::filesystem::path dir = dir_template;
+    std::filesystem::path path = dir / "history.undo";
+
+    std::string edited;
+    size_t records = 0;
+    {
+        TextDocument doc;
+        EditorController ctrl;
+        ctrl.command_manager.attach_journal(path, ready_hash(doc));
+        edit(doc, ctrl);
+        ctrl.command_manager.checkpoint(path, UndoJournal::content_hash(doc.lines));
+        edited = text_of(doc);
+        records = ctrl.command_manager.get_undo_stack().size();
+    }
+    check(!edited.empty() && records > 0, "the edits left text and history");
+
+    TextDocument doc;
+    doc.load_text(edited);
+    EditorController ctrl;
+    ctrl.command_manager.attach_journal(path, ready_hash(doc));
+
+    auto start = std::chrono::steady_clock::now();
+    ctrl.command_manager.ensure_restored();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("undo_journal_test: replayed %zu operations in %.3f s\n", OPERATIONS, seconds);
+    check(seconds < MAX_REPLAY_SECONDS, "replay takes under a second");
+    check(ctrl.command_manager.get_undo_stack().size() == records, "replay rebuilds every undo record");
+
+    while (step(doc, ctrl, true)) {}
+    check(text_of(doc).empty(), "undoing the replayed history empties the document");
+    while (step(doc, ctrl, false)) {}
+    check(text_of(doc) == edited, "redoing it restores the edited text");
+
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+
+    if (failures == 0) std::printf("undo_journal_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}